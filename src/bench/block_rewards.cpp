@@ -0,0 +1,146 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <key.h>
+#include <key_io.h>
+#include <masternodes/masternode-payments.h>
+#include <net.h>
+#include <spork.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <util/strencodings.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <vector>
+
+// Sporks of each multi value kind, about as many as mainnet has seen
+static const int SPORK_HISTORY_LENGTH = 24;
+static const int SPORK_ACTIVATION_INTERVAL = 50000;
+static const int LOTTERY_WINNERS = 11;
+
+// The reward split of a block, with the block value and payment sporks
+// activated one after another. The spork manager is restored afterwards, so
+// the benchmarks run after this one see none of the sporks.
+static void BlockSubsidity(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    const CSporkManager sporkManagerBefore = sporkManager;
+    const std::map<uint256, CSporkMessage> mapSporksBefore = mapSporks;
+
+    CKey key;
+    key.MakeNewKey(false);
+    bool spork_key = sporkManager.SetSporkAddress(HexStr(key.GetPubKey())) && sporkManager.SetPrivKey(EncodeSecret(key));
+    assert(spork_key);
+
+    CConnman connman(0x1337, 0x1337);
+    const int64_t nTimeStart = 1500000000;
+    for (int i = 0; i < SPORK_HISTORY_LENGTH; i++) {
+        const int nActivationHeight = 10 + i * SPORK_ACTIVATION_INTERVAL;
+        // every spork has to be signed after the one before it
+        SetMockTime(nTimeStart + 2 * i);
+        bool block_value = sporkManager.UpdateSpork(SPORK_15_BLOCK_VALUE, BlockSubsiditySporkValue(1250 - 25 * i, nActivationHeight).ToString(), &connman);
+        SetMockTime(nTimeStart + 2 * i + 1);
+        bool block_payments = sporkManager.UpdateSpork(SPORK_13_BLOCK_PAYMENTS, BlockPaymentSporkValue(38 - i % 5, 45 + i % 5, 16, 0, 1, nActivationHeight).ToString(), &connman);
+        assert(block_value && block_payments);
+    }
+    SetMockTime(0);
+
+    int nHeight = consensus.nLastPOWBlock;
+    while (state.KeepRunning()) {
+        if (++nHeight > SPORK_HISTORY_LENGTH * SPORK_ACTIVATION_INTERVAL)
+            nHeight = consensus.nLastPOWBlock + 1;
+        CBlockRewards rewards = GetBlockSubsidity(nHeight, consensus);
+        assert(rewards.nStakeReward > 0);
+    }
+
+    sporkManager = sporkManagerBefore;
+    mapSporks = mapSporksBefore;
+}
+
+static CTransactionRef MakeLotteryTicket(const CScript& scriptPayout)
+{
+    CMutableTransaction tx;
+    tx.vin.emplace_back(COutPoint(GetRandHash(), 0));
+    tx.vout.emplace_back(0, CScript());
+    tx.vout.emplace_back(20000 * COIN, scriptPayout);
+    return MakeTransactionRef(std::move(tx));
+}
+
+// What every proof-of-stake block adds to connecting it: scoring its coinstake
+// against the running lottery winners of its parent. The winners of the parent
+// are loaded from the block tree once and come from memory afterwards.
+static void LotteryWinners(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    // Halfway through the third lottery cycle
+    const int nHeight = 2 * consensus.nLotteryBlockCycle + consensus.nLotteryBlockCycle / 2;
+    std::vector<uint256> vHashes(nHeight);
+    std::vector<CBlockIndex> vIndex(nHeight);
+    for (int i = 0; i < nHeight; i++) {
+        vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+        vIndex[i].phashBlock = &vHashes[i];
+        vIndex[i].pprev = i ? &vIndex[i - 1] : nullptr;
+        vIndex[i].nHeight = i;
+        vIndex[i].nTime = 1500000000 + i * 60;
+        vIndex[i].BuildSkip();
+    }
+    const CBlockIndex* pindexPrev = &vIndex.back();
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptPayout = GetScriptForDestination(key.GetPubKey().GetID());
+
+    // The tickets of the parent block are found in the mempool, like the
+    // transactions of the recent blocks would be found in the transaction index
+    std::unique_ptr<CBlockTreeDB> pblocktreeBefore = std::move(pblocktree);
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    CDiskBlockIndex diskindex(pindexPrev);
+    {
+        LOCK2(cs_main, mempool.cs);
+        LockPoints lp;
+        for (int i = 0; i < LOTTERY_WINNERS; i++) {
+            CTransactionRef ticket = MakeLotteryTicket(scriptPayout);
+            mempool.addUnchecked(CTxMemPoolEntry(ticket, 0, 0, pindexPrev->nHeight, false, 4, lp));
+            diskindex.vLotteryWinnersCoinstakes.push_back(ticket->GetHash());
+        }
+    }
+    bool written = pblocktree->WriteBatchSync({}, 0, {std::make_pair(pindexPrev->GetBlockHash(), diskindex)}, {});
+    assert(written);
+
+    CMutableTransaction txCoinBase;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vout.emplace_back(0, CScript());
+
+    CBlock block;
+    block.nTime = pindexPrev->nTime + 60;
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+    block.vtx.push_back(MakeLotteryTicket(scriptPayout));
+
+    {
+        LOCK(cs_main);
+        chainActive.SetTip(const_cast<CBlockIndex*>(pindexPrev));
+        std::vector<CLotteryWinner> vWinners;
+        while (state.KeepRunning()) {
+            bool fCalculated = CalculateLotteryWinners(block, pindexPrev, nHeight, consensus, vWinners);
+            assert(fCalculated && vWinners.size() == LOTTERY_WINNERS);
+        }
+    }
+
+    // The lottery winners are cached by block index entry, drop them with the
+    // chain before vIndex goes away, and the tickets with them
+    UnloadBlockIndex();
+    mempool.clear();
+    pblocktree = std::move(pblocktreeBefore);
+}
+
+BENCHMARK(BlockSubsidity, 2 * 1000 * 1000);
+BENCHMARK(LotteryWinners, 150 * 1000);
@@ -0,0 +1,60 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <consensus/kernel.h>
+#include <interfaces/chain.h>
+#include <key.h>
+#include <script/standard.h>
+#include <validation.h>
+#include <wallet/wallet.h>
+
+#include <vector>
+
+static const int STAKE_WALLET_UTXOS = 10000;
+
+// Building the coinstake once a kernel was found, in a wallet with many small
+// outputs to the kernel address. Every one of them is a candidate to combine
+// into the coinstake. With no chain tip there are no block payees to add.
+static void CreateCoinStake(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+
+    auto chain = interfaces::MakeChain();
+    CWallet wallet(*chain, WalletLocation(), WalletDatabase::CreateDummy());
+
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptStake = GetScriptForDestination(key.GetPubKey().GetID());
+
+    std::vector<std::unique_ptr<CWalletTx>> wtxs;
+    CWallet::StakeCoinsSet setCombineCoins;
+    for (int i = 0; i <= STAKE_WALLET_UTXOS; i++) {
+        CMutableTransaction tx;
+        tx.nLockTime = i; // so all transactions get different hashes
+        tx.vout.emplace_back(i ? 100 * COIN : MIN_STAKING_AMOUNT * COIN, scriptStake);
+        wtxs.push_back(MakeUnique<CWalletTx>(&wallet, MakeTransactionRef(std::move(tx))));
+        setCombineCoins.emplace(wtxs.back().get(), 0);
+    }
+
+    CStakeCandidate kernel;
+    kernel.pwtx = wtxs.front().get();
+    kernel.nValue = kernel.pwtx->tx->vout[0].nValue;
+
+    CStakeKernelContext context;
+    context.nHeight = 1000;
+    const CBlockRewards rewards(450 * COIN, 0, 0, 0, 0, 0);
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        CMutableTransaction txNew;
+        std::vector<const CWalletTx*> vwtxPrev;
+        bool created = wallet.CreateCoinStake(context, kernel, setCombineCoins, rewards, txNew, vwtxPrev);
+        assert(created);
+        assert(txNew.vin.size() == MAX_KERNEL_COMBINED_INPUTS);
+    }
+}
+
+BENCHMARK(CreateCoinStake, 500);
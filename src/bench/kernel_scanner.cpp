@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <kernelscanner.h>
+#include <random.h>
+#include <util/system.h>
+
+#include <boost/thread/thread.hpp>
+
+// Every iteration hashes the kernels of a whole staking wallet, the kernel
+// rate is STAKE_INPUTS (times the drift for V2) divided by the reported time.
+static const size_t STAKE_INPUTS = 4096;
+static const unsigned int STAKE_HASH_DRIFT = 45;
+static const uint32_t BLOCK_FROM_TIME = 1500000000;
+// Nothing meets this target, so the whole wallet is always scanned
+static const unsigned int IMPOSSIBLE_BITS = 0x01010000;
+
+static std::vector<CStakeKernelInput> StakeInputs()
+{
+    FastRandomContext insecure_rand(true);
+    std::vector<CStakeKernelInput> vInputs(STAKE_INPUTS);
+    for (CStakeKernelInput& input : vInputs) {
+        input.prevout = COutPoint(insecure_rand.rand256(), insecure_rand.randrange(4));
+        input.nValue = (1 + insecure_rand.randrange(100000)) * COIN;
+        input.nBlockFromTime = BLOCK_FROM_TIME;
+        input.nStakeModifier = insecure_rand.rand64();
+    }
+    return vInputs;
+}
+
+static CStakeKernelContext StakeContext(bool fModifierV3)
+{
+    CStakeKernelContext context;
+    context.nBits = IMPOSSIBLE_BITS;
+    context.fModifierV3 = fModifierV3;
+    context.hashStakeModifierV3 = FastRandomContext(true).rand256();
+    return context;
+}
+
+// Kernel by kernel, the way the wallet searched before ScanStakeKernels
+static void StakeKernelSerial(benchmark::State& state, bool fModifierV3)
+{
+    const std::vector<CStakeKernelInput> vInputs = StakeInputs();
+    const CStakeKernelContext context = StakeContext(fModifierV3);
+    while (state.KeepRunning()) {
+        for (const CStakeKernelInput& input : vInputs) {
+            unsigned int nTimeTx = BLOCK_FROM_TIME + nStakeMaxAge;
+            uint256 hashProofOfStake;
+            CheckStakeKernelHash(context, input.nBlockFromTime, input.nStakeModifier, input.nValue, input.prevout,
+                                 nTimeTx, STAKE_HASH_DRIFT, hashProofOfStake);
+        }
+    }
+}
+
+static void StakeKernelScan(benchmark::State& state, bool fModifierV3, int nThreads)
+{
+    const std::vector<CStakeKernelInput> vInputs = StakeInputs();
+    const CStakeKernelContext context = StakeContext(fModifierV3);
+    boost::thread_group tg;
+    nStakeKernelThreads = nThreads;
+    for (int i = 0; i < nThreads - 1; i++) {
+        tg.create_thread([]{ThreadStakeKernelCheck();});
+    }
+    while (state.KeepRunning()) {
+        CStakeKernelResult result;
+        ScanStakeKernels(context, vInputs, BLOCK_FROM_TIME + nStakeMaxAge, STAKE_HASH_DRIFT, result);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+    nStakeKernelThreads = 0;
+}
+
+// One V3 kernel hash, as the consensus check of a proof-of-stake block does it,
+// with the block index entries of the tip and of the kernel
+static void StakeKernelHashV3(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::MAIN);
+    const CStakeKernelInput input = StakeInputs().front();
+
+    CBlockIndex indexFrom;
+    indexFrom.nTime = input.nBlockFromTime;
+    CBlockIndex indexPrev;
+    indexPrev.nHeight = Params().GetConsensus().nSegwitHeight + 10;
+    indexPrev.hashStakeModifierV3 = FastRandomContext(true).rand256();
+
+    while (state.KeepRunning()) {
+        unsigned int nTimeTx = BLOCK_FROM_TIME + nStakeMaxAge;
+        uint256 hashProofOfStake;
+        CheckStakeKernelHash(&indexPrev, IMPOSSIBLE_BITS, &indexFrom, input.nValue, input.prevout, indexPrev.nHeight + 1,
+                             nTimeTx, 0, true, hashProofOfStake);
+    }
+}
+
+static void StakeKernelSerialV2(benchmark::State& state) { StakeKernelSerial(state, false); }
+static void StakeKernelSerialV3(benchmark::State& state) { StakeKernelSerial(state, true); }
+static void StakeKernelScanV2(benchmark::State& state) { StakeKernelScan(state, false, 0); }
+static void StakeKernelScanV3(benchmark::State& state) { StakeKernelScan(state, true, 0); }
+static void StakeKernelScanV2Parallel(benchmark::State& state) { StakeKernelScan(state, false, std::max(2, GetNumCores())); }
+static void StakeKernelScanV3Parallel(benchmark::State& state) { StakeKernelScan(state, true, std::max(2, GetNumCores())); }
+
+BENCHMARK(StakeKernelHashV3, 50 * 1000);
+BENCHMARK(StakeKernelSerialV2, 2);
+BENCHMARK(StakeKernelSerialV3, 100);
+BENCHMARK(StakeKernelScanV2, 5);
+BENCHMARK(StakeKernelScanV3, 200);
+BENCHMARK(StakeKernelScanV2Parallel, 20);
+BENCHMARK(StakeKernelScanV3Parallel, 500);
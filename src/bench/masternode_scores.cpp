@@ -0,0 +1,61 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <arith_uint256.h>
+#include <masternodes/masternode.h>
+#include <masternodes/masternode-scores.h>
+#include <random.h>
+
+#include <vector>
+
+// The rounds of a score depend on the tier, from copper to diamond
+static void MasternodeScore(benchmark::State& state, CMasternode::Tier tier)
+{
+    const COutPoint outpoint(GetRandHash(), 0);
+    uint256 hashBlock = GetRandHash();
+    while (state.KeepRunning()) {
+        hashBlock = ArithToUint256(CMasternode::CalculateScore(outpoint, tier, hashBlock));
+    }
+}
+
+static void MasternodeScoreCopper(benchmark::State& state) { MasternodeScore(state, CMasternode::MASTERNODE_TIER_COPPER); }
+static void MasternodeScoreSilver(benchmark::State& state) { MasternodeScore(state, CMasternode::MASTERNODE_TIER_SILVER); }
+static void MasternodeScoreGold(benchmark::State& state) { MasternodeScore(state, CMasternode::MASTERNODE_TIER_GOLD); }
+static void MasternodeScorePlatinum(benchmark::State& state) { MasternodeScore(state, CMasternode::MASTERNODE_TIER_PLATINUM); }
+static void MasternodeScoreDiamond(benchmark::State& state) { MasternodeScore(state, CMasternode::MASTERNODE_TIER_DIAMOND); }
+
+// What the masternode ranking pays on every new block: the scores of the
+// whole list, computed on all cores, and the sort into a snapshot. Tiers are
+// spread over the list, so are the rounds per score.
+static void MasternodeRanks(benchmark::State& state, size_t nMasternodes)
+{
+    std::vector<CMasternode> vMasternodes(nMasternodes);
+    for (size_t i = 0; i < nMasternodes; i++) {
+        vMasternodes[i].vin = CTxIn(COutPoint(GetRandHash(), 0));
+        vMasternodes[i].nTier = i % CMasternode::MASTERNODE_TIER_INVALID;
+    }
+
+    uint256 hashBlock = GetRandHash();
+    while (state.KeepRunning()) {
+        CMasternodeScoreCache cache;
+        std::shared_ptr<const CMasternodeScoreSnapshot> snapshot = cache.Get(hashBlock, vMasternodes);
+        assert(snapshot->size() == nMasternodes);
+        hashBlock = ArithToUint256(snapshot->GetScores().front().nScore);
+    }
+}
+
+static void MasternodeRanks1k(benchmark::State& state) { MasternodeRanks(state, 1000); }
+static void MasternodeRanks5k(benchmark::State& state) { MasternodeRanks(state, 5000); }
+static void MasternodeRanks10k(benchmark::State& state) { MasternodeRanks(state, 10000); }
+
+BENCHMARK(MasternodeScoreCopper, 100 * 1000);
+BENCHMARK(MasternodeScoreSilver, 30 * 1000);
+BENCHMARK(MasternodeScoreGold, 9000);
+BENCHMARK(MasternodeScorePlatinum, 3000);
+BENCHMARK(MasternodeScoreDiamond, 800);
+
+BENCHMARK(MasternodeRanks1k, 10);
+BENCHMARK(MasternodeRanks5k, 2);
+BENCHMARK(MasternodeRanks10k, 1);
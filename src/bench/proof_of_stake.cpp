@@ -0,0 +1,185 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <coins.h>
+#include <consensus/kernel.h>
+#include <key.h>
+#include <keystore.h>
+#include <policy/policy.h>
+#include <pow.h>
+#include <script/sign.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <validation.h>
+
+#include <vector>
+
+static const int STAKE_CHAIN_LENGTH = 2000;
+static const int STAKE_COIN_HEIGHT = 100;
+
+// A proof-of-stake block on top of a chain of STAKE_CHAIN_LENGTH entries, with
+// a coinstake combining as many inputs as a kernel is allowed to. The inputs
+// come from a block at STAKE_COIN_HEIGHT, which is in the coins view and in
+// the first block file.
+struct StakeBlockSetup
+{
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndex;
+    CCoinsView coinsDummy;
+    CCoinsViewCache view;
+    CBlock block;
+
+    StakeBlockSetup() : vHashes(STAKE_CHAIN_LENGTH), vIndex(STAKE_CHAIN_LENGTH), view(&coinsDummy)
+    {
+        CBasicKeyStore keystore;
+        CKey key;
+        key.MakeNewKey(true);
+        keystore.AddKey(key);
+        const CScript scriptStake = GetScriptForDestination(key.GetPubKey().GetID());
+
+        CMutableTransaction txFrom;
+        txFrom.vin.resize(1);
+        txFrom.vin[0].prevout = COutPoint(uint256S("1"), 0);
+        for (unsigned int i = 0; i < MAX_KERNEL_COMBINED_INPUTS; i++)
+            txFrom.vout.emplace_back(MIN_STAKING_AMOUNT * COIN, scriptStake);
+        AddCoins(view, CTransaction(txFrom), STAKE_COIN_HEIGHT);
+
+        for (int i = 0; i < STAKE_CHAIN_LENGTH; i++) {
+            vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+            vIndex[i].phashBlock = &vHashes[i];
+            vIndex[i].pprev = i ? &vIndex[i - 1] : nullptr;
+            vIndex[i].nHeight = i;
+            vIndex[i].nTime = 1500000000 + i * 60;
+            vIndex[i].BuildSkip();
+        }
+        vIndex.back().hashStakeModifierV3 = uint256S("5a4e");
+
+        // The block the stake inputs come from, written where its entry says
+        CBlock blockFrom;
+        blockFrom.nTime = vIndex[STAKE_COIN_HEIGHT].nTime;
+        blockFrom.nBits = UintToArith256(Params().GetConsensus().powLimit).GetCompact();
+        blockFrom.vtx.push_back(MakeTransactionRef(std::move(txFrom)));
+        while (!CheckProofOfWork(blockFrom.GetHash(), blockFrom.nBits, Params().GetConsensus()))
+            blockFrom.nNonce++;
+        vHashes[STAKE_COIN_HEIGHT] = blockFrom.GetHash();
+        vIndex[STAKE_COIN_HEIGHT].nStatus |= BLOCK_HAVE_DATA;
+        vIndex[STAKE_COIN_HEIGHT].nFile = 0;
+        vIndex[STAKE_COIN_HEIGHT].nDataPos = 0;
+        {
+            CAutoFile fileout(OpenBlockFile(vIndex[STAKE_COIN_HEIGHT].GetBlockPos()), SER_DISK, CLIENT_VERSION);
+            assert(!fileout.IsNull());
+            fileout << blockFrom;
+        }
+
+        CMutableTransaction txCoinStake;
+        for (unsigned int i = 0; i < MAX_KERNEL_COMBINED_INPUTS; i++)
+            txCoinStake.vin.emplace_back(COutPoint(blockFrom.vtx[0]->GetHash(), i));
+        txCoinStake.vout.emplace_back(0, CScript());
+        txCoinStake.vout.emplace_back(MAX_KERNEL_COMBINED_INPUTS * MIN_STAKING_AMOUNT * COIN, scriptStake);
+        bool signed_kernel = SignSignature(keystore, scriptStake, txCoinStake, 0, MIN_STAKING_AMOUNT * COIN, SIGHASH_ALL);
+        assert(signed_kernel);
+
+        CMutableTransaction txCoinBase;
+        txCoinBase.vin.resize(1);
+        txCoinBase.vin[0].prevout.SetNull();
+        txCoinBase.vout.emplace_back(0, CScript());
+
+        block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+        block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+
+        // A target about half of the block times meet, the first one that
+        // does is the block time, as a staker would have found it
+        arith_uint256 bnTarget = arith_uint256(1) << 215;
+        block.nBits = bnTarget.GetCompact();
+        const COutPoint& prevoutKernel = block.vtx[1]->vin[0].prevout;
+        for (block.nTime = Tip()->nTime + 1; ; block.nTime++) {
+            unsigned int nTimeTx = block.nTime;
+            uint256 hashProofOfStake;
+            if (CheckStakeKernelHash(Tip(), block.nBits, From(), MIN_STAKING_AMOUNT * COIN, prevoutKernel, Tip()->nHeight + 1,
+                                     nTimeTx, 0, true, hashProofOfStake))
+                break;
+        }
+    }
+
+    const CBlockIndex* Tip() const { return &vIndex.back(); }
+    CBlockIndex* From() { return &vIndex[STAKE_COIN_HEIGHT]; }
+};
+
+// The check as it was before it took the coins view: every stake input found
+// by reading the block it was mined in, the way GetTransaction finds it with
+// the transaction index or the slow lookup, and the kernel block read once
+// more for its time.
+static bool CheckProofOfStakeByBlockReads(const CBlock& block, const CBlockIndex* pindexPrev, CBlockIndex* pindexFrom, uint256& hashProofOfStake)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const CTransactionRef& tx = block.vtx[1];
+    const CTxIn& txin = tx->vin[0];
+
+    uint256 hashBlock;
+    CTransactionRef txPrev;
+    if (!GetTransaction(txin.prevout.hash, txPrev, consensus, hashBlock, true, pindexFrom))
+        return false;
+    const CTxOut& txoutKernel = txPrev->vout[txin.prevout.n];
+
+    for (const CTxIn& txIn : tx->vin) {
+        CTransactionRef txInPrev;
+        if (!GetTransaction(txIn.prevout.hash, txInPrev, consensus, hashBlock, true, pindexFrom))
+            return false;
+        if (txInPrev->vout[txIn.prevout.n].scriptPubKey != txoutKernel.scriptPubKey)
+            return false;
+    }
+
+    if (!VerifyScript(txin.scriptSig, txoutKernel.scriptPubKey, &txin.scriptWitness, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(tx.get(), 0, txoutKernel.nValue)))
+        return false;
+
+    CBlock blockFrom;
+    if (!ReadBlockFromDisk(blockFrom, pindexFrom->GetBlockPos(), consensus))
+        return false;
+
+    unsigned int nTime = block.nTime;
+    return CheckStakeKernelHash(pindexPrev, block.nBits, pindexFrom, txoutKernel.nValue, txin.prevout, pindexPrev->nHeight + 1,
+                                nTime, 0, true, hashProofOfStake);
+}
+
+// What ConnectBlock spends on the proof-of-stake of one block during IBD.
+// The stake inputs come from the coins view and the kernel block time from
+// the block index, none of it touches the disk.
+static void CheckProofOfStakeFromCoins(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    StakeBlockSetup setup;
+
+    LOCK(cs_main);
+    // both checks hash the same kernel
+    uint256 hashFromCoins, hashFromDisk;
+    bool checked = CheckProofOfStake(setup.block, setup.Tip(), setup.view, hashFromCoins) &&
+                   CheckProofOfStakeByBlockReads(setup.block, setup.Tip(), setup.From(), hashFromDisk);
+    assert(checked && hashFromCoins == hashFromDisk);
+
+    while (state.KeepRunning()) {
+        uint256 hashProofOfStake;
+        checked = CheckProofOfStake(setup.block, setup.Tip(), setup.view, hashProofOfStake);
+        assert(checked);
+    }
+}
+
+// The same block checked the way it was before, the baseline for the one above
+static void CheckProofOfStakeFromDisk(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    StakeBlockSetup setup;
+
+    LOCK(cs_main);
+    while (state.KeepRunning()) {
+        uint256 hashProofOfStake;
+        bool checked = CheckProofOfStakeByBlockReads(setup.block, setup.Tip(), setup.From(), hashProofOfStake);
+        assert(checked);
+    }
+}
+
+BENCHMARK(CheckProofOfStakeFromCoins, 2000);
+BENCHMARK(CheckProofOfStakeFromDisk, 500);
@@ -0,0 +1,155 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockprevalidator.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+
+CBlockPreValidator blockPreValidator;
+
+CBlockPreValidator::CBlockPreValidator() : nNextCheck(0), fCommitting(false), fRunning(false), fInterrupted(false)
+{
+}
+
+CBlockPreValidator::~CBlockPreValidator()
+{
+    if (!vThreads.empty()) Stop();
+}
+
+bool CBlockPreValidator::CanCommit() const
+{
+    return !fCommitting && !queueJobs.empty() && queueJobs.front()->fChecked;
+}
+
+bool CBlockPreValidator::Submit(const std::shared_ptr<const CBlock>& pblock, std::function<void()> commit)
+{
+    {
+        LOCK(cs);
+        // the message handler thread must not wait for the checks to catch up, and
+        // must not commit the block ahead of the queued ones either
+        if (fInterrupted || queueJobs.size() >= MAX_BLOCK_PREVALIDATION_QUEUE) return false;
+
+        if (fRunning) {
+            queueJobs.push_back(std::make_shared<CJob>(CJob{pblock, pblock->GetHash(), std::move(commit), false}));
+            condWork.notify_one();
+            return true;
+        }
+    }
+
+    commit();
+    return true;
+}
+
+bool CBlockPreValidator::Contains(const uint256& hash) const
+{
+    LOCK(cs);
+    if (fCommitting && hashCommitting == hash) return true;
+    return std::any_of(queueJobs.begin(), queueJobs.end(), [&hash](const std::shared_ptr<CJob>& job) { return job->hash == hash; });
+}
+
+size_t CBlockPreValidator::size() const
+{
+    LOCK(cs);
+    return queueJobs.size();
+}
+
+void CBlockPreValidator::ThreadPreValidate()
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    while (true) {
+        std::shared_ptr<CJob> job;
+        bool fCommit = false;
+        {
+            WAIT_LOCK(cs, lock);
+            condWork.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fInterrupted || CanCommit() || nNextCheck < queueJobs.size(); });
+            if (fInterrupted) return;
+
+            // committing the oldest block comes first, it is what the blocks after it wait for
+            if (CanCommit()) {
+                job = queueJobs.front();
+                queueJobs.pop_front();
+                --nNextCheck;
+                fCommitting = true;
+                hashCommitting = job->hash;
+                fCommit = true;
+            } else {
+                job = queueJobs[nNextCheck++];
+            }
+        }
+
+        if (fCommit) {
+            job->commit();
+            // the callback may hold node references, release them on this thread
+            job.reset();
+            LOCK(cs);
+            fCommitting = false;
+            condWork.notify_all();
+            continue;
+        }
+
+        // A block failing its checks is committed all the same. ProcessNewBlock checks it
+        // again with the state that rejects it, and punishes the peer it came from.
+        const int64_t nTimeStart = GetTimeMicros();
+        CValidationState state;
+        CheckBlock(*job->pblock, state, consensusParams);
+        LogPrint(BCLog::BENCH, "CBlockPreValidator -- checked block %s in %.2fms\n", job->pblock->GetHash().ToString(), (GetTimeMicros() - nTimeStart) * 0.001);
+
+        LOCK(cs);
+        job->fChecked = true;
+        if (CanCommit()) condWork.notify_one();
+    }
+}
+
+void CBlockPreValidator::Start()
+{
+    LOCK(cs);
+    if (fRunning) return;
+
+    fRunning = true;
+    fInterrupted = false;
+    const int nThreads = std::max(1, std::min(GetNumCores() - 1, MAX_BLOCK_PREVALIDATION_THREADS));
+    for (int i = 0; i < nThreads; i++) {
+        vThreads.emplace_back(&TraceThread<std::function<void()>>, "blockcheck",
+                              std::bind(&CBlockPreValidator::ThreadPreValidate, this));
+    }
+}
+
+void CBlockPreValidator::Interrupt()
+{
+    LOCK(cs);
+    fInterrupted = true;
+    condWork.notify_all();
+}
+
+void CBlockPreValidator::Stop()
+{
+    {
+        LOCK(cs);
+        // blocks arriving from now on are processed by the message handler again
+        fRunning = false;
+        fInterrupted = true;
+        condWork.notify_all();
+    }
+
+    for (std::thread& thread : vThreads) {
+        thread.join();
+    }
+    vThreads.clear();
+
+    // dropped blocks are still in flight, they are requested again after a restart
+    std::deque<std::shared_ptr<CJob>> queueDropped;
+    {
+        LOCK(cs);
+        queueDropped.swap(queueJobs);
+        nNextCheck = 0;
+        fCommitting = false;
+        fInterrupted = false;
+    }
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKPREVALIDATOR_H
+#define BITCOIN_BLOCKPREVALIDATOR_H
+
+#include <primitives/block.h>
+#include <sync.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/** Maximum number of threads checking received blocks */
+static const int MAX_BLOCK_PREVALIDATION_THREADS = 8;
+/** Number of blocks waiting to be checked or committed, further blocks are refused */
+static const size_t MAX_BLOCK_PREVALIDATION_QUEUE = 256;
+
+class CBlockPreValidator;
+
+extern CBlockPreValidator blockPreValidator;
+
+//
+// Runs the context-free checks of received blocks (CheckBlock: header, block signature,
+// merkle root, transactions and sigops) on worker threads, outside cs_main. Each block is
+// then committed by its callback, one block at a time and in the order the blocks were
+// submitted, so a parent is still processed before its child. ProcessNewBlock finds a
+// block that passed its checks marked as such and only does the contextual work under
+// cs_main. Results are handed from the checking thread to the committing one under the
+// lock of the queue.
+//
+class CBlockPreValidator
+{
+private:
+    struct CJob
+    {
+        std::shared_ptr<const CBlock> pblock;
+        uint256 hash;
+        std::function<void()> commit;
+        bool fChecked;
+    };
+
+    mutable Mutex cs;
+    // a block can be checked or committed
+    std::condition_variable condWork;
+    std::deque<std::shared_ptr<CJob>> queueJobs GUARDED_BY(cs);
+    // the jobs before this one were taken by a checking thread
+    size_t nNextCheck GUARDED_BY(cs);
+    bool fCommitting GUARDED_BY(cs);
+    // the block of the job being committed
+    uint256 hashCommitting GUARDED_BY(cs);
+    bool fRunning GUARDED_BY(cs);
+    bool fInterrupted GUARDED_BY(cs);
+
+    std::vector<std::thread> vThreads;
+
+    bool CanCommit() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void ThreadPreValidate();
+
+public:
+    CBlockPreValidator();
+    ~CBlockPreValidator();
+
+    /// Queue a block to be checked and then committed by calling commit. Never waits.
+    /// When the threads are not running nothing can be queued ahead of the block and
+    /// it is committed on the caller's thread. False when the block was refused because
+    /// the pre-validator is interrupted or its queue is full; the block is dropped
+    /// rather than processed ahead of the blocks in the queue.
+    bool Submit(const std::shared_ptr<const CBlock>& pblock, std::function<void()> commit);
+    /// Whether the block is waiting to be checked or committed, or being committed.
+    /// A child submitted after it is committed after it.
+    bool Contains(const uint256& hash) const;
+    size_t size() const;
+
+    void Start();
+    void Interrupt();
+    /// Stop the threads and drop the blocks that were not committed yet. Blocks
+    /// submitted afterwards are committed on the caller's thread.
+    void Stop();
+};
+
+#endif // BITCOIN_BLOCKPREVALIDATOR_H
@@ -60,16 +60,16 @@ bool CBlockSigner::SignBlock()
     return result;
 }
 
-bool CBlockSigner::CheckBlockSignature() const
+bool CheckBlockSignature(const CBlock& block)
 {
-    if(refBlock.IsProofOfWork())
+    if(block.IsProofOfWork())
         return true;
 
-    if(refBlock.vchBlockSig.empty())
+    if(block.vchBlockSig.empty())
         return false;
 
-    const CTxOut& txout = refBlock.vtx[1]->vout[1];
-    auto hashMessage = refBlock.GetHash();
+    const CTxOut& txout = block.vtx[1]->vout[1];
+    auto hashMessage = block.GetHash();
 
     std::vector<std::vector<unsigned char>> vSolutions;
     txnouttype whichType = Solver(txout.scriptPubKey, vSolutions);
@@ -78,7 +78,7 @@ bool CBlockSigner::CheckBlockSignature() const
     if(whichType == TX_PUBKEY)
     {
         CPubKey pubkey(vSolutions[0]);
-        bool isValid = pubkey.IsValid() && pubkey.Verify(hashMessage, refBlock.vchBlockSig);
+        bool isValid = pubkey.IsValid() && pubkey.Verify(hashMessage, block.vchBlockSig);
         if(isValid)
         {
             return true;
@@ -92,10 +92,15 @@ bool CBlockSigner::CheckBlockSignature() const
     }
 
     std::string strError;
-    bool result = CHashSigner::VerifyHash(hashMessage, destination, refBlock.vchBlockSig, strError);
+    bool result = CHashSigner::VerifyHash(hashMessage, destination, block.vchBlockSig, strError);
     if(!result)
     {
         LogPrintf("CBlockSigner::CheckBlockSignature() : Failed to verify hash, %s\n", strError);
     }
     return result;
 }
+
+bool CBlockSigner::CheckBlockSignature() const
+{
+    return ::CheckBlockSignature(refBlock);
+}
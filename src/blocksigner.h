@@ -7,6 +7,9 @@ class CPubKey;
 class CKey;
 class CKeyStore;
 
+/** Check the signature of a proof-of-stake block, without the copy a CBlockSigner needs */
+bool CheckBlockSignature(const CBlock& block);
+
 struct CBlockSigner {
 
     CBlockSigner(CBlock &block, const CKeyStore *keystore);
@@ -182,9 +182,6 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
-    //ppcoin: trust score of block chain
-    uint256 bnChainTrust;
-
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
@@ -243,13 +240,8 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax;
 
-    uint256 nAccumulatorCheckpoint;
-
-    //! zerocoin specific fields, left only for legacy reasons
-    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
-    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
-
-    std::vector<uint256> vLotteryWinnersCoinstakes;
+    //! The lottery winners (GetLotteryWinners) and the zerocoin legacy fields are
+    //! only stored in CDiskBlockIndex, keeping every entry of mapBlockIndex small
 
     void SetNull()
     {
@@ -281,8 +273,6 @@ public:
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
-
-        vLotteryWinnersCoinstakes.clear();
     }
 
     CBlockIndex()
@@ -301,7 +291,6 @@ public:
         nNonce         = block.nNonce;
 
         //Proof of Stake
-        bnChainTrust = uint256();
         nMint = 0;
         nMoneySupply = 0;
         nFlags = 0;
@@ -318,8 +307,6 @@ public:
             prevoutStake.SetNull();
             nStakeTime = 0;
         }
-
-        vLotteryWinnersCoinstakes.clear();
     }
 
     CDiskBlockPos GetBlockPos() const {
@@ -489,6 +476,13 @@ class CDiskBlockIndex : public CBlockIndex
 public:
     uint256 hashPrev;
 
+    std::vector<uint256> vLotteryWinnersCoinstakes;
+
+    //! zerocoin specific fields of pre-segwit blocks, left only for legacy reasons
+    uint256 nAccumulatorCheckpoint;
+    std::map<libzerocoin::CoinDenomination, int64_t> mapZerocoinSupply;
+    std::vector<libzerocoin::CoinDenomination> vMintDenominationsInBlock;
+
     CDiskBlockIndex() {
         hashPrev = uint256();
     }
@@ -303,86 +303,43 @@ bool stakeTargetHit(uint256 hashProofOfStake, uint64_t nValueIn, arith_uint256 b
     return (UintToArith256(hashProofOfStake) < bnCoinDayWeight * bnTargetPerCoinDay);
 }
 
-//instead of looping outside and reinitializing variables many times, we will give a nTimeTx and also search interval so that we can do all the hashing here
-static bool CheckStakeKernelHashV2(unsigned int nBlockHeight,
-                                   unsigned int nBits, const CBlock blockFrom, const CTransaction &txPrev,
-                                   const COutPoint prevout, unsigned int& nTimeTx,
-                                   unsigned int nHashDrift, bool fCheck, uint256& hashProofOfStake, bool fPrintProofOfStake)
+// The V2 kernel hash of prevout with the stake modifier of the block it comes from.
+// Tries nTimeTx and the nHashDrift - 1 seconds before it, and sets nTimeTx to the
+// time that meets the target.
+static bool CheckStakeKernelHashV2(uint64_t nStakeModifier, unsigned int nBits, unsigned int nTimeBlockFrom, CAmount nValueIn,
+                                   const COutPoint& prevout, unsigned int& nTimeTx, unsigned int nHashDrift, uint256& hashProofOfStake)
 {
-    //assign new variables to make it easier to read
-    int64_t nValueIn = txPrev.vout[prevout.n].nValue;
-    unsigned int nTimeBlockFrom = blockFrom.GetBlockTime();
-
     if (nTimeTx < nTimeBlockFrom) // Transaction timestamp violation
         return error("CheckStakeKernelHash() : nTime violation");
 
     if (nTimeBlockFrom + nStakeMinAge > nTimeTx) // Min age requirement
         return error("CheckStakeKernelHash() : min age violation - nTimeBlockFrom=%d nStakeMinAge=%d nTimeTx=%d", nTimeBlockFrom, nStakeMinAge, nTimeTx);
 
+    // the times tried must all meet the min age
+    nHashDrift = std::min(nHashDrift, nTimeTx - (nTimeBlockFrom + nStakeMinAge) + 1);
+
     //grab difficulty
     arith_uint256 bnTargetPerCoinDay;
     bnTargetPerCoinDay.SetCompact(nBits);
 
-    //grab stake modifier
-    uint64_t nStakeModifier = 0;
-    int nStakeModifierHeight = 0;
-    int64_t nStakeModifierTime = 0;
-    if (!GetKernelStakeModifier(blockFrom.GetHash(), nBlockHeight, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake)) {
-        LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier\n");
-        return false;
-    }
-
     //create data stream once instead of repeating it in the loop
     CDataStream ss(SER_GETHASH, 0);
     ss << nStakeModifier;
 
-    //get the stake weight - weight is equal to coin amount
-    int64_t nTimeWeight = std::min<int64_t>(nTimeTx - nTimeBlockFrom, nStakeMaxAge - nStakeMinAge);
-
-    //if wallet is simply checking to make sure a hash is valid
-    if (fCheck) {
-        hashProofOfStake = stakeHash(nTimeTx, ss, prevout.n, prevout.hash, nTimeBlockFrom);
-        return stakeTargetHit(hashProofOfStake, nValueIn, bnTargetPerCoinDay, nTimeWeight);
-    }
-
-    bool fSuccess = false;
-    unsigned int nTryTime = 0;
-    int nHeightStart = chainActive.Height();
     for (unsigned int i = 0; i < nHashDrift; i++) //iterate the hashing
     {
-        //new block came in, move on
-        if (chainActive.Height() != nHeightStart)
-            break;
-
-        //hash this iteration
-        nTryTime = nTimeTx - i;
+        unsigned int nTryTime = nTimeTx - i;
+        //get the stake weight of the time that is hashed, which is what a check of the kernel found uses
+        int64_t nTimeWeight = std::min<int64_t>(nTryTime - nTimeBlockFrom, nStakeMaxAge - nStakeMinAge);
         hashProofOfStake = stakeHash(nTryTime, ss, prevout.n, prevout.hash, nTimeBlockFrom);
-
-        // if stake hash does not meet the target then continue to next iteration
-        if (!stakeTargetHit(hashProofOfStake, nValueIn, bnTargetPerCoinDay, nTimeWeight))
-            continue;
-
-        fSuccess = true; // if we make it this far then we have successfully created a stake hash
-        nTimeTx = nTryTime;
-
-        if (fPrintProofOfStake) {
-            LogPrintf("CheckStakeKernelHash() : using modifier %s at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
-                      boost::lexical_cast<std::string>(nStakeModifier).c_str(), nStakeModifierHeight,
-                      DateTimeStrFormat("%Y-%m-%d %H:%M:%S", nStakeModifierTime).c_str(),
-                      mapBlockIndex[blockFrom.GetHash()]->nHeight,
-                    DateTimeStrFormat("%Y-%m-%d %H:%M:%S", blockFrom.GetBlockTime()).c_str());
-            LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=%s nTimeBlockFrom=%u prevoutHash=%s nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
-                      "0.3",
-                      boost::lexical_cast<std::string>(nStakeModifier).c_str(),
-                      nTimeBlockFrom, prevout.hash.ToString().c_str(), nTimeBlockFrom, prevout.n, nTryTime,
-                      hashProofOfStake.ToString().c_str());
+        if (stakeTargetHit(hashProofOfStake, nValueIn, bnTargetPerCoinDay, nTimeWeight))
+        {
+            nTimeTx = nTryTime;
+            return true;
         }
-        break;
     }
 
-    mapHashedBlocks.clear();
-    mapHashedBlocks[chainActive.Tip()->nHeight] = GetTime(); //store a time stamp of when we last hashed on this block
-    return fSuccess;
+    return false;
 }
 
 // BlackCoin kernel protocol
@@ -404,7 +361,7 @@ static bool CheckStakeKernelHashV2(unsigned int nBlockHeight,
 //   quantities so as to generate blocks faster, degrading the system back into
 //   a proof-of-work situation.
 //
-static bool CheckStakeKernelHashV3(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t blockFromTime, CAmount prevoutValue, const COutPoint& prevout, unsigned int nTimeBlock, uint256& hashProofOfStake, bool fPrintProofOfStake)
+static bool CheckStakeKernelHashV3(const uint256& nStakeModifier, unsigned int nBits, uint32_t blockFromTime, CAmount prevoutValue, const COutPoint& prevout, unsigned int nTimeBlock, uint256& hashProofOfStake, bool fPrintProofOfStake)
 {
     if (nTimeBlock < blockFromTime)  // Transaction timestamp violation
         return error("%s : nTime violation", __func__);
@@ -421,8 +378,6 @@ static bool CheckStakeKernelHashV3(CBlockIndex* pindexPrev, unsigned int nBits,
     arith_uint256 bnWeight = arith_uint256(nValueIn);
     bnTarget *= bnWeight;
 
-    uint256 nStakeModifier = pindexPrev->hashStakeModifierV3;
-
     // Calculate hash
     CDataStream ss(SER_GETHASH, 0);
     ss << nStakeModifier;
@@ -450,8 +405,10 @@ static bool CheckStakeKernelHashV3(CBlockIndex* pindexPrev, unsigned int nBits,
 }
 
 // Check kernel hash target and coinstake signature
-bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake)
+bool CheckProofOfStake(const CBlock &block, const CBlockIndex* pindexPrev, const CCoinsViewCache& view, uint256& hashProofOfStake)
 {
+    AssertLockHeld(cs_main);
+
     const CTransactionRef &tx = block.vtx[1];
     if (!tx->IsCoinStake())
         return error("CheckProofOfStake() : called on non-coinstake %s", tx->GetHash().ToString().c_str());
@@ -463,32 +420,30 @@ bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake)
     // Kernel (input 0) must match the stake hash target per coin age (nBits)
     const CTxIn& txin = tx->vin[0];
 
-    // First try finding the previous transaction in database
-    uint256 hashBlock;
-    CTransactionRef txPrev;
-    if (!GetTransaction(txin.prevout.hash, txPrev, Params().GetConsensus(), hashBlock, true))
-        return error("CheckProofOfStake() : INFO: read txPrev failed");
+    // The coins view is at pindexPrev, it has everything the stake inputs need
+    // without a transaction index or reading the blocks they come from
+    const Coin &coinKernel = view.AccessCoin(txin.prevout);
+    if (coinKernel.IsSpent())
+        return error("CheckProofOfStake() : kernel input %s is spent or unknown", txin.prevout.ToString());
 
-    const CScript &kernelScript = txPrev->vout[txin.prevout.n].scriptPubKey;
+    const CTxOut txoutKernel = coinKernel.out;
+    const int nHeightBlockFrom = coinKernel.nHeight;
     bool hasMinStakeAmount = false;
 
     auto nValidInputs = std::count_if(std::begin(tx->vin), std::end(tx->vin),
-                                      [&kernelScript, &hasMinStakeAmount](const CTxIn &txIn) {
-        CTransactionRef txPrev;
-        uint256 hashBlock;
-        if(GetTransaction(txIn.prevout.hash, txPrev, Params().GetConsensus(), hashBlock, true)) {
-            auto transactionOut = txPrev->vout[txIn.prevout.n];
-
-            if (!hasMinStakeAmount && transactionOut.nValue >= MIN_STAKING_AMOUNT)
-                hasMinStakeAmount = true;
+                                      [&view, &txoutKernel, &hasMinStakeAmount](const CTxIn &txIn) {
+        const Coin &coin = view.AccessCoin(txIn.prevout);
+        if (coin.IsSpent())
+            return false;
 
-            return transactionOut.scriptPubKey == kernelScript;
-        }
+        if (!hasMinStakeAmount && coin.out.nValue >= MIN_STAKING_AMOUNT)
+            hasMinStakeAmount = true;
 
-        return false;
+        return coin.out.scriptPubKey == txoutKernel.scriptPubKey;
     });
 
-    if (!hasMinStakeAmount && ShouldCheckForMinStakeAmount(chainActive.Tip()->nHeight + 1, Params().GetConsensus()))
+    const int nBlockHeight = pindexPrev->nHeight + 1;
+    if (!hasMinStakeAmount && ShouldCheckForMinStakeAmount(nBlockHeight, Params().GetConsensus()))
         return error("CheckProofOfStake() : Amount of stake less than the required minimum of %d.", MIN_STAKING_AMOUNT);
 
     if(nValidInputs != tx->vin.size()) {
@@ -496,29 +451,18 @@ bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake)
     }
 
     //verify signature and script
-    CTxOut prevTxOut = txPrev->vout[txin.prevout.n];
-    if (!VerifyScript(txin.scriptSig, txPrev->vout[txin.prevout.n].scriptPubKey, &txin.scriptWitness, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(tx.get(), 0, prevTxOut.nValue)))
+    if (!VerifyScript(txin.scriptSig, txoutKernel.scriptPubKey, &txin.scriptWitness, STANDARD_SCRIPT_VERIFY_FLAGS, TransactionSignatureChecker(tx.get(), 0, txoutKernel.nValue)))
         return error("CheckProofOfStake() : VerifySignature failed on coinstake %s", tx->GetHash().ToString().c_str());
 
-    CBlockIndex* pindex = NULL;
-    BlockMap::iterator it = mapBlockIndex.find(hashBlock);
-    if (it != mapBlockIndex.end())
-        pindex = it->second;
-    else
-        return error("CheckProofOfStake() : read block failed");
-
-    // Read block header
-    CBlock blockprev;
-    if (!ReadBlockFromDisk(blockprev, pindex->GetBlockPos(), Params().GetConsensus()))
-        return error("CheckProofOfStake(): INFO: failed to find block");
-
-
-    auto fIt = mapBlockIndex.find(block.GetHash()); // we will use this value to determine how long we should scan for stake modifier.
-    unsigned int nBlockHeight = fIt != std::end(mapBlockIndex) ? fIt->second->nHeight : chainActive.Tip()->nHeight + 1;
+    // The kernel was created on the branch pindexPrev belongs to, which is not
+    // necessarily chainActive while a reorg is connecting blocks
+    const CBlockIndex* pindexFrom = pindexPrev->GetAncestor(nHeightBlockFrom);
+    if (!pindexFrom)
+        return error("CheckProofOfStake() : kernel block at height %d not found", nHeightBlockFrom);
 
     unsigned int nInterval = 0;
     unsigned int nTime = block.nTime;
-    if (!CheckStakeKernelHash(mapBlockIndex[block.hashPrevBlock], block.nBits, blockprev, *txPrev, txin.prevout, nBlockHeight, nTime, nInterval, true, hashProofOfStake, false))
+    if (!CheckStakeKernelHash(pindexPrev, block.nBits, pindexFrom, txoutKernel.nValue, txin.prevout, nBlockHeight, nTime, nInterval, true, hashProofOfStake, false))
         return error("CheckProofOfStake() : INFO: check kernel failed on coinstake %s, hashProof=%s \n", tx->GetHash().ToString().c_str(), hashProofOfStake.ToString().c_str()); // may occur during initial download or if behind on block chain sync
 
     return true;
@@ -593,10 +537,62 @@ bool ComputeAndSetStakeModifier(CBlockIndex *pindexNew, const Consensus::Params
     return true;
 }
 
-bool CheckStakeKernelHash(CBlockIndex *pindexPrev, unsigned int nBits, const CBlock &blockFrom, const CTransaction &txPrev, const COutPoint prevout, unsigned int nBlockHeight, unsigned int &nTimeTx, unsigned int nHashDrift, bool fCheck, uint256 &hashProofOfStake, bool fPrintProofOfStake)
+bool CheckStakeKernelHash(const CBlockIndex *pindexPrev, unsigned int nBits, const CBlockIndex *pindexFrom, CAmount nValueIn, const COutPoint prevout, unsigned int nBlockHeight, unsigned int &nTimeTx, unsigned int nHashDrift, bool fCheck, uint256 &hashProofOfStake, bool fPrintProofOfStake)
 {
+    if (IsWitnessEnabled(pindexPrev->nHeight + 1, Params().GetConsensus()))
+        return CheckStakeKernelHashV3(pindexPrev->hashStakeModifierV3, nBits, pindexFrom->nTime, nValueIn, prevout, nTimeTx, hashProofOfStake, fPrintProofOfStake);
+
+    //grab stake modifier
+    uint64_t nStakeModifier = 0;
+    int nStakeModifierHeight = 0;
+    int64_t nStakeModifierTime = 0;
+    if (!GetKernelStakeModifier(pindexFrom->GetBlockHash(), nBlockHeight, nStakeModifier, nStakeModifierHeight, nStakeModifierTime, fPrintProofOfStake)) {
+        LogPrintf("CheckStakeKernelHash(): failed to get kernel stake modifier\n");
+        return false;
+    }
+
+    //if wallet is simply checking to make sure a hash is valid, only nTimeTx is hashed
+    if (!CheckStakeKernelHashV2(nStakeModifier, nBits, pindexFrom->GetBlockTime(), nValueIn, prevout, nTimeTx, fCheck ? 1 : nHashDrift, hashProofOfStake))
+        return false;
+
+    if (fPrintProofOfStake) {
+        LogPrintf("CheckStakeKernelHash() : using modifier %s at height=%d timestamp=%s for block from height=%d timestamp=%s\n",
+                  boost::lexical_cast<std::string>(nStakeModifier).c_str(), nStakeModifierHeight,
+                  DateTimeStrFormat("%Y-%m-%d %H:%M:%S", nStakeModifierTime).c_str(),
+                  pindexFrom->nHeight,
+                  DateTimeStrFormat("%Y-%m-%d %H:%M:%S", pindexFrom->GetBlockTime()).c_str());
+        LogPrintf("CheckStakeKernelHash() : pass protocol=%s modifier=%s nTimeBlockFrom=%u prevoutHash=%s nTimeTxPrev=%u nPrevout=%u nTimeTx=%u hashProof=%s\n",
+                  "0.3",
+                  boost::lexical_cast<std::string>(nStakeModifier).c_str(),
+                  pindexFrom->GetBlockTime(), prevout.hash.ToString().c_str(), pindexFrom->GetBlockTime(), prevout.n, nTimeTx,
+                  hashProofOfStake.ToString().c_str());
+    }
     return true;
-    return IsWitnessEnabled(pindexPrev->nHeight + 1, Params().GetConsensus()) ?
-                CheckStakeKernelHashV3(pindexPrev, nBits, blockFrom.nTime, txPrev.vout[prevout.n].nValue, prevout, nTimeTx, hashProofOfStake, fPrintProofOfStake) :
-                CheckStakeKernelHashV2(nBlockHeight, nBits, blockFrom, txPrev, prevout, nTimeTx, nHashDrift, fCheck, hashProofOfStake, fPrintProofOfStake);
+}
+
+void CStakeKernelContext::Init(const CBlockIndex *pindexPrevIn, unsigned int nBitsIn)
+{
+    AssertLockHeld(cs_main);
+    pindexPrev = pindexPrevIn;
+    nHeight = pindexPrev->nHeight + 1;
+    nBits = nBitsIn;
+    fModifierV3 = IsWitnessEnabled(nHeight, Params().GetConsensus());
+    hashStakeModifierV3 = pindexPrev->hashStakeModifierV3;
+
+    LOCK(g_best_block_mutex);
+    hashBestBlock = g_best_block;
+}
+
+bool CStakeKernelContext::IsStale() const
+{
+    LOCK(g_best_block_mutex);
+    return g_best_block != hashBestBlock;
+}
+
+bool CheckStakeKernelHash(const CStakeKernelContext &context, uint32_t nTimeBlockFrom, uint64_t nStakeModifier, CAmount nValueIn, const COutPoint &prevout, unsigned int &nTimeTx, unsigned int nHashDrift, uint256 &hashProofOfStake)
+{
+    if (context.fModifierV3)
+        return CheckStakeKernelHashV3(context.hashStakeModifierV3, context.nBits, nTimeBlockFrom, nValueIn, prevout, nTimeTx, hashProofOfStake, false);
+
+    return CheckStakeKernelHashV2(nStakeModifier, context.nBits, nTimeBlockFrom, nValueIn, prevout, nTimeTx, nHashDrift, hashProofOfStake);
 }
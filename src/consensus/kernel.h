@@ -21,12 +21,33 @@ static const int MODIFIER_INTERVAL_RATIO = 3;
 
 bool ComputeAndSetStakeModifier(CBlockIndex *pindexNew, const Consensus::Params &consensus);
 
+// Chain state that a stake kernel search on top of pindexPrev depends on.
+// It is captured under cs_main so that the search itself can run without
+// holding any global lock.
+struct CStakeKernelContext
+{
+    const CBlockIndex* pindexPrev = nullptr;
+    int nHeight = 0;
+    unsigned int nBits = 0;
+    bool fModifierV3 = false;
+    uint256 hashStakeModifierV3;
+    // g_best_block at the time the context was captured
+    uint256 hashBestBlock;
+
+    void Init(const CBlockIndex* pindexPrevIn, unsigned int nBitsIn) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    // True once the chain tip has moved since Init(), does not take cs_main
+    bool IsStale() const;
+};
+
+// The stake modifier used to hash for a stake kernel before the V3 modifier
+bool GetKernelStakeModifier(uint256 hashBlockFrom, unsigned int nMaxHeight, uint64_t& nStakeModifier, int& nStakeModifierHeight, int64_t& nStakeModifierTime, bool fPrintProofOfStake) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 // Check whether stake kernel meets hash target
 // Sets hashProofOfStake on success return
-bool CheckStakeKernelHash(CBlockIndex *pindexPrev,
+bool CheckStakeKernelHash(const CBlockIndex *pindexPrev,
                           unsigned int nBits,
-                          const CBlock &blockFrom,
-                          const CTransaction &txPrev,
+                          const CBlockIndex *pindexFrom,
+                          CAmount nValueIn,
                           const COutPoint prevout,
                           unsigned int nBlockHeight,
                           unsigned int& nTimeTx,
@@ -35,9 +56,23 @@ bool CheckStakeKernelHash(CBlockIndex *pindexPrev,
                           uint256& hashProofOfStake,
                           bool fPrintProofOfStake = false);
 
-// Check kernel hash target and coinstake signature
+// Check whether stake kernel meets hash target using only the state captured
+// in context, does not need cs_main. nStakeModifier is the kernel stake
+// modifier of the coin and is only used before the V3 modifier is active.
+// Sets hashProofOfStake and the matching nTimeTx on success return
+bool CheckStakeKernelHash(const CStakeKernelContext& context,
+                          uint32_t nTimeBlockFrom,
+                          uint64_t nStakeModifier,
+                          CAmount nValueIn,
+                          const COutPoint& prevout,
+                          unsigned int& nTimeTx,
+                          unsigned int nHashDrift,
+                          uint256& hashProofOfStake);
+
+// Check kernel hash target and coinstake signature against the coins view
+// of pindexPrev, the stake inputs must still be unspent in view
 // Sets hashProofOfStake on success return
-bool CheckProofOfStake(const CBlock &block, uint256& hashProofOfStake);
+bool CheckProofOfStake(const CBlock &block, const CBlockIndex* pindexPrev, const CCoinsViewCache& view, uint256& hashProofOfStake) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 // Check whether the coinstake timestamp meets protocol
 bool CheckCoinStakeTimestamp(int64_t nTimeBlock, int64_t nTimeTx);
@@ -171,6 +171,13 @@ public:
         return piter->value().size();
     }
 
+    /** Copy the value out without decoding it, so it can be decoded later or on another thread */
+    void GetValueStream(CDataStream& ssValue) {
+        leveldb::Slice slValue = piter->value();
+        ssValue = CDataStream(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+    }
+
 };
 
 class CDBWrapper
@@ -0,0 +1,329 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+#include <chainparams.h>
+#include <hash.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <map>
+
+constexpr char DB_ADDRESSINDEX = 'a';
+constexpr char DB_ADDRESSUNSPENTINDEX = 'u';
+constexpr char DB_ADDRESSBALANCE = 'b';
+/// Hash of the last block whose balance changes were applied. Balances are not
+/// idempotent, so this is written in the same batch as every block's entries.
+constexpr char DB_BALANCE_TIP = 'T';
+
+std::unique_ptr<AddressIndex> g_addressindex;
+
+bool GetAddressIndexKey(const CScript& script, uint160& hashBytes, unsigned int& type)
+{
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin() + 2, script.begin() + 22));
+        type = ADDRESS_TYPE_SCRIPTHASH;
+    } else if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin() + 3, script.begin() + 23));
+        type = ADDRESS_TYPE_PUBKEYHASH;
+    } else if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin() + 1, script.end() - 1);
+        type = ADDRESS_TYPE_PUBKEYHASH;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Access to the addressindex database (indexes/addressindex/)
+ *
+ * The database stores three key spaces per address: the history of every
+ * output received and spent, ordered by height and position in block; the
+ * currently unspent outputs; and the running balance.
+ */
+class AddressIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+AddressIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "addressindex", n_cache_size, f_memory, f_wipe)
+{}
+
+AddressIndex::AddressIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<AddressIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+AddressIndex::~AddressIndex() {}
+
+using BalanceKey = std::pair<unsigned int, uint160>;
+using BalanceDeltas = std::map<BalanceKey, CAddressBalanceValue>;
+
+/** Queue the index entries of the inputs of transaction i of a block into the batch. */
+static void ApplyTxInputs(CDBBatch& batch, BalanceDeltas& deltas, const CTransaction& tx, unsigned int i,
+                          const CTxUndo& tx_undo, int height, bool fUndo)
+{
+    uint160 hashBytes;
+    unsigned int type;
+    const uint256& txhash = tx.GetHash();
+
+    for (unsigned int j = 0; j < tx.vin.size(); ++j) {
+        const COutPoint& prevout = tx.vin[j].prevout;
+        const Coin& coin = tx_undo.vprevout[j];
+        if (!GetAddressIndexKey(coin.out.scriptPubKey, hashBytes, type)) continue;
+
+        const auto history_key = std::make_pair(DB_ADDRESSINDEX,
+            CAddressIndexKey(type, hashBytes, height, i, txhash, j, true));
+        const auto unspent_key = std::make_pair(DB_ADDRESSUNSPENTINDEX,
+            CAddressUnspentKey(type, hashBytes, prevout.hash, prevout.n));
+        CAddressBalanceValue& delta = deltas[BalanceKey(type, hashBytes)];
+        if (fUndo) {
+            batch.Erase(history_key);
+            batch.Write(unspent_key, CAddressUnspentValue(coin.out.nValue, coin.out.scriptPubKey, coin.nHeight));
+            delta.balance += coin.out.nValue;
+        } else {
+            batch.Write(history_key, -coin.out.nValue);
+            batch.Erase(unspent_key);
+            delta.balance -= coin.out.nValue;
+        }
+    }
+}
+
+/** Queue the index entries of the outputs of transaction i of a block into the batch. */
+static void ApplyTxOutputs(CDBBatch& batch, BalanceDeltas& deltas, const CTransaction& tx, unsigned int i,
+                           int height, bool fUndo)
+{
+    uint160 hashBytes;
+    unsigned int type;
+    const uint256& txhash = tx.GetHash();
+
+    for (unsigned int k = 0; k < tx.vout.size(); ++k) {
+        const CTxOut& out = tx.vout[k];
+        if (!GetAddressIndexKey(out.scriptPubKey, hashBytes, type)) continue;
+
+        const auto history_key = std::make_pair(DB_ADDRESSINDEX,
+            CAddressIndexKey(type, hashBytes, height, i, txhash, k, false));
+        const auto unspent_key = std::make_pair(DB_ADDRESSUNSPENTINDEX,
+            CAddressUnspentKey(type, hashBytes, txhash, k));
+        CAddressBalanceValue& delta = deltas[BalanceKey(type, hashBytes)];
+        if (fUndo) {
+            batch.Erase(history_key);
+            batch.Erase(unspent_key);
+            delta.balance -= out.nValue;
+            delta.received -= out.nValue;
+        } else {
+            batch.Write(history_key, out.nValue);
+            batch.Write(unspent_key, CAddressUnspentValue(out.nValue, out.scriptPubKey, height));
+            delta.balance += out.nValue;
+            delta.received += out.nValue;
+        }
+    }
+}
+
+/**
+ * Queue the index entries for one block into the batch. With fUndo set the
+ * entries are removed again and the balance changes are reversed, walking the
+ * block backwards like DisconnectBlock, so an output spent in the block that
+ * created it is not left behind as unspent.
+ */
+static void ApplyBlock(CDBBatch& batch, BalanceDeltas& deltas, const CBlock& block,
+                       const CBlockUndo& block_undo, int height, bool fUndo)
+{
+    for (unsigned int n = 0; n < block.vtx.size(); ++n) {
+        const unsigned int i = fUndo ? block.vtx.size() - 1 - n : n;
+        const CTransaction& tx = *block.vtx[i];
+
+        if (fUndo) {
+            ApplyTxOutputs(batch, deltas, tx, i, height, fUndo);
+        }
+        if (i > 0) {
+            ApplyTxInputs(batch, deltas, tx, i, block_undo.vtxundo[i - 1], height, fUndo);
+        }
+        if (!fUndo) {
+            ApplyTxOutputs(batch, deltas, tx, i, height, fUndo);
+        }
+    }
+}
+
+/** Fold accumulated balance changes into the stored balances. */
+static bool WriteBalances(const CDBWrapper& db, CDBBatch& batch, const BalanceDeltas& deltas)
+{
+    for (const auto& entry : deltas) {
+        const auto key = std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(entry.first.first, entry.first.second));
+        CAddressBalanceValue value;
+        if (db.Exists(key) && !db.Read(key, value)) {
+            return error("%s: failed to read balance of address %s", __func__, entry.first.second.ToString());
+        }
+        value.balance += entry.second.balance;
+        value.received += entry.second.received;
+        if (value.IsNull()) {
+            batch.Erase(key);
+        } else {
+            batch.Write(key, value);
+        }
+    }
+    return true;
+}
+
+static bool ReadBlockAndUndo(const CBlockIndex* pindex, CBlock& block, CBlockUndo& block_undo)
+{
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+        return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+    }
+    if (pindex->nHeight > 0 && !UndoReadFromDisk(block_undo, pindex)) {
+        return error("%s: failed to read undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    return true;
+}
+
+bool AddressIndex::ReadBalanceTip(const CBlockIndex*& balance_tip) const
+{
+    uint256 hash;
+    balance_tip = nullptr;
+    if (!m_db->Exists(DB_BALANCE_TIP)) return true;
+    if (!m_db->Read(DB_BALANCE_TIP, hash)) {
+        return error("%s: failed to read balance tip", __func__);
+    }
+    LOCK(cs_main);
+    balance_tip = LookupBlockIndex(hash);
+    if (!balance_tip) {
+        return error("%s: balance tip %s not found in the block index", __func__, hash.ToString());
+    }
+    return true;
+}
+
+bool AddressIndex::RewindBalances(const CBlockIndex* balance_tip, const CBlockIndex* new_tip)
+{
+    assert(balance_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    BalanceDeltas deltas;
+    for (const CBlockIndex* pindex = balance_tip; pindex != new_tip; pindex = pindex->pprev) {
+        if (pindex->nHeight == 0) continue;
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockAndUndo(pindex, block, block_undo)) return false;
+        ApplyBlock(batch, deltas, block, block_undo, pindex->nHeight, true);
+    }
+    if (!WriteBalances(*m_db, batch, deltas)) return false;
+    batch.Write(DB_BALANCE_TIP, new_tip->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    const CBlockIndex* balance_tip;
+    if (!ReadBalanceTip(balance_tip)) return false;
+
+    if (balance_tip) {
+        // The best block locator is committed behind the balances, so after a
+        // crash the blocks up to the balance tip are replayed; they are applied.
+        if (balance_tip->GetAncestor(pindex->nHeight) == pindex) {
+            return true;
+        }
+        // A crash during a reorg may have left the balances on the old branch
+        if (pindex->pprev && balance_tip != pindex->pprev &&
+            balance_tip->GetAncestor(pindex->pprev->nHeight) == pindex->pprev &&
+            !RewindBalances(balance_tip, pindex->pprev)) {
+            return false;
+        }
+        if (pindex->pprev && balance_tip->GetAncestor(pindex->pprev->nHeight) != pindex->pprev) {
+            return error("%s: balances are at block %s; expected %s",
+                         __func__, balance_tip->GetBlockHash().ToString(), pindex->pprev->GetBlockHash().ToString());
+        }
+    }
+
+    CDBBatch batch(*m_db);
+    if (pindex->nHeight > 0) {
+        CBlockUndo block_undo;
+        if (!UndoReadFromDisk(block_undo, pindex)) {
+            return error("%s: failed to read undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+        BalanceDeltas deltas;
+        ApplyBlock(batch, deltas, block, block_undo, pindex->nHeight, false);
+        if (!WriteBalances(*m_db, batch, deltas)) return false;
+    }
+    batch.Write(DB_BALANCE_TIP, pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // The balances may be ahead of current_tip, which is only the committed
+    // best block locator; undo from where they actually are.
+    const CBlockIndex* balance_tip;
+    if (!ReadBalanceTip(balance_tip)) return false;
+    if (balance_tip && balance_tip->GetAncestor(new_tip->nHeight) != new_tip) {
+        return error("%s: balances are at block %s, which does not descend from %s",
+                     __func__, balance_tip->GetBlockHash().ToString(), new_tip->GetBlockHash().ToString());
+    }
+    if (balance_tip && !RewindBalances(balance_tip, new_tip)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& AddressIndex::GetDB() const { return *m_db; }
+
+bool AddressIndex::ForEachAddressDelta(unsigned int type, const uint160& hashBytes, int start, int end,
+                                       const std::function<bool(const CAddressIndexKey&, CAmount)>& fn) const
+{
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+
+    if (start > 0) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, hashBytes, start)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, hashBytes)));
+    }
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX ||
+            key.second.type != type || key.second.hashBytes != hashBytes) {
+            break;
+        }
+        if (end > 0 && key.second.blockHeight > end) {
+            break;
+        }
+        CAmount value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s: failed to get address index value", __func__);
+        }
+        if (!fn(key.second, value)) break;
+    }
+    return true;
+}
+
+bool AddressIndex::ForEachAddressUnspent(unsigned int type, const uint160& hashBytes,
+                                         const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn) const
+{
+    std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, hashBytes)));
+
+    for (; pcursor->Valid(); pcursor->Next()) {
+        std::pair<char, CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX ||
+            key.second.type != type || key.second.hashBytes != hashBytes) {
+            break;
+        }
+        CAddressUnspentValue value;
+        if (!pcursor->GetValue(value)) {
+            return error("%s: failed to get address unspent value", __func__);
+        }
+        if (!fn(key.second, value)) break;
+    }
+    return true;
+}
+
+bool AddressIndex::GetAddressBalance(unsigned int type, const uint160& hashBytes, CAddressBalanceValue& balance) const
+{
+    const auto key = std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, hashBytes));
+    balance.SetNull();
+    return !m_db->Exists(key) || m_db->Read(key, balance);
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <spentindex.h>
+
+#include <functional>
+
+/** Address types used as the first field of every address index key. */
+enum AddressIndexType : unsigned int {
+    ADDRESS_TYPE_NONE = 0,
+    ADDRESS_TYPE_PUBKEYHASH = 1,
+    ADDRESS_TYPE_SCRIPTHASH = 2,
+};
+
+/**
+ * Extract the indexed address of an output script. Pay-to-pubkey outputs are
+ * indexed under the hash of their public key. Returns false for scripts that
+ * are not indexed.
+ */
+bool GetAddressIndexKey(const CScript& script, uint160& hashBytes, unsigned int& type);
+
+/**
+ * AddressIndex is used to look up the transaction history, unspent outputs
+ * and balance of addresses. Unlike the transaction index it is not written
+ * from ConnectBlock; it catches up with the active chain in the background
+ * from block and undo data, and rewinds itself over reorgs.
+ */
+class AddressIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Look up the block the balances were last updated to, nullptr if they never were.
+    bool ReadBalanceTip(const CBlockIndex*& balance_tip) const;
+
+    /// Reverse the balance changes of the blocks from balance_tip back to new_tip.
+    bool RewindBalances(const CBlockIndex* balance_tip, const CBlockIndex* new_tip);
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "addressindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~AddressIndex() override;
+
+    /// Visit the history entries of an address in key order (height, position in block).
+    /// A non-positive start or end height leaves that side of the range open. Iteration
+    /// stops early when the visitor returns false.
+    bool ForEachAddressDelta(unsigned int type, const uint160& hashBytes, int start, int end,
+                             const std::function<bool(const CAddressIndexKey&, CAmount)>& fn) const;
+
+    /// Visit the unspent outputs of an address. Iteration stops early when the visitor returns false.
+    bool ForEachAddressUnspent(unsigned int type, const uint160& hashBytes,
+                               const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn) const;
+
+    /// Look up the running balance and total received amount of an address.
+    bool GetAddressBalance(unsigned int type, const uint160& hashBytes, CAddressBalanceValue& balance) const;
+};
+
+/// The global address index, used by the address RPCs. May be null.
+extern std::unique_ptr<AddressIndex> g_addressindex;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
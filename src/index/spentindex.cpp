@@ -0,0 +1,144 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+#include <chainparams.h>
+#include <index/addressindex.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+constexpr char DB_SPENTINDEX = 'p';
+constexpr char DB_WRITTEN_TIP = 'T';
+
+std::unique_ptr<SpentIndex> g_spentindex;
+
+/**
+ * Access to the spentindex database (indexes/spentindex/)
+ */
+class SpentIndex::DB : public BaseIndex::DB
+{
+public:
+    explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+};
+
+SpentIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
+    BaseIndex::DB(GetDataDir() / "indexes" / "spentindex", n_cache_size, f_memory, f_wipe)
+{}
+
+SpentIndex::SpentIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<SpentIndex::DB>(n_cache_size, f_memory, f_wipe))
+{}
+
+SpentIndex::~SpentIndex() {}
+
+bool SpentIndex::ReadWrittenTip(const CBlockIndex*& written_tip) const
+{
+    uint256 hash;
+    written_tip = nullptr;
+    if (!m_db->Exists(DB_WRITTEN_TIP)) return true;
+    if (!m_db->Read(DB_WRITTEN_TIP, hash)) {
+        return error("%s: failed to read written tip", __func__);
+    }
+    LOCK(cs_main);
+    written_tip = LookupBlockIndex(hash);
+    if (!written_tip) {
+        return error("%s: written tip %s not found in the block index", __func__, hash.ToString());
+    }
+    return true;
+}
+
+bool SpentIndex::EraseSpends(const CBlockIndex* written_tip, const CBlockIndex* new_tip)
+{
+    assert(written_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // Outputs spent by disconnected blocks are unspent again on the new chain.
+    CDBBatch batch(*m_db);
+    for (const CBlockIndex* pindex = written_tip; pindex != new_tip; pindex = pindex->pprev) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        }
+        for (unsigned int i = 1; i < block.vtx.size(); ++i) {
+            for (const CTxIn& txin : block.vtx[i]->vin) {
+                batch.Erase(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(txin.prevout.hash, txin.prevout.n)));
+            }
+        }
+    }
+    batch.Write(DB_WRITTEN_TIP, new_tip->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (pindex->nHeight == 0) return true;
+
+    const CBlockIndex* written_tip;
+    if (!ReadWrittenTip(written_tip)) return false;
+
+    if (written_tip) {
+        // The best block locator is committed behind the entries, so after a
+        // crash the blocks up to the written tip are replayed; they are written.
+        if (written_tip->GetAncestor(pindex->nHeight) == pindex) {
+            return true;
+        }
+        // The entries may be of blocks that were disconnected while the index
+        // was not running; erase them back to where the branches meet.
+        const CBlockIndex* fork = LastCommonAncestor(written_tip, pindex->pprev);
+        if (fork != written_tip && !EraseSpends(written_tip, fork)) {
+            return false;
+        }
+    }
+
+    CBlockUndo block_undo;
+    if (!UndoReadFromDisk(block_undo, pindex)) {
+        return error("%s: failed to read undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    CDBBatch batch(*m_db);
+    for (unsigned int i = 1; i < block.vtx.size(); ++i) {
+        const CTransaction& tx = *block.vtx[i];
+        const CTxUndo& tx_undo = block_undo.vtxundo[i - 1];
+        for (unsigned int j = 0; j < tx.vin.size(); ++j) {
+            const COutPoint& prevout = tx.vin[j].prevout;
+            const Coin& coin = tx_undo.vprevout[j];
+            uint160 hashBytes;
+            unsigned int type;
+            if (!GetAddressIndexKey(coin.out.scriptPubKey, hashBytes, type)) {
+                type = ADDRESS_TYPE_NONE;
+            }
+            batch.Write(std::make_pair(DB_SPENTINDEX, CSpentIndexKey(prevout.hash, prevout.n)),
+                        CSpentIndexValue(tx.GetHash(), j, pindex->nHeight, coin.out.nValue, type, hashBytes));
+        }
+    }
+    batch.Write(DB_WRITTEN_TIP, pindex->GetBlockHash());
+    return m_db->WriteBatch(batch);
+}
+
+bool SpentIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    // The entries may be ahead of current_tip, which is only the committed
+    // best block locator; erase from where they actually are. Databases
+    // written before the tip was recorded are at current_tip.
+    const CBlockIndex* written_tip;
+    if (!ReadWrittenTip(written_tip)) return false;
+    if (!written_tip) written_tip = current_tip;
+    if (written_tip->GetAncestor(new_tip->nHeight) != new_tip) {
+        return error("%s: entries are written up to block %s, which does not descend from %s",
+                     __func__, written_tip->GetBlockHash().ToString(), new_tip->GetBlockHash().ToString());
+    }
+    if (!EraseSpends(written_tip, new_tip)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+BaseIndex::DB& SpentIndex::GetDB() const { return *m_db; }
+
+bool SpentIndex::GetSpentInfo(const CSpentIndexKey& key, CSpentIndexValue& value) const
+{
+    return m_db->Read(std::make_pair(DB_SPENTINDEX, key), value);
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <chain.h>
+#include <index/base.h>
+#include <spentindex.h>
+
+/**
+ * SpentIndex is used to look up the transaction that spent an output. The
+ * index is written to a LevelDB database in the background and maps every
+ * spent outpoint to the spending input, its height, value and address.
+ */
+class SpentIndex final : public BaseIndex
+{
+protected:
+    class DB;
+
+private:
+    const std::unique_ptr<DB> m_db;
+
+    /// Look up the block the entries were last written for, nullptr if it was never recorded.
+    bool ReadWrittenTip(const CBlockIndex*& written_tip) const;
+
+    /// Erase the entries of the blocks from written_tip back to new_tip.
+    bool EraseSpends(const CBlockIndex* written_tip, const CBlockIndex* new_tip);
+
+protected:
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override;
+
+    const char* GetName() const override { return "spentindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    // Destructor is declared because this class contains a unique_ptr to an incomplete type.
+    virtual ~SpentIndex() override;
+
+    /// Look up the input that spent an output.
+    ///
+    /// @param[in]   key  The outpoint of the spent output.
+    /// @param[out]  value  The spending transaction, input index, height, value and address.
+    /// @return  true if the output is indexed as spent, false otherwise
+    bool GetSpentInfo(const CSpentIndexKey& key, CSpentIndexValue& value) const;
+};
+
+/// The global spent index, used by getspentinfo. May be null.
+extern std::unique_ptr<SpentIndex> g_spentindex;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
@@ -57,6 +57,8 @@ protected:
 
     const char* GetName() const override { return "txindex"; }
 
+    bool IsWrittenByValidation() const override { return true; }
+
 public:
     /// Constructs the index, which becomes available to be queried.
     explicit TxIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
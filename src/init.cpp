@@ -11,6 +11,7 @@
 
 #include <addrman.h>
 #include <amount.h>
+#include <blockprevalidator.h>
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpoints.h>
@@ -21,7 +22,11 @@
 #include <httpserver.h>
 #include <httprpc.h>
 #include <interfaces/chain.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
+#include <kernelscanner.h>
 #include <key.h>
 #include <validation.h>
 #include <miner.h>
@@ -55,7 +60,10 @@
 #include <netfulfilledman.h>
 #include <sporkdb.h>
 #include <messagesigner.h>
+#include <masternodes/masternode-lastpaid.h>
 #include <masternodes/masternode-payments.h>
+#include <masternodes/masternode-db.h>
+#include <masternodes/masternode-verifier.h>
 #include <masternodes/masternodeman.h>
 #include <masternodes/activemasternode.h>
 #include <masternodes/masternodeconfig.h>
@@ -163,29 +171,32 @@ void Interrupt()
     InterruptMapPort();
     if (g_connman)
         g_connman->Interrupt();
+    masternodeVerifier.Interrupt();
+    blockPreValidator.Interrupt();
     if (g_txindex) {
         g_txindex->Interrupt();
     }
+    if (g_addressindex) {
+        g_addressindex->Interrupt();
+    }
+    if (g_spentindex) {
+        g_spentindex->Interrupt();
+    }
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
 }
 
-static bool LoadExtensionsDataCaches()
+/** Move the masternode list and payment votes of the cache files into the masternode database */
+static bool ImportMasternodeCacheFiles(bool fClearMasternodeCache)
 {
-    // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
-
     boost::filesystem::path pathDB = GetDataDir();
     std::string strDBName;
 
     strDBName = "mncache.dat";
-    uiInterface.InitMessage(_("Loading masternode cache..."));
-    if(gArgs.GetBoolArg("-clearmncache", false))
-    {
-        boost::system::error_code ec;
-        boost::filesystem::remove((pathDB / strDBName).string(), ec);
-    }
-
-    CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
-    if(!flatdb1.Load(mnodeman)) {
-        return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
+    if (!fClearMasternodeCache) {
+        CFlatDB<CMasternodeMan> flatdb1(strDBName, "magicMasternodeCache");
+        if(!flatdb1.Load(mnodeman)) {
+            return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / strDBName).string());
+        }
     }
 
     if(mnodeman.size()) {
@@ -195,8 +206,45 @@ static bool LoadExtensionsDataCaches()
         if(!flatdb2.Load(masternodePayments)) {
             return InitError(_("Failed to load masternode payments cache from") + "\n" + (pathDB / strDBName).string());
         }
-    } else {
-        uiInterface.InitMessage(_("Masternode cache is empty, skipping payments and governance cache..."));
+    }
+
+    std::vector<CMasternodePaymentWinner> vVotes;
+    {
+        LOCK(cs_mapMasternodePayeeVotes);
+        for (const auto& entry : masternodePayments.mapMasternodePayeeVotes)
+            vVotes.push_back(entry.second);
+    }
+    if (!pmasternodedb->WriteMasternodes(mnodeman.GetFullMasternodeVector()) ||
+        !pmasternodedb->WritePaymentVotes(vVotes) ||
+        !pmasternodedb->WriteVersion(MASTERNODE_DB_VERSION)) {
+        return InitError(_("Failed to write the masternode database"));
+    }
+    LogPrintf("Imported %u masternodes and %u payment votes into the masternode database\n", mnodeman.size(), vVotes.size());
+
+    boost::system::error_code ec;
+    boost::filesystem::remove(pathDB / "mncache.dat", ec);
+    boost::filesystem::remove(pathDB / "mnpayments.dat", ec);
+    return true;
+}
+
+static bool LoadExtensionsDataCaches()
+{
+    // LOAD SERIALIZED DAT FILES INTO DATA CACHES FOR INTERNAL USE
+
+    boost::filesystem::path pathDB = GetDataDir();
+    std::string strDBName;
+
+    // The masternode list and payment votes are kept in the masternode database, entry by entry
+    uiInterface.InitMessage(_("Loading masternode cache..."));
+    const bool fClearMasternodeCache = gArgs.GetBoolArg("-clearmncache", false);
+    pmasternodedb.reset(new CMasternodeDB(MASTERNODE_DB_CACHE_SIZE, false, fClearMasternodeCache));
+
+    int nVersion = 0;
+    if (!pmasternodedb->ReadVersion(nVersion)) {
+        // first start with the database, or a cleared one
+        if (!ImportMasternodeCacheFiles(fClearMasternodeCache)) return false;
+    } else if (!mnodeman.Load(*pmasternodedb) || !masternodePayments.Load(*pmasternodedb)) {
+        return InitError(_("Failed to load masternode cache from") + "\n" + (pathDB / "masternodes").string());
     }
 
     strDBName = "netfulfilled.dat";
@@ -270,10 +318,7 @@ static void LockMasternodeOutputs()
 static void StoreExtensionsDataCaches()
 {
     // STORE DATA CACHES INTO SERIALIZED DAT FILES
-    CFlatDB<CMasternodeMan> flatdb1("mncache.dat", "magicMasternodeCache");
-    flatdb1.Dump(mnodeman);
-    CFlatDB<CMasternodePayments> flatdb2("mnpayments.dat", "magicMasternodePaymentsCache");
-    flatdb2.Dump(masternodePayments);
+    // the masternode list and payment votes were written to the masternode database as they changed
     CFlatDB<CNetFulfilledRequestManager> flatdb3("netfulfilled.dat", "magicFulfilledCache");
     flatdb3.Dump(netfulfilledman);
 }
@@ -304,9 +349,16 @@ void Shutdown(InitInterfaces& interfaces)
 
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
+    // queued blocks hold references to their nodes and are processed with the peer logic
+    blockPreValidator.Stop();
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
+    // queued masternode messages hold references to their nodes
+    masternodeVerifier.Stop();
     if (g_connman) g_connman->Stop();
     if (g_txindex) g_txindex->Stop();
+    if (g_addressindex) g_addressindex->Stop();
+    if (g_spentindex) g_spentindex->Stop();
+    ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
 
     StoreExtensionsDataCaches();
 
@@ -322,6 +374,9 @@ void Shutdown(InitInterfaces& interfaces)
     peerLogic.reset();
     g_connman.reset();
     g_txindex.reset();
+    g_addressindex.reset();
+    g_spentindex.reset();
+    DestroyAllBlockFilterIndexes();
 
     if (g_is_mempool_loaded && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -364,6 +419,7 @@ void Shutdown(InitInterfaces& interfaces)
         pcoinsdbview.reset();
         pblocktree.reset();
     }
+    pmasternodedb.reset();
     for (const auto& client : interfaces.chain_clients) {
         client->stop();
     }
@@ -496,7 +552,12 @@ void SetupServerArgs()
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), false, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-addressindex", strprintf("Maintain a full address index, used to query unspent outputs for addresses (default: %u)", DEFAULT_ADDRESSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-addressindex", strprintf("Maintain a full address index, used to query the history, balance and unspent outputs of addresses (default: %u)", DEFAULT_ADDRESSINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-spentindex", strprintf("Maintain a full spent index, used to query the spending input of outputs by the getspentinfo rpc call (default: %u)", DEFAULT_SPENTINDEX), false, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-blockfilterindex=<type>",
+                 strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
+                 " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
+                 false, OptionsCategory::OPTIONS);
 
     gArgs.AddArg("-addnode=<ip>", "Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info). This option can be specified multiple times to add multiple nodes.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-banscore=<n>", strprintf("Threshold for disconnecting misbehaving peers (default: %u)", DEFAULT_BANSCORE_THRESHOLD), false, OptionsCategory::CONNECTION);
@@ -519,6 +580,7 @@ void SetupServerArgs()
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), false, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-port=<port>", strprintf("Listen for connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultChainParams->GetDefaultPort(), testnetChainParams->GetDefaultPort(), regtestChainParams->GetDefaultPort()), false, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", false, OptionsCategory::CONNECTION);
@@ -548,19 +610,35 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubhashstake=<address>", "Enable publish hash of blocks staked by this node in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawmasternode=<address>", "Enable publish raw masternode list changes in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawmnvote=<address>", "Enable publish raw masternode payment votes in <address>", false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawspork=<address>", "Enable publish raw spork messages in <address>", false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubhashstakehwm=<n>", strprintf("Set publish hash stake outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawmasternodehwm=<n>", strprintf("Set publish raw masternode outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawmnvotehwm=<n>", strprintf("Set publish raw masternode payment vote outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubrawsporkhwm=<n>", strprintf("Set publish raw spork outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), false, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
+    hidden_args.emplace_back("-zmqpubhashstake=<address>");
+    hidden_args.emplace_back("-zmqpubrawmasternode=<address>");
+    hidden_args.emplace_back("-zmqpubrawmnvote=<address>");
+    hidden_args.emplace_back("-zmqpubrawspork=<address>");
     hidden_args.emplace_back("-zmqpubhashblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubhashstakehwm=<n>");
+    hidden_args.emplace_back("-zmqpubrawmasternodehwm=<n>");
+    hidden_args.emplace_back("-zmqpubrawmnvotehwm=<n>");
+    hidden_args.emplace_back("-zmqpubrawsporkhwm=<n>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), true, OptionsCategory::DEBUG_TEST);
@@ -635,6 +713,8 @@ void SetupServerArgs()
     gArgs.AddArg("-server", "Accept command line and JSON-RPC commands", false, OptionsCategory::RPC);
     gArgs.AddArg("-printstakemodifier", "Prints kernel stake modifiers", false, OptionsCategory::DEBUG_TEST);
     gArgs.AddArg("-staking", "Enabled or disables staking, (default: 1)", false, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-stakethreads=<n>", strprintf("Set the number of stake kernel search threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+                                                -GetNumCores(), MAX_STAKE_KERNEL_THREADS, DEFAULT_STAKE_KERNEL_THREADS), false, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-masternode=<n>", strprintf(_("Enable the client to act as a masternode (0-1, default: %u)"), 0), false, OptionsCategory::MASTERNODE);
     gArgs.AddArg("-mnconf=<file>", strprintf(_("Specify masternode configuration file (default: %s)"), "masternode.conf"), false, OptionsCategory::MASTERNODE);
     gArgs.AddArg("-mnconflock=<n>", strprintf(_("Lock masternodes from masternode configuration file (default: %u)"), 1), false, OptionsCategory::MASTERNODE);
@@ -783,9 +863,6 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
             pblocktree->WriteReindexing(false);
             fReindex = false;
             LogPrintf("Reindexing finished\n");
-
-            // Init setting for -addressindex in the new database
-            InitAddressIndex();
             // To avoid ending up in a situation without genesis block, re-try initializing (no-op if reindexing worked):
             LoadGenesisBlock(chainparams);
         }
@@ -990,6 +1067,7 @@ int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_NETWORK_LIMITED);
+std::set<BlockFilterType> g_enabled_filter_types;
 int64_t peer_connect_timeout;
 
 } // namespace
@@ -1068,10 +1146,41 @@ bool AppInitParameterInteraction()
         return InitError(strprintf(_("Specified blocks directory \"%s\" does not exist."), gArgs.GetArg("-blocksdir", "").c_str()));
     }
 
+    // parse and validate enabled filter types
+    std::string blockfilterindex_value = gArgs.GetArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    if (blockfilterindex_value == "" || blockfilterindex_value == "1") {
+        g_enabled_filter_types = AllBlockFilterTypes();
+    } else if (blockfilterindex_value != "0") {
+        const std::vector<std::string> names = gArgs.GetArgs("-blockfilterindex");
+        for (const auto& name : names) {
+            BlockFilterType filter_type;
+            if (!BlockFilterTypeByName(name, filter_type)) {
+                return InitError(strprintf(_("Unknown -blockfilterindex value %s."), name));
+            }
+            g_enabled_filter_types.insert(filter_type);
+        }
+    }
+
+    // Signal NODE_COMPACT_FILTERS if peerblockfilters and basic filters index are both enabled.
+    if (gArgs.GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        if (g_enabled_filter_types.count(BlockFilterType::BASIC) != 1) {
+            return InitError(_("Cannot set -peerblockfilters without -blockfilterindex."));
+        }
+
+        nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
+    }
+
     // if using block pruning, then disallow txindex
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex."));
+        if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))
+            return InitError(_("Prune mode is incompatible with -spentindex."));
+        if (!g_enabled_filter_types.empty()) {
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
+        }
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1544,6 +1653,17 @@ bool AppInitMain(InitInterfaces& interfaces)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= nTxIndexCache;
+    int64_t nAddressIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? nMaxAddressIndexCache << 20 : 0);
+    nTotalCache -= nAddressIndexCache;
+    int64_t nSpentIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ? nMaxSpentIndexCache << 20 : 0);
+    nTotalCache -= nSpentIndexCache;
+    int64_t filter_index_cache = 0;
+    if (!g_enabled_filter_types.empty()) {
+        size_t n_indexes = g_enabled_filter_types.size();
+        int64_t max_cache = std::min(nTotalCache / 8, max_filter_index_cache << 20);
+        filter_index_cache = max_cache / n_indexes;
+        nTotalCache -= filter_index_cache * n_indexes;
+    }
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1554,6 +1674,16 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1fMiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        LogPrintf("* Using %.1fMiB for address index database\n", nAddressIndexCache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        LogPrintf("* Using %.1fMiB for spent index database\n", nSpentIndexCache * (1.0 / 1024 / 1024));
+    }
+    for (BlockFilterType filter_type : g_enabled_filter_types) {
+        LogPrintf("* Using %.1fMiB for %s block filter index database\n",
+                  filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
+    }
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1622,9 +1752,6 @@ bool AppInitMain(InitInterfaces& interfaces)
                     break;
                 }
 
-                // Init setting for -addressindex in the new database
-                InitAddressIndex();
-
                 // At this point blocktree args are consistent with what's on disk.
                 // If we're not mid-reindex (based on disk + args), add a genesis block on disk
                 // (otherwise we use the one already on disk).
@@ -1738,6 +1865,21 @@ bool AppInitMain(InitInterfaces& interfaces)
         return false;
     }
 
+    // The address, spent and block filter indexes sync in the background from the loaded chain
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_addressindex = MakeUnique<AddressIndex>(nAddressIndexCache, false, fReindex);
+        g_addressindex->Start();
+    }
+    if (gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spentindex = MakeUnique<SpentIndex>(nSpentIndexCache, false, fReindex);
+        g_spentindex->Start();
+    }
+
+    for (const auto& filter_type : g_enabled_filter_types) {
+        InitBlockFilterIndex(filter_type, filter_index_cache, false, fReindex);
+        GetBlockFilterIndex(filter_type)->Start();
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -1824,12 +1966,20 @@ bool AppInitMain(InitInterfaces& interfaces)
     LoadExtensionsDataCaches();
     LoadActiveMasternode();
 
+    // Rebuilt once the masternode list is loaded, which sets how deep it goes. Blocks
+    // still being imported are indexed as they are connected.
+    threadGroup.create_thread(std::bind(&TraceThread<std::function<void()>>, "mnlastpaid",
+                                        [&chainparams] { masternodeLastPaid.Rebuild(chainparams.GetConsensus()); }));
+
     // ********************************************************* Step 11c: start thread for divi extensions
 
     threadGroup.create_thread(boost::bind(net_processing_divi::ThreadProcessExtensions, g_connman.get()));
+    masternodeVerifier.Start(*g_connman);
 
     // ********************************************************* Step 12: start node
 
+    blockPreValidator.Start();
+
     int chain_active_height;
 
     //// debug print
@@ -1922,6 +2072,19 @@ bool AppInitMain(InitInterfaces& interfaces)
 
         if(gArgs.GetBoolArg("-staking", true))
         {
+            // -stakethreads=0 means autodetect, but nStakeKernelThreads==0 means no concurrency
+            nStakeKernelThreads = gArgs.GetArg("-stakethreads", DEFAULT_STAKE_KERNEL_THREADS);
+            if (nStakeKernelThreads <= 0)
+                nStakeKernelThreads += GetNumCores();
+            if (nStakeKernelThreads <= 1)
+                nStakeKernelThreads = 0;
+            else if (nStakeKernelThreads > MAX_STAKE_KERNEL_THREADS)
+                nStakeKernelThreads = MAX_STAKE_KERNEL_THREADS;
+
+            LogPrintf("Using %u threads for stake kernel search\n", nStakeKernelThreads);
+            for (int i = 0; i < nStakeKernelThreads - 1; i++)
+                threadGroup.create_thread(&ThreadStakeKernelCheck);
+
             threadGroup.create_thread(std::bind(&ThreadStakeMinter, boost::ref(chainparams), boost::ref(connman), GetWallets().front().get()));
         }
 
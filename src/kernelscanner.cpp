@@ -0,0 +1,208 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kernelscanner.h>
+
+#include <arith_uint256.h>
+#include <checkqueue.h>
+#include <crypto/common.h>
+#include <hash.h>
+#include <util/system.h>
+
+#include <atomic>
+
+int nStakeKernelThreads = 0;
+
+namespace {
+
+// Kernel hash preimage of one input serialized once, only the trailing
+// nTimeTx field is rewritten between tries.
+//   V3: hashStakeModifierV3 | nBlockFromTime | prevout.hash | prevout.n | nTimeTx
+//   V2: nStakeModifier | nBlockFromTime | prevout.n | prevout.hash | nTimeTx
+class CKernelPreimage
+{
+private:
+    static const size_t MAX_SIZE = 32 + 4 + 32 + 4 + 4;
+
+    unsigned char vch[MAX_SIZE];
+    size_t nSize = 0;
+
+    void WriteUint32(uint32_t n)
+    {
+        WriteLE32(vch + nSize, n);
+        nSize += 4;
+    }
+
+    void WriteUint256(const uint256& hash)
+    {
+        memcpy(vch + nSize, hash.begin(), hash.size());
+        nSize += hash.size();
+    }
+
+public:
+    CKernelPreimage(const CStakeKernelContext& context, const CStakeKernelInput& input)
+    {
+        if (context.fModifierV3) {
+            WriteUint256(context.hashStakeModifierV3);
+            WriteUint32(input.nBlockFromTime);
+            WriteUint256(input.prevout.hash);
+            WriteUint32(input.prevout.n);
+        } else {
+            WriteLE64(vch, input.nStakeModifier);
+            nSize = 8;
+            WriteUint32(input.nBlockFromTime);
+            WriteUint32(input.prevout.n);
+            WriteUint256(input.prevout.hash);
+        }
+        nSize += 4;
+    }
+
+    uint256 Hash(uint32_t nTimeTx)
+    {
+        WriteLE32(vch + nSize - 4, nTimeTx);
+        uint256 hash;
+        CHash256().Write(vch, nSize).Finalize(hash.begin());
+        return hash;
+    }
+};
+
+// State shared by all the checks of one ScanStakeKernels() call
+struct CStakeKernelScan
+{
+    const CStakeKernelContext& context;
+    const std::vector<CStakeKernelInput>& vInputs;
+    const unsigned int nTimeTx;
+    const unsigned int nHashDrift;
+    arith_uint256 bnBaseTarget;
+
+    Mutex cs;
+    bool fFound GUARDED_BY(cs) = false;
+    CStakeKernelResult result GUARDED_BY(cs);
+    std::atomic<bool> fStale{false};
+
+    CStakeKernelScan(const CStakeKernelContext& contextIn, const std::vector<CStakeKernelInput>& vInputsIn, unsigned int nTimeTxIn, unsigned int nHashDriftIn) :
+        context(contextIn), vInputs(vInputsIn), nTimeTx(nTimeTxIn), nHashDrift(nHashDriftIn)
+    {
+        bnBaseTarget.SetCompact(context.nBits);
+    }
+
+    // Mirrors CheckStakeKernelHash(context, ...)
+    bool CheckInput(const CStakeKernelInput& input, unsigned int& nTimeKernel, uint256& hashProofOfStake) const
+    {
+        if (nTimeTx < input.nBlockFromTime || input.nBlockFromTime + nStakeMinAge > nTimeTx)
+            return false;
+
+        CKernelPreimage preimage(context, input);
+        if (context.fModifierV3) {
+            const arith_uint256 bnTarget = bnBaseTarget * arith_uint256(input.nValue);
+            hashProofOfStake = preimage.Hash(nTimeTx);
+            nTimeKernel = nTimeTx;
+            return UintToArith256(hashProofOfStake) <= bnTarget;
+        }
+
+        const unsigned int nDrift = std::min(nHashDrift, nTimeTx - (input.nBlockFromTime + nStakeMinAge) + 1);
+        for (unsigned int i = 0; i < nDrift; i++) {
+            const unsigned int nTryTime = nTimeTx - i;
+            const int64_t nTimeWeight = std::min<int64_t>(nTryTime - input.nBlockFromTime, nStakeMaxAge - nStakeMinAge);
+            const arith_uint256 bnCoinDayWeight = arith_uint256((uint64_t)input.nValue) * nTimeWeight / COIN / 400;
+            hashProofOfStake = preimage.Hash(nTryTime);
+            if (UintToArith256(hashProofOfStake) < bnCoinDayWeight * bnBaseTarget) {
+                nTimeKernel = nTryTime;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Hashes the inputs [nBegin, nEnd) of a scan. Fails once a kernel was found
+// or the tip moved, which makes the queue skip all the remaining checks.
+class CStakeKernelCheck
+{
+private:
+    CStakeKernelScan* scan = nullptr;
+    size_t nBegin = 0;
+    size_t nEnd = 0;
+
+public:
+    CStakeKernelCheck() {}
+    CStakeKernelCheck(CStakeKernelScan* scanIn, size_t nBeginIn, size_t nEndIn) : scan(scanIn), nBegin(nBeginIn), nEnd(nEndIn) {}
+
+    bool operator()()
+    {
+        if (scan->fStale || scan->context.IsStale()) {
+            scan->fStale = true;
+            return false;
+        }
+
+        for (size_t n = nBegin; n < nEnd; n++) {
+            unsigned int nTimeKernel = 0;
+            uint256 hashProofOfStake;
+            if (!scan->CheckInput(scan->vInputs[n], nTimeKernel, hashProofOfStake))
+                continue;
+
+            LOCK(scan->cs);
+            if (!scan->fFound || n < scan->result.nIndex) {
+                scan->fFound = true;
+                scan->result.nIndex = n;
+                scan->result.nTimeTx = nTimeKernel;
+                scan->result.hashProofOfStake = hashProofOfStake;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    void swap(CStakeKernelCheck& check)
+    {
+        std::swap(scan, check.scan);
+        std::swap(nBegin, check.nBegin);
+        std::swap(nEnd, check.nEnd);
+    }
+};
+
+CCheckQueue<CStakeKernelCheck> stakekernelqueue(1);
+
+} // namespace
+
+void ThreadStakeKernelCheck()
+{
+    RenameThread("divi-stakech");
+    stakekernelqueue.Thread();
+}
+
+bool ScanStakeKernels(const CStakeKernelContext& context,
+                      const std::vector<CStakeKernelInput>& vInputs,
+                      unsigned int nTimeTx,
+                      unsigned int nHashDrift,
+                      CStakeKernelResult& result)
+{
+    CStakeKernelScan scan(context, vInputs, nTimeTx, nHashDrift);
+
+    std::vector<CStakeKernelCheck> vChecks;
+    vChecks.reserve((vInputs.size() + STAKE_KERNEL_SCAN_BATCH - 1) / STAKE_KERNEL_SCAN_BATCH);
+    // The queue pops its work from the back, queue the first inputs last
+    for (size_t nEnd = vInputs.size(); nEnd > 0; ) {
+        size_t nBegin = nEnd > STAKE_KERNEL_SCAN_BATCH ? nEnd - STAKE_KERNEL_SCAN_BATCH : 0;
+        vChecks.emplace_back(&scan, nBegin, nEnd);
+        nEnd = nBegin;
+    }
+
+    if (nStakeKernelThreads) {
+        CCheckQueueControl<CStakeKernelCheck> control(&stakekernelqueue);
+        control.Add(vChecks);
+        control.Wait();
+    } else {
+        for (auto it = vChecks.rbegin(); it != vChecks.rend(); ++it) {
+            if (!(*it)())
+                break;
+        }
+    }
+
+    LOCK(scan.cs);
+    if (!scan.fFound)
+        return false;
+    result = scan.result;
+    return true;
+}
@@ -0,0 +1,49 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#ifndef BITCOIN_KERNELSCANNER_H
+#define BITCOIN_KERNELSCANNER_H
+
+#include <consensus/kernel.h>
+
+#include <vector>
+
+static const int DEFAULT_STAKE_KERNEL_THREADS = 0;
+static const int MAX_STAKE_KERNEL_THREADS = 16;
+// Number of inputs hashed by one unit of work of the kernel scan
+static const unsigned int STAKE_KERNEL_SCAN_BATCH = 64;
+
+extern int nStakeKernelThreads;
+
+// Everything the kernel hash of one staking output depends on
+struct CStakeKernelInput
+{
+    COutPoint prevout;
+    CAmount nValue = 0;
+    uint32_t nBlockFromTime = 0;
+    // Kernel stake modifier of the coin, only used before the V3 modifier is active
+    uint64_t nStakeModifier = 0;
+};
+
+struct CStakeKernelResult
+{
+    // Position of the kernel in the scanned inputs
+    size_t nIndex = 0;
+    unsigned int nTimeTx = 0;
+    uint256 hashProofOfStake;
+};
+
+// Worker thread of the stake kernel scan, started with -stakethreads
+void ThreadStakeKernelCheck();
+
+// Hash the kernels of all vInputs on top of context and return one that meets
+// the target. Produces the same hashes as CheckStakeKernelHash(context, ...),
+// but serializes every preimage once and splits the inputs over the
+// ThreadStakeKernelCheck workers. Gives up once the chain tip moves.
+bool ScanStakeKernels(const CStakeKernelContext& context,
+                      const std::vector<CStakeKernelInput>& vInputs,
+                      unsigned int nTimeTx,
+                      unsigned int nHashDrift,
+                      CStakeKernelResult& result) LOCKS_EXCLUDED(cs_main);
+
+#endif // BITCOIN_KERNELSCANNER_H
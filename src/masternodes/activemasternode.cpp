@@ -200,12 +200,13 @@ bool CActiveMasternode::SendMasternodePing(std::string& errorMessage, CConnman &
         }
 
         pmn->lastPing = mnp;
+        mnodeman.Store(*pmn);
         mnodeman.mapSeenMasternodePing.insert(make_pair(mnp.GetHash(), mnp));
 
         //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
         CMasternodeBroadcast mnb(*pmn);
         uint256 hash = mnb.GetHash();
-        if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = mnp;
+        mnodeman.mapSeenMasternodeBroadcast.UpdateLastPing(hash, mnp);
 
         mnp.Relay(connman);
 
@@ -248,7 +249,7 @@ bool CActiveMasternode::Register(CMasternodeBroadcast &mnb, CConnman &connman)
         CMasternode mn(mnb);
         mnodeman.Add(mn);
     } else {
-        pmn->UpdateFromNewBroadcast(mnb, connman);
+        mnodeman.UpdateFromNewBroadcast(*pmn, mnb, connman);
     }
 
     //send to all peers
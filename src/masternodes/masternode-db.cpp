@@ -0,0 +1,108 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-db.h>
+#include <util/system.h>
+
+#include <boost/thread.hpp>
+
+static const char DB_MASTERNODE = 'm';
+static const char DB_PAYMENT_VOTE = 'w';
+static const char DB_VERSION = 'V';
+
+std::unique_ptr<CMasternodeDB> pmasternodedb;
+
+CMasternodeDB::CMasternodeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "masternodes", nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CMasternodeDB::WriteMasternode(const CMasternode& mn)
+{
+    return Write(std::make_pair(DB_MASTERNODE, mn.vin.prevout), mn);
+}
+
+bool CMasternodeDB::EraseMasternode(const COutPoint& outpoint)
+{
+    return Erase(std::make_pair(DB_MASTERNODE, outpoint));
+}
+
+bool CMasternodeDB::WriteMasternodes(const std::vector<CMasternode>& vMasternodes)
+{
+    CDBBatch batch(*this);
+    for (const CMasternode& mn : vMasternodes) {
+        batch.Write(std::make_pair(DB_MASTERNODE, mn.vin.prevout), mn);
+    }
+    return WriteBatch(batch, true);
+}
+
+bool CMasternodeDB::ReadMasternodes(std::vector<CMasternode>& vMasternodes)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_MASTERNODE, COutPoint(uint256(), 0)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, COutPoint> key;
+        if (!pcursor->GetKey(key) || key.first != DB_MASTERNODE) break;
+
+        vMasternodes.emplace_back();
+        if (!pcursor->GetValue(vMasternodes.back())) {
+            return error("%s: failed to read masternode %s", __func__, key.second.ToString());
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CMasternodeDB::WritePaymentVote(const CMasternodePaymentWinner& winner)
+{
+    return Write(std::make_pair(DB_PAYMENT_VOTE, winner.GetHash()), winner);
+}
+
+bool CMasternodeDB::ErasePaymentVotes(const std::vector<uint256>& vHashes)
+{
+    CDBBatch batch(*this);
+    for (const uint256& hash : vHashes) {
+        batch.Erase(std::make_pair(DB_PAYMENT_VOTE, hash));
+    }
+    return WriteBatch(batch);
+}
+
+bool CMasternodeDB::WritePaymentVotes(const std::vector<CMasternodePaymentWinner>& vVotes)
+{
+    CDBBatch batch(*this);
+    for (const CMasternodePaymentWinner& winner : vVotes) {
+        batch.Write(std::make_pair(DB_PAYMENT_VOTE, winner.GetHash()), winner);
+    }
+    return WriteBatch(batch, true);
+}
+
+bool CMasternodeDB::ReadPaymentVotes(std::vector<CMasternodePaymentWinner>& vVotes)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_PAYMENT_VOTE, uint256()));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_PAYMENT_VOTE) break;
+
+        vVotes.emplace_back();
+        if (!pcursor->GetValue(vVotes.back())) {
+            return error("%s: failed to read payment vote %s", __func__, key.second.ToString());
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+bool CMasternodeDB::ReadVersion(int& nVersion)
+{
+    return Read(DB_VERSION, nVersion);
+}
+
+bool CMasternodeDB::WriteVersion(int nVersion)
+{
+    return Write(DB_VERSION, nVersion, true);
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_DB_H
+#define MASTERNODE_DB_H
+
+#include <dbwrapper.h>
+#include <masternodes/masternode.h>
+#include <masternodes/masternode-payments.h>
+#include <uint256.h>
+
+#include <memory>
+#include <vector>
+
+/** Memory allocated to the masternode database cache */
+static const size_t MASTERNODE_DB_CACHE_SIZE = 8 << 20;
+/** Format of the masternode database, written once the database holds the whole state */
+static const int MASTERNODE_DB_VERSION = 1;
+
+class CMasternodeDB;
+
+extern std::unique_ptr<CMasternodeDB> pmasternodedb;
+
+//
+// Access to the masternode database (masternodes/). Masternodes are stored by collateral
+// outpoint and payment votes by hash, one entry each, written as they are added, changed
+// or removed. Entries are not synced to disk one by one: the database log survives a crash
+// of the node, and the list catches up from the network for what the log did not keep.
+//
+class CMasternodeDB : public CDBWrapper
+{
+public:
+    explicit CMasternodeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool WriteMasternode(const CMasternode& mn);
+    bool EraseMasternode(const COutPoint& outpoint);
+    bool WriteMasternodes(const std::vector<CMasternode>& vMasternodes);
+    bool ReadMasternodes(std::vector<CMasternode>& vMasternodes);
+
+    bool WritePaymentVote(const CMasternodePaymentWinner& winner);
+    bool ErasePaymentVotes(const std::vector<uint256>& vHashes);
+    bool WritePaymentVotes(const std::vector<CMasternodePaymentWinner>& vVotes);
+    bool ReadPaymentVotes(std::vector<CMasternodePaymentWinner>& vVotes);
+
+    /// The version is missing until the state was written in full, as after importing the old cache files
+    bool ReadVersion(int& nVersion);
+    bool WriteVersion(int nVersion);
+};
+
+#endif
@@ -0,0 +1,119 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-lastpaid.h>
+#include <masternodes/masternode-payments.h>
+#include <masternodes/masternodeman.h>
+#include <chain.h>
+#include <logging.h>
+#include <shutdown.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <algorithm>
+
+CMasternodeLastPaidIndex masternodeLastPaid;
+
+static void AddPayments(std::map<CScript, std::vector<CMasternodePaidBlock> >& mapPayments, size_t nMaxPayments,
+                        const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus)
+{
+    for (const CScript& payee : GetBlockMasternodePayees(block, pindex->nHeight, consensus)) {
+        std::vector<CMasternodePaidBlock>& vPaid = mapPayments[payee];
+        if (!vPaid.empty() && vPaid.back().nHeight == pindex->nHeight) continue;
+        if (vPaid.size() >= nMaxPayments) vPaid.erase(vPaid.begin());
+        vPaid.push_back(CMasternodePaidBlock{pindex->nHeight, (int64_t)pindex->nTime});
+    }
+}
+
+void CMasternodeLastPaidIndex::AddBlock(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus)
+{
+    AddPayments(mapPayments, MAX_PAYMENTS, block, pindex, consensus);
+    nTipHeight = pindex->nHeight;
+}
+
+void CMasternodeLastPaidIndex::BlockConnected(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus)
+{
+    LOCK(cs);
+    AddBlock(block, pindex, consensus);
+}
+
+void CMasternodeLastPaidIndex::BlockDisconnected(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus)
+{
+    LOCK(cs);
+    for (const CScript& payee : GetBlockMasternodePayees(block, pindex->nHeight, consensus)) {
+        auto it = mapPayments.find(payee);
+        if (it == mapPayments.end()) continue;
+        std::vector<CMasternodePaidBlock>& vPaid = it->second;
+        if (!vPaid.empty() && vPaid.back().nHeight == pindex->nHeight) vPaid.pop_back();
+        if (vPaid.empty()) mapPayments.erase(it);
+    }
+    nTipHeight = pindex->nHeight - 1;
+}
+
+void CMasternodeLastPaidIndex::Rebuild(const Consensus::Params& consensus)
+{
+    int64_t nStart = GetTimeMillis();
+    // as deep as GetLastPaid searches for the whole masternode list
+    const int nDepth = std::max(MASTERNODE_LAST_PAID_DEPTH, (int)(mnodeman.size() * 1.25));
+
+    // The blocks are read without cs_main, which is only taken to walk the chain: the
+    // index is built aside and published once it caught up with the tip
+    std::map<CScript, std::vector<CMasternodePaidBlock> > mapRebuilt;
+    const CBlockIndex* pindexLast = nullptr;
+    size_t nPayees = 0;
+    while (true) {
+        std::vector<const CBlockIndex*> vIndex;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindexTip = chainActive.Tip();
+            if (pindexLast && !chainActive.Contains(pindexLast)) {
+                // reorganized during the rebuild, start over
+                mapRebuilt.clear();
+                pindexLast = nullptr;
+            }
+            if (pindexTip == pindexLast) {
+                LOCK(cs);
+                nPayees = mapRebuilt.size();
+                mapPayments = std::move(mapRebuilt);
+                nTipHeight = pindexTip ? pindexTip->nHeight : 0;
+                break;
+            }
+
+            const CBlockIndex* pindex = pindexLast ? chainActive.Next(pindexLast) : chainActive[std::max(0, pindexTip->nHeight - nDepth + 1)];
+            for (; pindex; pindex = chainActive.Next(pindex))
+                vIndex.push_back(pindex);
+        }
+
+        for (const CBlockIndex* pindex : vIndex) {
+            if (ShutdownRequested()) return;
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, consensus)) {
+                LogPrintf("%s: failed to read block %s, masternode payments before it are not indexed\n", __func__, pindex->GetBlockHash().ToString());
+                mapRebuilt.clear();
+            } else {
+                AddPayments(mapRebuilt, MAX_PAYMENTS, block, pindex, consensus);
+            }
+            pindexLast = pindex;
+        }
+    }
+
+    LogPrintf("Indexed masternode payments of %u payees up to height %d  %dms\n", nPayees, pindexLast ? pindexLast->nHeight : 0, GetTimeMillis() - nStart);
+}
+
+bool CMasternodeLastPaidIndex::GetLastPaid(const CScript& payee, int nDepth, CMasternodePaidBlock& paid) const
+{
+    LOCK(cs);
+    auto it = mapPayments.find(payee);
+    if (it == mapPayments.end() || it->second.empty()) return false;
+    if (nTipHeight - it->second.back().nHeight >= nDepth) return false;
+    paid = it->second.back();
+    return true;
+}
+
+void CMasternodeLastPaidIndex::Clear()
+{
+    LOCK(cs);
+    mapPayments.clear();
+    nTipHeight = 0;
+}
@@ -0,0 +1,66 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_LASTPAID_H
+#define MASTERNODE_LASTPAID_H
+
+#include <script/script.h>
+#include <sync.h>
+
+#include <map>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+
+namespace Consensus {
+struct Params;
+}
+
+class CMasternodeLastPaidIndex;
+
+extern CMasternodeLastPaidIndex masternodeLastPaid;
+
+// Blocks read back from the tip to rebuild the index at startup, at least. With
+// many masternodes it goes as deep as the last-paid search window of the list.
+static const int MASTERNODE_LAST_PAID_DEPTH = 10000;
+
+struct CMasternodePaidBlock
+{
+    int nHeight;
+    int64_t nTime;
+};
+
+//
+// Last block the coinstake of which paid each masternode payee, maintained
+// as the active chain is connected and disconnected
+//
+class CMasternodeLastPaidIndex
+{
+private:
+    // payments kept per payee, so a disconnect can fall back to the previous one
+    static const size_t MAX_PAYMENTS = 4;
+
+    mutable CCriticalSection cs;
+    std::map<CScript, std::vector<CMasternodePaidBlock> > mapPayments;
+    int nTipHeight;
+
+    void AddBlock(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus);
+
+public:
+    CMasternodeLastPaidIndex() : nTipHeight(0) {}
+
+    void BlockConnected(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus);
+    void BlockDisconnected(const CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensus);
+
+    /// Index the last blocks of the active chain again, reading them without cs_main. Needs the masternode list loaded.
+    void Rebuild(const Consensus::Params& consensus);
+
+    /// Last payment to payee within the nDepth blocks up to the tip
+    bool GetLastPaid(const CScript& payee, int nDepth, CMasternodePaidBlock& paid) const;
+
+    void Clear();
+};
+
+#endif
@@ -8,7 +8,9 @@
 #include <chainparamsbase.h>
 #include <consensus/validation.h>
 #include <masternodes/activemasternode.h>
+#include <masternodes/masternode-db.h>
 #include <masternodes/masternode-sync.h>
+#include <masternodes/masternode-verifier.h>
 #include <masternodes/masternodeman.h>
 #include <spork.h>
 #include <sync.h>
@@ -17,6 +19,8 @@
 #include <key_io.h>
 #include <messagesigner.h>
 #include <util/moneystr.h>
+#include <util/time.h>
+#include <validationinterface.h>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include <algorithm>
@@ -86,26 +90,27 @@ static int64_t GetSegwitForkPayment(const Consensus::Params &consensus)
     return consensus.nSegwitHardForkPayment * COIN;
 }
 
-static CScript GetScriptForLotteryPayment(const uint256 &hashWinningCoinstake, const Consensus::Params &consensus)
+CScript GetLotteryPayoutScript(const CTransaction &tx)
 {
-    CTransactionRef coinbaseTx;
-    uint256 hashBlock;
-    assert(GetTransaction(hashWinningCoinstake, coinbaseTx, consensus, hashBlock, true));
-    assert(coinbaseTx->IsCoinBase() || coinbaseTx->IsCoinStake());
+    assert(tx.IsCoinBase() || tx.IsCoinStake());
 
-    if(coinbaseTx->IsCoinBase())
+    if(tx.IsCoinBase())
     {
-        return coinbaseTx->vout[0].scriptPubKey;
+        return tx.vout[0].scriptPubKey;
     }
     else
     {
-        return coinbaseTx->vout[1].scriptPubKey;
+        return tx.vout[1].scriptPubKey;
     }
 }
 
 static void FillLotteryPayment(CMutableTransaction &tx, const CBlockRewards &rewards, const CBlockIndex *currentBlockIndex, const Consensus::Params &consensus)
 {
-    auto lotteryWinners = currentBlockIndex->vLotteryWinnersCoinstakes;
+    auto lotteryWinners = GetLotteryWinners(currentBlockIndex);
+    if (!lotteryWinners) {
+        LogPrintf("%s : Lottery winners of block %s not available\n", __func__, currentBlockIndex->GetBlockHash().ToString());
+        return;
+    }
     // when we call this we need to have exactly 11 winners
 
     auto nLotteryReward = GetLotteryReward(rewards, consensus);
@@ -113,12 +118,11 @@ static void FillLotteryPayment(CMutableTransaction &tx, const CBlockRewards &rew
     auto nSmallReward = nBigReward / 10;
 
     LogPrintf("%s : Paying lottery reward\n", __func__);
-    for(size_t i = 0; i < lotteryWinners.size(); ++i) {
+    for(size_t i = 0; i < lotteryWinners->size(); ++i) {
         CAmount reward = i == 0 ? nBigReward : nSmallReward;
-        const auto &winner = lotteryWinners[i];
-        LogPrintf("%s: Winner: %s\n", __func__, winner.ToString());
-        auto scriptLotteryWinner = GetScriptForLotteryPayment(winner, consensus);
-        tx.vout.emplace_back(reward, scriptLotteryWinner); // pay winners
+        const auto &winner = (*lotteryWinners)[i];
+        LogPrintf("%s: Winner: %s\n", __func__, winner.hashCoinstake.ToString());
+        tx.vout.emplace_back(reward, winner.scriptPayout); // pay winners
     }
 }
 
@@ -127,7 +131,7 @@ static void FillSegwitForkPayment(CMutableTransaction &tx, const Consensus::Para
     tx.vout.emplace_back(GetSegwitForkPayment(consensus), GetScriptForDestination(TreasuryPaymentAddress()));
 }
 
-static bool IsValidLotteryPayment(const CTransaction &tx, int nHeight, const std::vector<WinnerCoinStake> vRequiredWinnersCoinstake, const Consensus::Params &consensus)
+static bool IsValidLotteryPayment(const CTransaction &tx, int nHeight, const std::vector<CLotteryWinner> &vRequiredWinnersCoinstake, const Consensus::Params &consensus)
 {
     if(vRequiredWinnersCoinstake.empty()) {
         return true;
@@ -143,10 +147,9 @@ static bool IsValidLotteryPayment(const CTransaction &tx, int nHeight, const std
     auto nSmallReward = nBigReward / 10;
 
     for(size_t i = 0; i < vRequiredWinnersCoinstake.size(); ++i) {
-        CScript scriptPayment = GetScriptForLotteryPayment(vRequiredWinnersCoinstake[i], consensus);
         CAmount reward = i == 0 ? nBigReward : nSmallReward;
-        if(!verifyPayment(scriptPayment, reward)) {
-            LogPrintf("%s: No payment for winner: %s\n", vRequiredWinnersCoinstake[i].ToString());
+        if(!verifyPayment(vRequiredWinnersCoinstake[i].scriptPayout, reward)) {
+            LogPrintf("%s: No payment for winner: %s\n", __func__, vRequiredWinnersCoinstake[i].hashCoinstake.ToString());
             return false;
         }
     }
@@ -246,7 +249,8 @@ bool IsBlockPayeeValid(const CTransaction &txNew, int nBlockHeight, CBlockIndex
     }
 
     if(IsValidLotteryBlockHeight(nBlockHeight, consensus)) {
-        return IsValidLotteryPayment(txNew, nBlockHeight, prevIndex->vLotteryWinnersCoinstakes, consensus);
+        auto lotteryWinners = GetLotteryWinners(prevIndex);
+        return lotteryWinners && IsValidLotteryPayment(txNew, nBlockHeight, *lotteryWinners, consensus);
     }
 
     if (!masternodeSync.IsSynced()) { //there is no budget data to use to check anything -- find the longest chain
@@ -286,6 +290,36 @@ void FillBlockPayee(CMutableTransaction& txNew, const CBlockRewards &payments, b
     }
 }
 
+std::vector<CScript> GetBlockMasternodePayees(const CBlock& block, int nBlockHeight, const Consensus::Params &consensus)
+{
+    std::vector<CScript> vPayees;
+
+    // only the coinstake pays masternodes, and not on treasury or lottery blocks
+    if (!block.IsProofOfStake() || IsValidTreasuryBlockHeight(nBlockHeight, consensus) || IsValidLotteryBlockHeight(nBlockHeight, consensus))
+        return vPayees;
+
+    const CTransaction& tx = *block.vtx[1];
+    CAmount nMasternodeReward = GetBlockSubsidity(nBlockHeight, consensus).nMasternodeReward;
+    if (nMasternodeReward <= 0) return vPayees;
+
+    // The coinstake is laid out as CreateCoinStake builds it: the empty marker, the outputs
+    // to the staker, then the masternode payment of FillBlockPayee, then the segwit fork
+    // payment on the fork block
+    size_t nPayment = tx.vout.size() - 1;
+    if (IsValidSegwitForkPaymentBlockHeight(nBlockHeight, consensus)) {
+        if (nPayment < 1) return vPayees;
+        nPayment--;
+    }
+
+    // without a masternode to pay the staker outputs come last
+    if (nPayment < 2) return vPayees;
+    const CTxOut& txout = tx.vout[nPayment];
+    if (txout.scriptPubKey != tx.vout[1].scriptPubKey && txout.nValue >= nMasternodeReward)
+        vPayees.push_back(txout.scriptPubKey);
+
+    return vPayees;
+}
+
 std::string GetRequiredPaymentsString(int nBlockHeight)
 {
     return masternodePayments.GetRequiredPaymentsString(nBlockHeight);
@@ -361,49 +395,68 @@ void CMasternodePayments::ProcessMessageMasternodePayments(CNode* pfrom, CValida
             nHeight = chainActive.Tip()->nHeight;
         }
 
-        if (masternodePayments.mapMasternodePayeeVotes.count(winner.GetHash())) {
+        if (masternodePayments.mapMasternodePayeeVotes.count(winner.GetHash()) || masternodeVerifier.IsPending(winner.GetHash())) {
             LogPrint(BCLog::MNPAYMENTS, "mnw - Already seen - %s bestHeight %d\n", winner.GetHash().ToString().c_str(), nHeight);
             masternodeSync.AddedMasternodeWinner(winner.GetHash());
             return;
         }
 
-        int nFirstBlock = nHeight - (mnodeman.CountEnabled() * 1.25);
-        if (winner.nBlockHeight < nFirstBlock || winner.nBlockHeight > nHeight + 20) {
-            LogPrint(BCLog::MNPAYMENTS, "mnw - winner out of range - FirstBlock %d Height %d bestHeight %d\n", nFirstBlock, winner.nBlockHeight, nHeight);
-            return;
-        }
+        // the signature is checked on the verification thread, which applies the vote afterwards
+        if (!masternodeVerifier.AddWinner(pfrom, winner)) ProcessWinner(pfrom, state, winner, connman);
+    }
+}
 
-        std::string strError = "";
-        if (!winner.IsValid(pfrom, strError, connman)) {
-            // if(strError != "") LogPrint(BCLog::MASTERNODE,"mnw - invalid message - %s\n", strError);
-            return;
-        }
+void CMasternodePayments::ProcessWinner(CNode* pfrom, CValidationState& state, CMasternodePaymentWinner& winner, CConnman& connman)
+{
+    int nHeight;
+    {
+        TRY_LOCK(cs_main, locked);
+        if (!locked || chainActive.Tip() == NULL) return;
+        nHeight = chainActive.Tip()->nHeight;
+    }
 
-        if (!masternodePayments.CanVote(winner.vinMasternode.prevout, winner.nBlockHeight)) {
-            //  LogPrint(BCLog::MASTERNODE,"mnw - masternode already voted - %s\n", winner.vinMasternode.prevout.ToStringShort());
-            return;
-        }
+    if (mapMasternodePayeeVotes.count(winner.GetHash())) {
+        LogPrint(BCLog::MNPAYMENTS, "mnw - Already seen - %s bestHeight %d\n", winner.GetHash().ToString().c_str(), nHeight);
+        masternodeSync.AddedMasternodeWinner(winner.GetHash());
+        return;
+    }
 
-        if (!winner.SignatureValid()) {
-            LogPrintf("%s : - invalid signature\n", __func__);
-            if (masternodeSync.IsSynced())
-            {
-                state.DoS(20, false, REJECT_INVALID, "mnget - peer already asked me for the list");
-            }
-            // it could just be a non-synced masternode
-            mnodeman.AskForMN(pfrom, winner.vinMasternode, connman);
-            return;
-        }
+    int nFirstBlock = nHeight - (mnodeman.CountEnabled() * 1.25);
+    if (winner.nBlockHeight < nFirstBlock || winner.nBlockHeight > nHeight + 20) {
+        LogPrint(BCLog::MNPAYMENTS, "mnw - winner out of range - FirstBlock %d Height %d bestHeight %d\n", nFirstBlock, winner.nBlockHeight, nHeight);
+        return;
+    }
 
-        CTxDestination address1;
-        ExtractDestination(winner.payee, address1);
+    std::string strError = "";
+    if (!winner.IsValid(pfrom, strError, connman)) {
+        // if(strError != "") LogPrint(BCLog::MASTERNODE,"mnw - invalid message - %s\n", strError);
+        return;
+    }
 
-        //   LogPrint(BCLog::MNPAYMENTS, "mnw - winning vote - Addr %s Height %d bestHeight %d - %s\n", address2.ToString().c_str(), winner.nBlockHeight, nHeight, winner.vinMasternode.prevout.ToStringShort());
+    if (!CanVote(winner.vinMasternode.prevout, winner.nBlockHeight)) {
+        //  LogPrint(BCLog::MASTERNODE,"mnw - masternode already voted - %s\n", winner.vinMasternode.prevout.ToStringShort());
+        return;
+    }
 
-        if (masternodePayments.AddWinningMasternode(winner)) {
-            winner.Relay(connman);
-            masternodeSync.AddedMasternodeWinner(winner.GetHash());
+    if (!winner.SignatureValid()) {
+        LogPrintf("%s : - invalid signature\n", __func__);
+        if (masternodeSync.IsSynced())
+        {
+            state.DoS(20, false, REJECT_INVALID, "mnget - peer already asked me for the list");
         }
+        // it could just be a non-synced masternode
+        mnodeman.AskForMN(pfrom, winner.vinMasternode, connman);
+        return;
+    }
+
+    CTxDestination address1;
+    ExtractDestination(winner.payee, address1);
+
+    //   LogPrint(BCLog::MNPAYMENTS, "mnw - winning vote - Addr %s Height %d bestHeight %d - %s\n", address2.ToString().c_str(), winner.nBlockHeight, nHeight, winner.vinMasternode.prevout.ToStringShort());
+
+    if (AddWinningMasternode(winner)) {
+        winner.Relay(connman);
+        masternodeSync.AddedMasternodeWinner(winner.GetHash());
     }
 }
 
@@ -412,9 +465,7 @@ bool CMasternodePaymentWinner::Sign(CKey& keyMasternode, CPubKey& pubKeyMasterno
     std::string errorMessage;
     std::string strMasterNodeSignMessage;
 
-    std::string strMessage = vinMasternode.prevout.ToStringShort() +
-            boost::lexical_cast<std::string>(nBlockHeight) +
-            payee.ToString();
+    std::string strMessage = GetSignatureMessage();
 
     if (!CMessageSigner::SignMessage(strMessage, vchSig, keyMasternode, CPubKey::InputScriptType::SPENDP2PKH)) {
         LogPrint(BCLog::MASTERNODE,"CMasternodePing::Sign() - Error: %s\n", errorMessage.c_str());
@@ -484,6 +535,7 @@ bool CMasternodePayments::AddWinningMasternode(const CMasternodePaymentWinner& w
         }
 
         mapMasternodePayeeVotes[winnerIn.GetHash()] = winnerIn;
+        if (pmasternodedb) pmasternodedb->WritePaymentVote(winnerIn);
 
         if (!mapMasternodeBlocks.count(winnerIn.nBlockHeight)) {
             CMasternodeBlockPayees blockPayees(winnerIn.nBlockHeight);
@@ -492,10 +544,32 @@ bool CMasternodePayments::AddWinningMasternode(const CMasternodePaymentWinner& w
     }
 
     mapMasternodeBlocks[winnerIn.nBlockHeight].AddPayee(winnerIn.payee, 1);
+    GetMainSignals().MasternodePaymentVote(winnerIn);
 
     return true;
 }
 
+bool CMasternodePayments::Load(CMasternodeDB& db)
+{
+    const int64_t nStart = GetTimeMillis();
+    std::vector<CMasternodePaymentWinner> vVotes;
+    if (!db.ReadPaymentVotes(vVotes))
+        return false;
+
+    LOCK2(cs_mapMasternodePayeeVotes, cs_mapMasternodeBlocks);
+    // the payees of a block are the count of the votes for them
+    for (const CMasternodePaymentWinner& winner : vVotes) {
+        mapMasternodePayeeVotes[winner.GetHash()] = winner;
+        if (!mapMasternodeBlocks.count(winner.nBlockHeight)) {
+            mapMasternodeBlocks[winner.nBlockHeight] = CMasternodeBlockPayees(winner.nBlockHeight);
+        }
+        mapMasternodeBlocks[winner.nBlockHeight].AddPayee(winner.payee, 1);
+    }
+
+    LogPrintf("Loaded %u masternode payment votes from the masternode database  %dms\n", vVotes.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
 bool CMasternodeBlockPayees::IsTransactionValid(const CTransaction& txNew, const Consensus::Params &consensus)
 {
     LOCK(cs_vecPayments);
@@ -601,6 +675,7 @@ void CMasternodePayments::CheckAndRemove()
     //keep up to five cycles for historical sake
     int nLimit = std::max(int(mnodeman.size() * 1.25), 1000);
 
+    std::vector<uint256> vRemoved;
     std::map<uint256, CMasternodePaymentWinner>::iterator it = mapMasternodePayeeVotes.begin();
     while (it != mapMasternodePayeeVotes.end()) {
         CMasternodePaymentWinner winner = (*it).second;
@@ -608,12 +683,15 @@ void CMasternodePayments::CheckAndRemove()
         if (nHeight - winner.nBlockHeight > nLimit) {
             LogPrint(BCLog::MNPAYMENTS, "CMasternodePayments::CleanPaymentList - Removing old Masternode payment - block %d\n", winner.nBlockHeight);
             masternodeSync.mapSeenSyncMNW.erase((*it).first);
+            vRemoved.push_back((*it).first);
             mapMasternodePayeeVotes.erase(it++);
             mapMasternodeBlocks.erase(winner.nBlockHeight);
         } else {
             ++it;
         }
     }
+
+    if (pmasternodedb && !vRemoved.empty()) pmasternodedb->ErasePaymentVotes(vRemoved);
 }
 
 bool CMasternodePaymentWinner::IsValid(CNode* pnode, std::string& strError, CConnman &connman)
@@ -722,17 +800,20 @@ void CMasternodePaymentWinner::Relay(CConnman &connman)
     connman.RelayInv(inv);
 }
 
+std::string CMasternodePaymentWinner::GetSignatureMessage() const
+{
+    return vinMasternode.prevout.ToStringShort() +
+            boost::lexical_cast<std::string>(nBlockHeight) +
+            payee.ToString();
+}
+
 bool CMasternodePaymentWinner::SignatureValid()
 {
     CMasternode* pmn = mnodeman.Find(vinMasternode);
 
     if (pmn != NULL) {
-        std::string strMessage = vinMasternode.prevout.ToStringShort() +
-                boost::lexical_cast<std::string>(nBlockHeight) +
-                payee.ToString();
-
         std::string errorMessage = "";
-        if (!CMessageSigner::VerifyMessage(pmn->pubKeyMasternode.GetID(), vchSig, strMessage, errorMessage)) {
+        if (!VerifyMasternodeMessage(pmn->pubKeyMasternode.GetID(), vchSig, GetSignatureMessage(), errorMessage)) {
             return error("CMasternodePaymentWinner::SignatureValid() - Got bad Masternode address signature %s %s\n", vinMasternode.prevout.hash.ToString(), errorMessage);
         }
 
@@ -838,10 +919,8 @@ static bool IsCoinstakeValidForLottery(const CTransaction &tx, int nHeight)
     int nMinStakeValue = 10000; // default is 10k
 
     if(sporkManager.IsSporkActive(SPORK_16_LOTTERY_TICKET_MIN_VALUE)) {
-        MultiValueSporkList<LotteryTicketMinValueSporkValue> vValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager.GetMultiValueSpork(SPORK_16_LOTTERY_TICKET_MIN_VALUE), vValues);
         auto nBlockTime = chainActive[nHeight] ? chainActive[nHeight]->nTime : GetAdjustedTime();
-        LotteryTicketMinValueSporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vValues, nHeight, nBlockTime);
+        LotteryTicketMinValueSporkValue activeSpork = sporkManager.GetLotteryTicketMinValueSpork(nHeight, nBlockTime);
 
         if(activeSpork.IsValid()) {
             // we expect that this value is in coins, not in satoshis
@@ -852,44 +931,50 @@ static bool IsCoinstakeValidForLottery(const CTransaction &tx, int nHeight)
     return nAmount > nMinStakeValue * COIN; // only if stake is more than 10k
 }
 
-std::vector<WinnerCoinStake> CalculateLotteryWinners(const CBlock &block, const CBlockIndex *prevBlockIndex, int nHeight, const Consensus::Params &consensus)
+bool CalculateLotteryWinners(const CBlock &block, const CBlockIndex *prevBlockIndex, int nHeight, const Consensus::Params &consensus, std::vector<CLotteryWinner>& vWinners)
 {
-    std::vector<WinnerCoinStake> result;
+    vWinners.clear();
     // if that's a block when lottery happens, reset score for whole cycle
     if(IsValidLotteryBlockHeight(nHeight, consensus))
-        return result;
+        return true;
 
     if(!prevBlockIndex)
-        return result;
+        return true;
 
     int nLastLotteryHeight = std::max(consensus.nLotteryBlockStartBlock, consensus.nLotteryBlockCycle * ((nHeight - 1) / consensus.nLotteryBlockCycle));
 
     if(nHeight <= nLastLotteryHeight) {
-        return result;
+        return true;
     }
 
     const auto& coinbaseTx = (nHeight > consensus.nLastPOWBlock ? block.vtx[1] : block.vtx[0]);
 
+    auto prevWinners = GetLotteryWinners(prevBlockIndex);
+    if(!prevWinners)
+        return error("%s: lottery winners of block %s could not be read", __func__, prevBlockIndex->GetBlockHash().ToString());
+
     if(!IsCoinstakeValidForLottery(*coinbaseTx, nHeight)) {
-        return prevBlockIndex->vLotteryWinnersCoinstakes; // return last if we have no lotter participant in this block
+        vWinners = *prevWinners; // return last if we have no lotter participant in this block
+        return true;
     }
 
     CBlockIndex* pblockindex = chainActive[nLastLotteryHeight];
     auto hashLastLotteryBlock = pblockindex->GetBlockHash();
     // lotteryWinnersCoinstakes has hashes of coinstakes, let calculate old scores + new score
     using LotteryScore = arith_uint256;
-    std::vector<std::pair<LotteryScore, WinnerCoinStake>> scores;
-    for(auto &&hashCoinstake : prevBlockIndex->vLotteryWinnersCoinstakes) {
-        scores.emplace_back(CalculateLotteryScore(hashCoinstake, hashLastLotteryBlock), hashCoinstake);
+    std::vector<std::pair<LotteryScore, CLotteryWinner>> scores;
+    for(auto &&winner : *prevWinners) {
+        scores.emplace_back(CalculateLotteryScore(winner.hashCoinstake, hashLastLotteryBlock), winner);
     }
 
+    // the payout script is recorded now, paying and validating the lottery needs no transaction lookup
     auto newScore = CalculateLotteryScore(coinbaseTx->GetHash(), hashLastLotteryBlock);
-    scores.emplace_back(newScore, coinbaseTx->GetHash());
+    scores.emplace_back(newScore, CLotteryWinner{coinbaseTx->GetHash(), GetLotteryPayoutScript(*coinbaseTx)});
 
     // biggest entry at the begining
     if(scores.size() > 1)
     {
-        std::sort(std::begin(scores), std::end(scores), [](const std::pair<LotteryScore, WinnerCoinStake> &lhs, const std::pair<LotteryScore, WinnerCoinStake> &rhs) {
+        std::sort(std::begin(scores), std::end(scores), [](const std::pair<LotteryScore, CLotteryWinner> &lhs, const std::pair<LotteryScore, CLotteryWinner> &rhs) {
             return lhs.first > rhs.first;
         });
     }
@@ -898,10 +983,10 @@ std::vector<WinnerCoinStake> CalculateLotteryWinners(const CBlock &block, const
 
     // prepare new coinstakes vector
     for(auto &&score : scores) {
-        result.push_back(score.second);
+        vWinners.push_back(score.second);
     }
 
-    return result;
+    return true;
 }
 
 
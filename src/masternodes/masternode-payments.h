@@ -17,6 +17,7 @@ extern CCriticalSection cs_vecPayments;
 extern CCriticalSection cs_mapMasternodeBlocks;
 extern CCriticalSection cs_mapMasternodePayeeVotes;
 
+class CMasternodeDB;
 class CMasternodePayments;
 class CMasternodePaymentWinner;
 class CMasternodeBlockPayees;
@@ -32,9 +33,13 @@ bool IsBlockPayeeValid(const CTransaction &txNew, int nBlockHeight, CBlockIndex
 std::string GetRequiredPaymentsString(int nBlockHeight);
 bool IsBlockValueValid(const CBlock& block, const CBlockRewards &nExpectedValue, CAmount nMinted, const Consensus::Params &consensus);
 void FillBlockPayee(CMutableTransaction& txNew, const CBlockRewards &payments, bool fProofOfStake, const Consensus::Params &consensus);
+/** Scripts the coinstake of block pays masternode rewards to */
+std::vector<CScript> GetBlockMasternodePayees(const CBlock& block, int nBlockHeight, const Consensus::Params &consensus);
 
-using WinnerCoinStake = uint256;
-std::vector<WinnerCoinStake> CalculateLotteryWinners(const CBlock& block, const CBlockIndex *prevBlockIndex, int nHeight, const Consensus::Params &consensus);
+/** Script the lottery prize of a winning coinbase or coinstake is paid to */
+CScript GetLotteryPayoutScript(const CTransaction& tx);
+/** Lottery winners after block, false if the winners of its parent could not be read */
+bool CalculateLotteryWinners(const CBlock& block, const CBlockIndex *prevBlockIndex, int nHeight, const Consensus::Params &consensus, std::vector<CLotteryWinner>& vWinners);
 
 class CMasternodePayee
 {
@@ -174,6 +179,8 @@ public:
     bool IsValid(CNode* pnode, std::string& strError, CConnman &connman);
     bool SignatureValid();
     void Relay(CConnman &connman);
+    /// The message signed by the masternode key
+    std::string GetSignatureMessage() const;
 
     void AddPayee(CScript payeeIn)
     {
@@ -233,6 +240,8 @@ public:
     }
 
     bool AddWinningMasternode(const CMasternodePaymentWinner &winner);
+    /// Restore the payment votes from the masternode database
+    bool Load(CMasternodeDB& db);
     bool ProcessBlock(int nBlockHeight, CConnman &connman);
 
     void Sync(CNode* node, int nCountNeeded, CConnman &connman);
@@ -261,6 +270,8 @@ public:
 
     int GetMinMasternodePaymentsProto();
     void ProcessMessageMasternodePayments(CNode* pfrom, CValidationState &state, const std::string& strCommand, CDataStream& vRecv, CConnman &connman);
+    /// Check a winner vote received from pfrom and record it, asking pfrom for unknown masternodes
+    void ProcessWinner(CNode* pfrom, CValidationState& state, CMasternodePaymentWinner& winner, CConnman& connman);
     std::string GetRequiredPaymentsString(int nBlockHeight);
     void FillBlockPayee(CMutableTransaction& txNew, const CBlockRewards &rewards, bool fProofOfStake, const Consensus::Params &consensus);
     std::string ToString() const;
@@ -0,0 +1,102 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-scores.h>
+#include <masternodes/masternode.h>
+#include <util/parallel.h>
+#include <util/time.h>
+
+#include <algorithm>
+
+// Scores calculated by each thread at least
+static const size_t MIN_SCORES_PER_THREAD = 16;
+
+struct CompareScoreDescending {
+    bool operator()(const CMasternodeScore& a, const CMasternodeScore& b) const
+    {
+        if (a.nCompactScore != b.nCompactScore)
+            return a.nCompactScore > b.nCompactScore;
+        if (a.nScore != b.nScore)
+            return a.nScore > b.nScore;
+        return a.outpoint < b.outpoint;
+    }
+};
+
+// Scores are interleaved over the threads, since the rounds per score depend on the tier
+static void CalculateScores(std::vector<CMasternodeScore>& vScores, const std::vector<int>& vTiers, const uint256& hashBlock)
+{
+    const size_t nThreads = GetParallelThreadCount(vScores.size(), MIN_SCORES_PER_THREAD);
+    ParallelFor(nThreads, [&vScores, &vTiers, &hashBlock, nThreads](size_t nFirst) {
+        for (size_t i = nFirst; i < vScores.size(); i += nThreads) {
+            vScores[i].nScore = CMasternode::CalculateScore(vScores[i].outpoint, vTiers[i], hashBlock);
+            vScores[i].nCompactScore = vScores[i].nScore.GetCompact(false);
+        }
+    });
+}
+
+CMasternodeScoreSnapshot::CMasternodeScoreSnapshot(std::vector<CMasternodeScore> vScoresIn) : vScores(std::move(vScoresIn))
+{
+    std::sort(vScores.begin(), vScores.end(), CompareScoreDescending());
+    for (size_t i = 0; i < vScores.size(); i++)
+        mapPosition.emplace(vScores[i].outpoint, i);
+}
+
+bool CMasternodeScoreSnapshot::Find(const COutPoint& outpoint, size_t& nPosition) const
+{
+    auto it = mapPosition.find(outpoint);
+    if (it == mapPosition.end())
+        return false;
+    nPosition = it->second;
+    return true;
+}
+
+std::shared_ptr<const CMasternodeScoreSnapshot> CMasternodeScoreCache::Get(const uint256& hashBlock, const std::vector<CMasternode>& vMasternodes)
+{
+    LOCK(cs);
+
+    std::shared_ptr<const CMasternodeScoreSnapshot> snapshot;
+    auto it = mapSnapshots.find(hashBlock);
+    if (it != mapSnapshots.end())
+        snapshot = it->second;
+
+    std::vector<CMasternodeScore> vMissing;
+    std::vector<int> vTiers;
+    for (const CMasternode& mn : vMasternodes) {
+        size_t nPosition;
+        if (snapshot && snapshot->Find(mn.vin.prevout, nPosition))
+            continue;
+        vMissing.push_back(CMasternodeScore{mn.vin.prevout, arith_uint256(), 0});
+        vTiers.push_back(mn.nTier);
+    }
+
+    if (snapshot && vMissing.empty())
+        return snapshot;
+
+    int64_t nTimeStart = GetTimeMicros();
+    CalculateScores(vMissing, vTiers, hashBlock);
+    LogPrint(BCLog::MASTERNODE, "CMasternodeScoreCache::Get - scored %u masternodes at %s in %.2fms\n",
+             vMissing.size(), hashBlock.ToString(), (GetTimeMicros() - nTimeStart) * 0.001);
+
+    if (snapshot)
+        vMissing.insert(vMissing.end(), snapshot->GetScores().begin(), snapshot->GetScores().end());
+    else
+        vBlocks.push_back(hashBlock);
+
+    snapshot = std::make_shared<const CMasternodeScoreSnapshot>(std::move(vMissing));
+    mapSnapshots[hashBlock] = snapshot;
+
+    while (vBlocks.size() > MAX_BLOCKS) {
+        mapSnapshots.erase(vBlocks.front());
+        vBlocks.pop_front();
+    }
+
+    return snapshot;
+}
+
+void CMasternodeScoreCache::Clear()
+{
+    LOCK(cs);
+    mapSnapshots.clear();
+    vBlocks.clear();
+}
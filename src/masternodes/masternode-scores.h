@@ -0,0 +1,70 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SCORES_H
+#define MASTERNODE_SCORES_H
+
+#include <arith_uint256.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+class CMasternode;
+
+struct CMasternodeScore
+{
+    COutPoint outpoint;
+    arith_uint256 nScore;
+    // What the masternode ranking compares
+    int64_t nCompactScore;
+};
+
+//
+// The scores of a set of masternodes for one block, from the best to the worst
+//
+class CMasternodeScoreSnapshot
+{
+private:
+    std::vector<CMasternodeScore> vScores;
+    std::map<COutPoint, size_t> mapPosition;
+
+public:
+    explicit CMasternodeScoreSnapshot(std::vector<CMasternodeScore> vScoresIn);
+
+    const std::vector<CMasternodeScore>& GetScores() const { return vScores; }
+    size_t size() const { return vScores.size(); }
+
+    /// Position of outpoint in GetScores(), false when it was not scored
+    bool Find(const COutPoint& outpoint, size_t& nPosition) const;
+};
+
+//
+// Memoizes the masternode scores per (collateral outpoint, block hash). A score
+// takes up to 2400 double SHA256 rounds depending on the tier and never
+// changes, so every one is computed once, the missing ones on all cores.
+//
+class CMasternodeScoreCache
+{
+private:
+    // blocks scores are kept for, enough for the payment votes in flight
+    static const size_t MAX_BLOCKS = 32;
+
+    mutable CCriticalSection cs;
+    std::map<uint256, std::shared_ptr<const CMasternodeScoreSnapshot> > mapSnapshots;
+    // block hashes in mapSnapshots, oldest first
+    std::deque<uint256> vBlocks;
+
+public:
+    /// Scores of vMasternodes at hashBlock, only the ones not known yet are computed
+    std::shared_ptr<const CMasternodeScoreSnapshot> Get(const uint256& hashBlock, const std::vector<CMasternode>& vMasternodes);
+
+    void Clear();
+};
+
+#endif
@@ -0,0 +1,213 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_SEEN_H
+#define MASTERNODE_SEEN_H
+
+#include <masternodes/masternode.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+/** Time a seen message expires from: a broadcast is kept by its last ping */
+inline int64_t GetSeenTime(const CMasternodeBroadcast& mnb) { return mnb.lastPing.sigTime; }
+inline int64_t GetSeenTime(const CMasternodePing& mnp) { return mnp.sigTime; }
+
+/**
+ * Masternode broadcasts or pings seen, by hash. They are indexed by the collateral
+ * outpoint of their masternode and by the time they expire from as well, so the
+ * messages of a removed masternode and the expired messages are found without a scan.
+ */
+template <typename Message>
+class CSeenMasternodeMessages
+{
+private:
+    struct CEntry
+    {
+        uint256 hash;
+        COutPoint outpoint;
+        int64_t nTime;
+        Message message;
+    };
+
+    struct by_outpoint {};
+    struct by_time {};
+
+    typedef boost::multi_index_container<
+        CEntry,
+        boost::multi_index::indexed_by<
+            boost::multi_index::ordered_unique<boost::multi_index::member<CEntry, uint256, &CEntry::hash>>,
+            boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_outpoint>, boost::multi_index::member<CEntry, COutPoint, &CEntry::outpoint>>,
+            boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_time>, boost::multi_index::member<CEntry, int64_t, &CEntry::nTime>>
+        >
+    > indexed_entries;
+
+    indexed_entries entries;
+
+public:
+    size_t size() const { return entries.size(); }
+    size_t count(const uint256& hash) const { return entries.count(hash); }
+    void clear() { entries.clear(); }
+
+    /// Add a message by its hash, unless one was seen with that hash
+    bool insert(const std::pair<uint256, Message>& entry)
+    {
+        return entries.insert(CEntry{entry.first, entry.second.vin.prevout, GetSeenTime(entry.second), entry.second}).second;
+    }
+
+    bool Get(const uint256& hash, Message& messageRet) const
+    {
+        auto it = entries.find(hash);
+        if (it == entries.end()) return false;
+        messageRet = it->message;
+        return true;
+    }
+
+    void erase(const uint256& hash)
+    {
+        entries.erase(hash);
+    }
+
+    /// Replace the last ping of a seen broadcast, which moves its expiry
+    void UpdateLastPing(const uint256& hash, const CMasternodePing& mnp)
+    {
+        auto it = entries.find(hash);
+        if (it == entries.end()) return;
+        entries.modify(it, [&mnp](CEntry& entry) {
+            entry.message.lastPing = mnp;
+            entry.nTime = GetSeenTime(entry.message);
+        });
+    }
+
+    /// Erase the messages for the masternode with this collateral outpoint, returning their hashes
+    std::vector<uint256> EraseOutpoint(const COutPoint& outpoint)
+    {
+        std::vector<uint256> vErased;
+        auto& index = entries.template get<by_outpoint>();
+        auto range = index.equal_range(outpoint);
+        for (auto it = range.first; it != range.second; ++it)
+            vErased.push_back(it->hash);
+        index.erase(range.first, range.second);
+        return vErased;
+    }
+
+    /// Erase the messages expiring before nTime, returning their hashes
+    std::vector<uint256> EraseExpired(int64_t nTime)
+    {
+        std::vector<uint256> vErased;
+        auto& index = entries.template get<by_time>();
+        auto end = index.lower_bound(nTime);
+        for (auto it = index.begin(); it != end; ++it)
+            vErased.push_back(it->hash);
+        index.erase(index.begin(), end);
+        return vErased;
+    }
+
+    // Serialized like the map by hash it replaced
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        WriteCompactSize(s, entries.size());
+        for (const CEntry& entry : entries)
+            s << entry.hash << entry.message;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        clear();
+        const uint64_t nSize = ReadCompactSize(s);
+        for (uint64_t i = 0; i < nSize; i++) {
+            std::pair<uint256, Message> entry;
+            s >> entry.first >> entry.second;
+            insert(entry);
+        }
+    }
+};
+
+/**
+ * Times by key of when a peer or masternode may be asked for the list again, or may ask
+ * us again. The keys are ordered by their time too, so the expired ones are found
+ * without a scan.
+ */
+template <typename Key>
+class CAskedTimes
+{
+private:
+    std::map<Key, int64_t> mapTimes;
+    std::set<std::pair<int64_t, Key>> setByTime;
+
+public:
+    size_t size() const { return mapTimes.size(); }
+
+    void clear()
+    {
+        mapTimes.clear();
+        setByTime.clear();
+    }
+
+    bool Get(const Key& key, int64_t& nTimeRet) const
+    {
+        auto it = mapTimes.find(key);
+        if (it == mapTimes.end()) return false;
+        nTimeRet = it->second;
+        return true;
+    }
+
+    void Set(const Key& key, int64_t nTime)
+    {
+        auto it = mapTimes.find(key);
+        if (it != mapTimes.end()) {
+            setByTime.erase(std::make_pair(it->second, key));
+            it->second = nTime;
+        } else {
+            mapTimes.emplace(key, nTime);
+        }
+        setByTime.emplace(nTime, key);
+    }
+
+    void erase(const Key& key)
+    {
+        auto it = mapTimes.find(key);
+        if (it == mapTimes.end()) return;
+        setByTime.erase(std::make_pair(it->second, key));
+        mapTimes.erase(it);
+    }
+
+    /// Erase the keys with a time before nTime
+    void EraseExpired(int64_t nTime)
+    {
+        auto it = setByTime.begin();
+        while (it != setByTime.end() && it->first < nTime) {
+            mapTimes.erase(it->second);
+            it = setByTime.erase(it);
+        }
+    }
+
+    // Serialized like the map by key it replaced
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << mapTimes;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> mapTimes;
+        setByTime.clear();
+        for (const auto& entry : mapTimes)
+            setByTime.emplace(entry.second, entry.first);
+    }
+};
+
+#endif
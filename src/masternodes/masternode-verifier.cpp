@@ -0,0 +1,351 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-verifier.h>
+#include <masternodes/masternodeman.h>
+#include <consensus/validation.h>
+#include <cuckoocache.h>
+#include <hash.h>
+#include <messagesigner.h>
+#include <net_processing.h>
+#include <random.h>
+#include <script/sigcache.h>
+#include <util/parallel.h>
+#include <util/system.h>
+#include <util/time.h>
+#include <validation.h> // For strMessageMagic
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <map>
+
+#include <boost/thread.hpp>
+
+CMasternodeMessageVerifier masternodeVerifier;
+
+// Signatures verified by each thread of a batch at least
+static const size_t MIN_MASTERNODE_SIGNATURES_PER_THREAD = 32;
+// Memory for each of the valid and the invalid signature sets
+static const size_t MASTERNODE_SIGNATURE_CACHE_BYTES = 2 << 20;
+
+namespace {
+/**
+ * Results of masternode message signature checks. Broadcasts are relayed by
+ * every peer and the same votes come back with every sync, and the messages
+ * are checked once on the verification thread and again when applied.
+ */
+class CMasternodeSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || message hash || key id || signature):
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
+    map_type setValid;
+    map_type setInvalid;
+    boost::shared_mutex cs_sigcache;
+
+public:
+    CMasternodeSignatureCache()
+    {
+        GetRandBytes(nonce.begin(), 32);
+        setValid.setup_bytes(MASTERNODE_SIGNATURE_CACHE_BYTES);
+        setInvalid.setup_bytes(MASTERNODE_SIGNATURE_CACHE_BYTES);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    /// Was this entry checked before? fValid is its result.
+    bool Get(const uint256& entry, bool& fValid)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        if (setValid.contains(entry, false)) {
+            fValid = true;
+            return true;
+        }
+        if (setInvalid.contains(entry, false)) {
+            fValid = false;
+            return true;
+        }
+        return false;
+    }
+
+    void Set(uint256& entry, bool fValid)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        if (fValid) {
+            setValid.insert(entry);
+        } else {
+            setInvalid.insert(entry);
+        }
+    }
+};
+
+static CMasternodeSignatureCache signatureCache;
+} // namespace
+
+bool VerifyMasternodeMessage(const CKeyID& keyID, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet)
+{
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << strMessageMagic;
+    ss << strMessage;
+    const uint256 hash = ss.GetHash();
+
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, hash, keyID, vchSig);
+
+    bool fValid;
+    if (signatureCache.Get(entry, fValid)) {
+        if (!fValid) strErrorRet = "Signature was found invalid before";
+        return fValid;
+    }
+
+    fValid = CHashSigner::VerifyHash(hash, keyID, vchSig, strErrorRet);
+    signatureCache.Set(entry, fValid);
+    return fValid;
+}
+
+bool VerifyMasternodeSignatures(const std::vector<CMasternodeSignatureCheck>& vChecks)
+{
+    // Checks are interleaved over the threads, the results end up in the signature cache
+    const size_t nThreads = GetParallelThreadCount(vChecks.size(), MIN_MASTERNODE_SIGNATURES_PER_THREAD);
+    std::vector<char> vValid(nThreads, true);
+    ParallelFor(nThreads, [&vChecks, &vValid, nThreads](size_t nFirst) {
+        std::string strError;
+        for (size_t i = nFirst; i < vChecks.size(); i += nThreads) {
+            if (!VerifyMasternodeMessage(vChecks[i].keyID, *vChecks[i].pvchSig, vChecks[i].strMessage, strError))
+                vValid[nFirst] = false;
+        }
+    });
+    return std::all_of(vValid.begin(), vValid.end(), [](char fValid) { return fValid; });
+}
+
+namespace {
+/** Collects the signature checks of the queued messages */
+class CSignatureCheckCollector : public boost::static_visitor<void>
+{
+private:
+    std::vector<CMasternodeSignatureCheck>& vChecks;
+
+    void AddMasternodeKey(const CTxIn& vin, const std::vector<unsigned char>& vchSig, std::string&& strMessage) const
+    {
+        // the masternode might still be unknown, then the message is rejected without checking its signature
+        CPubKey pubKeyMasternode;
+        if (!mnodeman.GetMasternodePubKey(vin, pubKeyMasternode)) return;
+        vChecks.push_back(CMasternodeSignatureCheck{pubKeyMasternode.GetID(), &vchSig, std::move(strMessage)});
+    }
+
+public:
+    explicit CSignatureCheckCollector(std::vector<CMasternodeSignatureCheck>& vChecksIn) : vChecks(vChecksIn) {}
+
+    void operator()(const CMasternodeBroadcast& mnb) const
+    {
+        vChecks.push_back(CMasternodeSignatureCheck{mnb.pubKeyCollateralAddress.GetID(), &mnb.sig, mnb.GetSignatureMessage()});
+    }
+
+    void operator()(const CMasternodePing& mnp) const
+    {
+        AddMasternodeKey(mnp.vin, mnp.vchSig, mnp.GetSignatureMessage());
+    }
+
+    void operator()(const CMasternodePaymentWinner& winner) const
+    {
+        AddMasternodeKey(winner.vinMasternode, winner.vchSig, winner.GetSignatureMessage());
+    }
+};
+
+/** Passes a verified message on to where the message handler would have processed it */
+class CMessageApplier : public boost::static_visitor<void>
+{
+private:
+    CNode* pfrom;
+    CValidationState& state;
+    CConnman& connman;
+
+public:
+    CMessageApplier(CNode* pfromIn, CValidationState& stateIn, CConnman& connmanIn) : pfrom(pfromIn), state(stateIn), connman(connmanIn) {}
+
+    void operator()(CMasternodeBroadcast& mnb) const
+    {
+        mnodeman.ProcessBroadcast(pfrom, state, mnb, connman);
+    }
+
+    void operator()(CMasternodePing& mnp) const
+    {
+        mnodeman.ProcessPing(pfrom, state, mnp, connman);
+    }
+
+    void operator()(CMasternodePaymentWinner& winner) const
+    {
+        masternodePayments.ProcessWinner(pfrom, state, winner, connman);
+    }
+};
+} // namespace
+
+CMasternodeMessageVerifier::CMasternodeMessageVerifier() : fRunning(false), fInterrupted(false), connman(nullptr)
+{
+}
+
+CMasternodeMessageVerifier::~CMasternodeMessageVerifier()
+{
+    if (threadVerify.joinable()) Stop();
+}
+
+bool CMasternodeMessageVerifier::Add(CNode* pfrom, const uint256& hash, Message&& message)
+{
+    LOCK(cs);
+    if (!fRunning) return false;
+
+    if (queuePending.size() >= MAX_MASTERNODE_VERIFY_QUEUE) {
+        LogPrint(BCLog::MASTERNODE, "CMasternodeMessageVerifier::Add -- queue is full, dropping %s from peer=%d\n", hash.ToString(), pfrom->GetId());
+        return true;
+    }
+    if (!setPendingHashes.insert(hash).second) return true;
+
+    queuePending.push_back(CPendingMessage{pfrom->AddRef(), hash, std::move(message)});
+    condPending.notify_one();
+    return true;
+}
+
+bool CMasternodeMessageVerifier::AddBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb)
+{
+    return Add(pfrom, mnb.GetHash(), mnb);
+}
+
+bool CMasternodeMessageVerifier::AddPing(CNode* pfrom, const CMasternodePing& mnp)
+{
+    return Add(pfrom, mnp.GetHash(), mnp);
+}
+
+bool CMasternodeMessageVerifier::AddWinner(CNode* pfrom, const CMasternodePaymentWinner& winner)
+{
+    return Add(pfrom, winner.GetHash(), winner);
+}
+
+bool CMasternodeMessageVerifier::IsPending(const uint256& hash) const
+{
+    LOCK(cs);
+    return setPendingHashes.count(hash);
+}
+
+size_t CMasternodeMessageVerifier::size() const
+{
+    LOCK(cs);
+    return queuePending.size();
+}
+
+void CMasternodeMessageVerifier::VerifyBatch(const std::vector<CPendingMessage>& vBatch)
+{
+    std::vector<CMasternodeSignatureCheck> vChecks;
+    vChecks.reserve(vBatch.size());
+    CSignatureCheckCollector collector(vChecks);
+    for (const CPendingMessage& pending : vBatch) {
+        boost::apply_visitor(collector, pending.message);
+    }
+
+    VerifyMasternodeSignatures(vChecks);
+}
+
+void CMasternodeMessageVerifier::ApplyBatch(std::vector<CPendingMessage>& vBatch)
+{
+    std::map<NodeId, int> mapMisbehavior;
+
+    for (CPendingMessage& pending : vBatch) {
+        CValidationState state;
+        boost::apply_visitor(CMessageApplier(pending.pfrom, state, *connman), pending.message);
+
+        int nDoS;
+        if (state.IsInvalid(nDoS) && nDoS > 0) {
+            mapMisbehavior[pending.pfrom->GetId()] += nDoS;
+        }
+    }
+
+    if (!mapMisbehavior.empty()) {
+        LOCK(cs_main);
+        for (const auto& entry : mapMisbehavior) {
+            Misbehaving(entry.first, entry.second, "invalid masternode message");
+        }
+    }
+}
+
+void CMasternodeMessageVerifier::ReleaseNodes(std::vector<CPendingMessage>& vBatch)
+{
+    LOCK(cs);
+    for (CPendingMessage& pending : vBatch) {
+        setPendingHashes.erase(pending.hash);
+        pending.pfrom->Release();
+    }
+    vBatch.clear();
+}
+
+void CMasternodeMessageVerifier::ThreadVerify()
+{
+    std::vector<CPendingMessage> vBatch;
+    while (true) {
+        {
+            WAIT_LOCK(cs, lock);
+            condPending.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(cs) { return fInterrupted || !queuePending.empty(); });
+            if (fInterrupted) return;
+
+            const size_t nCount = std::min(queuePending.size(), MASTERNODE_VERIFY_BATCH_SIZE);
+            vBatch.reserve(nCount);
+            std::move(queuePending.begin(), queuePending.begin() + nCount, std::back_inserter(vBatch));
+            queuePending.erase(queuePending.begin(), queuePending.begin() + nCount);
+        }
+
+        const int64_t nTimeStart = GetTimeMicros();
+        VerifyBatch(vBatch);
+        const int64_t nTimeVerified = GetTimeMicros();
+        ApplyBatch(vBatch);
+        LogPrint(BCLog::MASTERNODE, "CMasternodeMessageVerifier -- verified %u messages in %.2fms, applied in %.2fms\n",
+                 vBatch.size(), (nTimeVerified - nTimeStart) * 0.001, (GetTimeMicros() - nTimeVerified) * 0.001);
+
+        ReleaseNodes(vBatch);
+    }
+}
+
+void CMasternodeMessageVerifier::Start(CConnman& connmanIn)
+{
+    LOCK(cs);
+    if (fRunning) return;
+
+    connman = &connmanIn;
+    fRunning = true;
+    fInterrupted = false;
+    threadVerify = std::thread(&TraceThread<std::function<void()>>, "mnverify",
+                               std::bind(&CMasternodeMessageVerifier::ThreadVerify, this));
+}
+
+void CMasternodeMessageVerifier::Interrupt()
+{
+    LOCK(cs);
+    fInterrupted = true;
+    condPending.notify_all();
+}
+
+void CMasternodeMessageVerifier::Stop()
+{
+    {
+        LOCK(cs);
+        // messages arriving from now on are processed by the message handler again
+        fRunning = false;
+        fInterrupted = true;
+        condPending.notify_all();
+    }
+
+    if (threadVerify.joinable()) {
+        threadVerify.join();
+    }
+
+    std::vector<CPendingMessage> vDropped;
+    {
+        LOCK(cs);
+        std::move(queuePending.begin(), queuePending.end(), std::back_inserter(vDropped));
+        queuePending.clear();
+    }
+    ReleaseNodes(vDropped);
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MASTERNODE_VERIFIER_H
+#define MASTERNODE_VERIFIER_H
+
+#include <masternodes/masternode.h>
+#include <masternodes/masternode-payments.h>
+#include <net.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <condition_variable>
+#include <deque>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/variant.hpp>
+
+/** Number of masternode messages verified and applied together */
+static const size_t MASTERNODE_VERIFY_BATCH_SIZE = 1000;
+/** Number of masternode messages waiting for verification, further ones are dropped */
+static const size_t MAX_MASTERNODE_VERIFY_QUEUE = 50000;
+
+class CMasternodeMessageVerifier;
+
+extern CMasternodeMessageVerifier masternodeVerifier;
+
+/**
+ * Verify that strMessage was signed by keyID. Signatures are remembered both
+ * ways, so a message checked ahead of being applied is not recovered again.
+ */
+bool VerifyMasternodeMessage(const CKeyID& keyID, const std::vector<unsigned char>& vchSig, const std::string& strMessage, std::string& strErrorRet);
+
+/** A masternode message signature to be checked ahead of applying the message */
+struct CMasternodeSignatureCheck
+{
+    CKeyID keyID;
+    const std::vector<unsigned char>* pvchSig;
+    std::string strMessage;
+};
+
+/**
+ * Verify a batch of signatures on all cores, so the messages applied afterwards
+ * find their signatures in the cache. True if every signature is valid.
+ */
+bool VerifyMasternodeSignatures(const std::vector<CMasternodeSignatureCheck>& vChecks);
+
+//
+// Verifies masternode broadcasts, pings and winner votes off the message handler thread.
+// The message handler only drops duplicates and queues the rest. The verification thread
+// takes the queue in batches, recovers the signatures of a batch on all cores and then
+// applies its messages in order, where the signature checks hit the cache.
+//
+class CMasternodeMessageVerifier
+{
+private:
+    typedef boost::variant<CMasternodeBroadcast, CMasternodePing, CMasternodePaymentWinner> Message;
+
+    struct CPendingMessage
+    {
+        // referenced until the message was applied
+        CNode* pfrom;
+        uint256 hash;
+        Message message;
+    };
+
+    mutable Mutex cs;
+    std::condition_variable condPending;
+    std::deque<CPendingMessage> queuePending GUARDED_BY(cs);
+    // hashes of the queued messages, to drop duplicates before they are verified
+    std::set<uint256> setPendingHashes GUARDED_BY(cs);
+    bool fRunning GUARDED_BY(cs);
+    bool fInterrupted GUARDED_BY(cs);
+
+    CConnman* connman;
+    std::thread threadVerify;
+
+    bool Add(CNode* pfrom, const uint256& hash, Message&& message);
+    void ThreadVerify();
+    /// Recover the signatures of a batch in parallel, filling the signature cache
+    void VerifyBatch(const std::vector<CPendingMessage>& vBatch);
+    /// Apply the messages of a batch in the order they were received
+    void ApplyBatch(std::vector<CPendingMessage>& vBatch);
+    void ReleaseNodes(std::vector<CPendingMessage>& vBatch);
+
+public:
+    CMasternodeMessageVerifier();
+    ~CMasternodeMessageVerifier();
+
+    /// Queue a message for verification. False when the verifier is not running,
+    /// and the caller should process the message itself.
+    bool AddBroadcast(CNode* pfrom, const CMasternodeBroadcast& mnb);
+    bool AddPing(CNode* pfrom, const CMasternodePing& mnp);
+    bool AddWinner(CNode* pfrom, const CMasternodePaymentWinner& winner);
+
+    /// Is a message with this hash waiting for verification?
+    bool IsPending(const uint256& hash) const;
+    size_t size() const;
+
+    void Start(CConnman& connmanIn);
+    void Interrupt();
+    /// Stop the verification thread and drop the messages it did not get to
+    void Stop();
+};
+
+#endif
@@ -6,8 +6,10 @@
 #include <masternodes/masternode.h>
 #include <addrman.h>
 #include <masternodes/masternodeman.h>
+#include <masternodes/masternode-lastpaid.h>
 #include <masternodes/masternode-payments.h>
 #include <masternodes/masternode-sync.h>
+#include <masternodes/masternode-verifier.h>
 #include <masternodes/activemasternode.h>
 #include <messagesigner.h>
 #include <sync.h>
@@ -17,6 +19,7 @@
 #include <script/standard.h>
 #include <chainparams.h>
 #include <shutdown.h>
+#include <validationinterface.h>
 #include <wallet/wallet.h>
 #include <boost/lexical_cast.hpp>
 
@@ -207,17 +210,23 @@ arith_uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight)
         return 0;
 
     uint256 hash;
-    uint256 aux = ArithToUint256(UintToArith256(vin.prevout.hash) + vin.prevout.n);
 
     if (!GetBlockHash(hash, nBlockHeight)) {
         LogPrint(BCLog::MASTERNODE,"CalculateScore ERROR - nHeight %d - Returned 0\n", nBlockHeight);
         return 0;
     }
 
+    return CalculateScore(vin.prevout, nTier, hash);
+}
+
+arith_uint256 CMasternode::CalculateScore(const COutPoint& outpoint, int nTier, const uint256& hashBlock)
+{
+    uint256 aux = ArithToUint256(UintToArith256(outpoint.hash) + outpoint.n);
+
     size_t nHashRounds = GetHashRoundsForTierMasternodes(static_cast<CMasternode::Tier>(nTier));
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    ss << hash;
+    ss << hashBlock;
     ss << aux;
 
     arith_uint256 r;
@@ -229,6 +238,13 @@ arith_uint256 CMasternode::CalculateScore(int mod, int64_t nBlockHeight)
     return r;
 }
 
+void CMasternode::SetActiveState(int nState)
+{
+    if (activeState == nState) return;
+    activeState = nState;
+    GetMainSignals().MasternodeChanged(*this, MasternodeChange::STATE);
+}
+
 void CMasternode::Check(bool forceCheck)
 {
     if (ShutdownRequested()) return;
@@ -242,24 +258,24 @@ void CMasternode::Check(bool forceCheck)
 
 
     if (!IsPingedWithin(MASTERNODE_REMOVAL_SECONDS)) {
-        activeState = MASTERNODE_REMOVE;
+        SetActiveState(MASTERNODE_REMOVE);
         return;
     }
 
     if (!IsPingedWithin(MASTERNODE_EXPIRATION_SECONDS)) {
-        activeState = MASTERNODE_EXPIRED;
+        SetActiveState(MASTERNODE_EXPIRED);
         return;
     }
 
     if (!unitTest) {
         Coin coin;
         if (!GetUTXOCoin(vin.prevout, coin)) {
-            activeState = MASTERNODE_VIN_SPENT;
+            SetActiveState(MASTERNODE_VIN_SPENT);
             return;
         }
     }
 
-    activeState = MASTERNODE_ENABLED; // OK
+    SetActiveState(MASTERNODE_ENABLED); // OK
 }
 
 CAmount CMasternode::GetTierCollateralAmount(CMasternode::Tier tier)
@@ -328,12 +344,9 @@ std::string CMasternode::TierToString(CMasternode::Tier tier)
     return "INVALID";
 }
 
-int64_t CMasternode::SecondsSincePayment()
+int64_t CMasternode::SecondsSincePayment(int nMnCount)
 {
-    CScript pubkeyScript;
-    pubkeyScript = GetScriptForDestination(pubKeyCollateralAddress.GetID());
-
-    int64_t sec = (GetAdjustedTime() - GetLastPaid());
+    int64_t sec = (GetAdjustedTime() - GetLastPaid(nMnCount));
     int64_t month = 60 * 60 * 24 * 30;
     if (sec < month) return sec; //if it's less than 30 days, give seconds
 
@@ -346,14 +359,14 @@ int64_t CMasternode::SecondsSincePayment()
     return month + hash.GetCompact(false);
 }
 
-int64_t CMasternode::GetLastPaid()
+int64_t CMasternode::GetLastPaid(int nMnCount)
 {
-    CBlockIndex* pindexPrev = chainActive.Tip();
-    if (pindexPrev == NULL) return false;
-
     CScript mnpayee;
     mnpayee = GetScriptForDestination(pubKeyCollateralAddress.GetID());
 
+    CMasternodePaidBlock paid;
+    if (!masternodeLastPaid.GetLastPaid(mnpayee, (int)(nMnCount * 1.25), paid)) return 0;
+
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << vin;
     ss << sigTime;
@@ -362,36 +375,7 @@ int64_t CMasternode::GetLastPaid()
     // use a deterministic offset to break a tie -- 2.5 minutes
     int64_t nOffset = hash.GetCompact(false) % 150;
 
-    if (chainActive.Tip() == NULL) return false;
-
-    const CBlockIndex* BlockReading = chainActive.Tip();
-
-    int nMnCount = mnodeman.CountEnabled() * 1.25;
-    int n = 0;
-    for (unsigned int i = 1; BlockReading && BlockReading->nHeight > 0; i++) {
-        if (n >= nMnCount) {
-            return 0;
-        }
-        n++;
-
-        if (masternodePayments.mapMasternodeBlocks.count(BlockReading->nHeight)) {
-            /*
-                Search for this payee, with at least 2 votes. This will aid in consensus allowing the network
-                to converge on the same payees quickly, then keep the same schedule.
-            */
-            if (masternodePayments.mapMasternodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2)) {
-                return BlockReading->nTime + nOffset;
-            }
-        }
-
-        if (BlockReading->pprev == NULL) {
-            assert(BlockReading);
-            break;
-        }
-        BlockReading = BlockReading->pprev;
-    }
-
-    return 0;
+    return paid.nTime + nOffset;
 }
 
 std::string CMasternode::GetStatus()
@@ -603,10 +587,6 @@ bool CMasternodeBroadcast::CheckAndUpdate(int& nDos, CConnman &connman)
         return false;
     }
 
-    std::string vchPubKey(pubKeyCollateralAddress.begin(), pubKeyCollateralAddress.end());
-    std::string vchPubKey2(pubKeyMasternode.begin(), pubKeyMasternode.end());
-    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
-
     if (protocolVersion < masternodePayments.GetMinMasternodePaymentsProto()) {
         LogPrint(BCLog::MASTERNODE,"mnb - ignoring outdated Masternode %s protocol version %d\n", vin.prevout.hash.ToString(), protocolVersion);
         return false;
@@ -636,7 +616,7 @@ bool CMasternodeBroadcast::CheckAndUpdate(int& nDos, CConnman &connman)
     }
 
     std::string errorMessage = "";
-    if (!CMessageSigner::VerifyMessage(pubKeyCollateralAddress.GetID(), sig, strMessage, errorMessage)) {
+    if (!VerifyMasternodeMessage(pubKeyCollateralAddress.GetID(), sig, GetSignatureMessage(), errorMessage)) {
         LogPrintf("%s : - Got bad Masternode address signature\n", __func__);
         nDos = 100;
         return false;
@@ -669,7 +649,7 @@ bool CMasternodeBroadcast::CheckAndUpdate(int& nDos, CConnman &connman)
     if (pmn->pubKeyCollateralAddress == pubKeyCollateralAddress && !pmn->IsBroadcastedWithin(MASTERNODE_MIN_MNB_SECONDS)) {
         //take the newest entry
         LogPrint(BCLog::MASTERNODE,"mnb - Got updated entry for %s\n", vin.prevout.hash.ToString());
-        if (pmn->UpdateFromNewBroadcast(*this, connman)) {
+        if (mnodeman.UpdateFromNewBroadcast(*pmn, *this, connman)) {
             pmn->Check();
             if (pmn->IsEnabled())
                 Relay(connman);
@@ -755,16 +735,21 @@ void CMasternodeBroadcast::Relay(CConnman &connman) const
     connman.RelayInv(inv);
 }
 
-bool CMasternodeBroadcast::Sign(CKey& keyCollateralAddress)
+std::string CMasternodeBroadcast::GetSignatureMessage() const
 {
-    std::string errorMessage;
-
     std::string vchPubKey(pubKeyCollateralAddress.begin(), pubKeyCollateralAddress.end());
     std::string vchPubKey2(pubKeyMasternode.begin(), pubKeyMasternode.end());
 
+    return addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+}
+
+bool CMasternodeBroadcast::Sign(CKey& keyCollateralAddress)
+{
+    std::string errorMessage;
+
     sigTime = GetAdjustedTime();
 
-    std::string strMessage = addr.ToString() + boost::lexical_cast<std::string>(sigTime) + vchPubKey + vchPubKey2 + boost::lexical_cast<std::string>(protocolVersion);
+    std::string strMessage = GetSignatureMessage();
 
     if (!CMessageSigner::SignMessage(strMessage, sig, keyCollateralAddress, CPubKey::InputScriptType::SPENDP2PKH)) {
         LogPrint(BCLog::MASTERNODE,"CMasternodeBroadcast::Sign() - Error: %s\n", errorMessage);
@@ -796,13 +781,18 @@ CMasternodePing::CMasternodePing(CTxIn& newVin)
 }
 
 
+std::string CMasternodePing::GetSignatureMessage() const
+{
+    return vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+}
+
 bool CMasternodePing::Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode)
 {
     std::string errorMessage;
     std::string strMasterNodeSignMessage;
 
     sigTime = GetAdjustedTime();
-    std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
+    std::string strMessage = GetSignatureMessage();
 
     if (!CMessageSigner::SignMessage(strMessage, vchSig, keyMasternode, CPubKey::InputScriptType::SPENDP2PKH)) {
         LogPrint(BCLog::MASTERNODE,"CMasternodePing::Sign() - Error: %s\n", errorMessage);
@@ -842,10 +832,8 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireEnabled, CConnman &
         // update only if there is no known ping for this masternode or
         // last ping was more then MASTERNODE_MIN_MNP_SECONDS-60 ago comparing to this one
         if (!pmn->IsPingedWithin(MASTERNODE_MIN_MNP_SECONDS - 60, sigTime)) {
-            std::string strMessage = vin.ToString() + blockHash.ToString() + boost::lexical_cast<std::string>(sigTime);
-
             std::string errorMessage = "";
-            if (!CMessageSigner::VerifyMessage(pmn->pubKeyMasternode.GetID(), vchSig, strMessage, errorMessage)) {
+            if (!VerifyMasternodeMessage(pmn->pubKeyMasternode.GetID(), vchSig, GetSignatureMessage(), errorMessage)) {
                 LogPrint(BCLog::MASTERNODE,"CMasternodePing::CheckAndUpdate - Got bad Masternode address signature %s %s\n", vin.prevout.hash.ToString(), errorMessage);
                 nDos = 33;
                 return false;
@@ -869,13 +857,12 @@ bool CMasternodePing::CheckAndUpdate(int& nDos, bool fRequireEnabled, CConnman &
             }
 
             pmn->lastPing = *this;
+            mnodeman.Store(*pmn);
 
             //mnodeman.mapSeenMasternodeBroadcast.lastPing is probably outdated, so we'll update it
             CMasternodeBroadcast mnb(*pmn);
             uint256 hash = mnb.GetHash();
-            if (mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-                mnodeman.mapSeenMasternodeBroadcast[hash].lastPing = *this;
-            }
+            mnodeman.mapSeenMasternodeBroadcast.UpdateLastPing(hash, *this);
 
             pmn->Check(true);
             if (!pmn->IsEnabled()) return false;
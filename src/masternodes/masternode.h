@@ -31,6 +31,14 @@ extern map<int64_t, uint256> mapCacheBlockHashes;
 
 bool GetBlockHash(uint256& hash, int nBlockHeight);
 
+/** What happened to an entry of the masternode list, as told to the validation interface */
+enum class MasternodeChange {
+    ADDED,
+    UPDATED,    // a new broadcast was applied to the entry
+    STATE,      // the active state of the entry changed
+    REMOVED
+};
+
 //
 // The Masternode Ping Class : Contains a different serialize method for sending pings from masternodes throughout the network
 //
@@ -61,6 +69,8 @@ public:
     bool CheckAndUpdate(int& nDos, bool fRequireEnabled, CConnman &connman);
     bool Sign(CKey& keyMasternode, CPubKey& pubKeyMasternode);
     void Relay(CConnman &connman);
+    /// The message signed by the masternode key
+    std::string GetSignatureMessage() const;
 
     uint256 GetHash() const
     {
@@ -109,6 +119,9 @@ private:
     mutable CCriticalSection cs;
     int64_t lastTimeChecked;
 
+    //! Set the active state found by Check, telling the validation interface when it changed
+    void SetActiveState(int nState);
+
 public:
     enum state {
         MASTERNODE_PRE_ENABLED,
@@ -194,6 +207,8 @@ public:
     }
 
     arith_uint256 CalculateScore(int mod = 1, int64_t nBlockHeight = 0);
+    // Score of the masternode with collateral outpoint and nTier at hashBlock, it depends on nothing else
+    static arith_uint256 CalculateScore(const COutPoint& outpoint, int nTier, const uint256& hashBlock);
 
     ADD_SERIALIZE_METHODS;
 
@@ -220,7 +235,7 @@ public:
         READWRITE(nTier);
     }
 
-    int64_t SecondsSincePayment();
+    int64_t SecondsSincePayment(int nMnCount);
 
     bool UpdateFromNewBroadcast(CMasternodeBroadcast &mnb, CConnman &connman);
 
@@ -288,7 +303,8 @@ public:
         return strStatus;
     }
 
-    int64_t GetLastPaid();
+    /// Time of the last payment within 1.25 * nMnCount blocks, 0 if there is none
+    int64_t GetLastPaid(int nMnCount);
     bool IsValidNetAddr();
 };
 
@@ -308,6 +324,8 @@ public:
     bool CheckInputsAndAdd(int& nDos, CConnman &connman);
     bool Sign(CKey& keyCollateralAddress);
     void Relay(CConnman &connman) const;
+    /// The message signed by the collateral key
+    std::string GetSignatureMessage() const;
 
     ADD_SERIALIZE_METHODS;
 
@@ -5,19 +5,30 @@
 
 #include <masternodes/masternodeman.h>
 #include <masternodes/activemasternode.h>
+#include <masternodes/masternode-db.h>
 #include <masternodes/masternode-payments.h>
 #include <masternodes/masternode-sync.h>
+#include <masternodes/masternode-verifier.h>
 #include <addrman.h>
 #include <masternodes/masternode.h>
 #include <consensus/validation.h>
 #include <spork.h>
 #include <chainparams.h>
+#include <key_io.h>
 #include <messagesigner.h>
 #include <netbase.h>
 #include <netmessagemaker.h>
+#include <crypto/siphash.h>
+#include <random.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <limits>
+#include <unordered_set>
+
 #define MN_WINNER_MINIMUM_AGE 8000    // Age in seconds. This should be > MASTERNODE_REMOVAL_SECONDS to avoid misconfigured new nodes in the list.
 
 /** Masternode manager */
@@ -31,25 +42,79 @@ struct CompareLastPaid {
     }
 };
 
-struct CompareScoreTxIn {
-    bool operator()(const pair<int64_t, CTxIn>& t1,
-        const pair<int64_t, CTxIn>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
+SaltedKeyIDHasher::SaltedKeyIDHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-struct CompareScoreMN {
-    bool operator()(const pair<int64_t, CMasternode>& t1,
-        const pair<int64_t, CMasternode>& t2) const
-    {
-        return t1.first < t2.first;
-    }
-};
+size_t SaltedKeyIDHasher::operator()(const CKeyID& id) const
+{
+    return CSipHasher(k0, k1).Write(id.begin(), id.size()).Finalize();
+}
+
+template <typename Index, typename Key>
+static void EraseIndexEntry(Index& index, const Key& key, size_t nPosition)
+{
+    auto it = index.find(key);
+    if (it != index.end() && it->second == nPosition)
+        index.erase(it);
+}
 
 CMasternodeMan::CMasternodeMan()
 {
     nDsqCount = 0;
+    nListVersion = 0;
+}
+
+void CMasternodeMan::IndexMasternode(size_t nPosition)
+{
+    nListVersion++;
+    const CMasternode& mn = vMasternodes[nPosition];
+    // on duplicate keys the first entry wins, like it did for the linear scans
+    mapOutpointIndex.emplace(mn.vin.prevout, nPosition);
+    mapPayeeIndex.emplace(mn.pubKeyCollateralAddress.GetID(), nPosition);
+    mapPubKeyIndex.emplace(mn.pubKeyMasternode.GetID(), nPosition);
+}
+
+void CMasternodeMan::UnindexMasternode(size_t nPosition)
+{
+    nListVersion++;
+    const CMasternode& mn = vMasternodes[nPosition];
+    EraseIndexEntry(mapOutpointIndex, mn.vin.prevout, nPosition);
+    EraseIndexEntry(mapPayeeIndex, mn.pubKeyCollateralAddress.GetID(), nPosition);
+    EraseIndexEntry(mapPubKeyIndex, mn.pubKeyMasternode.GetID(), nPosition);
+}
+
+void CMasternodeMan::EraseMasternodes(const std::vector<size_t>& vPositions)
+{
+    if (vPositions.empty()) return;
+
+    // the entries after the first erased one shift down, only their positions are indexed again
+    const size_t nFirst = vPositions.front();
+    for (size_t i = nFirst; i < vMasternodes.size(); i++)
+        UnindexMasternode(i);
+
+    size_t nKept = nFirst;
+    auto itRemoved = vPositions.begin();
+    for (size_t i = nFirst; i < vMasternodes.size(); i++) {
+        if (itRemoved != vPositions.end() && *itRemoved == i) {
+            ++itRemoved;
+            continue;
+        }
+        if (nKept != i) vMasternodes[nKept] = std::move(vMasternodes[i]);
+        nKept++;
+    }
+    vMasternodes.erase(vMasternodes.begin() + nKept, vMasternodes.end());
+
+    for (size_t i = nFirst; i < vMasternodes.size(); i++)
+        IndexMasternode(i);
+}
+
+void CMasternodeMan::RebuildIndexes()
+{
+    nListVersion++;
+    mapOutpointIndex.clear();
+    mapPayeeIndex.clear();
+    mapPubKeyIndex.clear();
+    for (size_t i = 0; i < vMasternodes.size(); i++)
+        IndexMasternode(i);
 }
 
 bool CMasternodeMan::Add(CMasternode& mn)
@@ -63,6 +128,9 @@ bool CMasternodeMan::Add(CMasternode& mn)
     if (pmn == NULL) {
         LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Adding new Masternode %s - %i now\n", mn.vin.prevout.hash.ToString(), size() + 1);
         vMasternodes.push_back(mn);
+        IndexMasternode(vMasternodes.size() - 1);
+        Store(vMasternodes.back());
+        GetMainSignals().MasternodeChanged(vMasternodes.back(), MasternodeChange::ADDED);
         return true;
     }
 
@@ -71,9 +139,8 @@ bool CMasternodeMan::Add(CMasternode& mn)
 
 void CMasternodeMan::AskForMN(CNode* pnode, CTxIn& vin, CConnman &connman)
 {
-    std::map<COutPoint, int64_t>::iterator i = mWeAskedForMasternodeListEntry.find(vin.prevout);
-    if (i != mWeAskedForMasternodeListEntry.end()) {
-        int64_t t = (*i).second;
+    int64_t t;
+    if (mWeAskedForMasternodeListEntry.Get(vin.prevout, t)) {
         if (GetTime() < t) return; // we've asked recently
     }
 
@@ -83,7 +150,7 @@ void CMasternodeMan::AskForMN(CNode* pnode, CTxIn& vin, CConnman &connman)
 
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetRecvVersion()).Make(NetMsgType::DSEG, vin));
     int64_t askAgain = GetTime() + MASTERNODE_MIN_MNP_SECONDS;
-    mWeAskedForMasternodeListEntry[vin.prevout] = askAgain;
+    mWeAskedForMasternodeListEntry.Set(vin.prevout, askAgain);
 }
 
 void CMasternodeMan::Check()
@@ -102,105 +169,68 @@ void CMasternodeMan::CheckAndRemoveInnactive(bool forceExpiredRemoval)
     LOCK(cs);
 
     //remove inactive and outdated
-    vector<CMasternode>::iterator it = vMasternodes.begin();
-    while (it != vMasternodes.end()) {
-        if ((*it).activeState == CMasternode::MASTERNODE_REMOVE ||
-            (*it).activeState == CMasternode::MASTERNODE_VIN_SPENT ||
-            (forceExpiredRemoval && (*it).activeState == CMasternode::MASTERNODE_EXPIRED) ||
-            (*it).protocolVersion < masternodePayments.GetMinMasternodePaymentsProto()) {
-            LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing inactive Masternode %s - %i now\n", (*it).vin.prevout.hash.ToString(), size() - 1);
+    std::vector<size_t> vRemoved;
+    for (size_t i = 0; i < vMasternodes.size(); i++) {
+        const CMasternode& mn = vMasternodes[i];
+        if (mn.activeState == CMasternode::MASTERNODE_REMOVE ||
+            mn.activeState == CMasternode::MASTERNODE_VIN_SPENT ||
+            (forceExpiredRemoval && mn.activeState == CMasternode::MASTERNODE_EXPIRED) ||
+            mn.protocolVersion < masternodePayments.GetMinMasternodePaymentsProto()) {
+            LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing inactive Masternode %s - %i now\n", mn.vin.prevout.hash.ToString(), size() - vRemoved.size() - 1);
 
             //erase all of the broadcasts we've seen from this vin
             // -- if we missed a few pings and the node was removed, this will allow is to get it back without them
             //    sending a brand new mnb
-            map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
-            while (it3 != mapSeenMasternodeBroadcast.end()) {
-                if ((*it3).second.vin == (*it).vin) {
-                    masternodeSync.mapSeenSyncMNB.erase((*it3).first);
-                    mapSeenMasternodeBroadcast.erase(it3++);
-                } else {
-                    ++it3;
-                }
+            for (const uint256& hash : mapSeenMasternodeBroadcast.EraseOutpoint(mn.vin.prevout)) {
+                masternodeSync.mapSeenSyncMNB.erase(hash);
             }
 
             // allow us to ask for this masternode again if we see another ping
-            map<COutPoint, int64_t>::iterator it2 = mWeAskedForMasternodeListEntry.begin();
-            while (it2 != mWeAskedForMasternodeListEntry.end()) {
-                if ((*it2).first == (*it).vin.prevout) {
-                    mWeAskedForMasternodeListEntry.erase(it2++);
-                } else {
-                    ++it2;
-                }
-            }
+            mWeAskedForMasternodeListEntry.erase(mn.vin.prevout);
 
-            it = vMasternodes.erase(it);
-        } else {
-            ++it;
+            if (pmasternodedb) pmasternodedb->EraseMasternode(mn.vin.prevout);
+            GetMainSignals().MasternodeChanged(mn, MasternodeChange::REMOVED);
+            vRemoved.push_back(i);
         }
     }
 
+    EraseMasternodes(vRemoved);
+
+    const int64_t nNow = GetTime();
+
     // check who's asked for the Masternode list
-    map<CNetAddr, int64_t>::iterator it1 = mAskedUsForMasternodeList.begin();
-    while (it1 != mAskedUsForMasternodeList.end()) {
-        if ((*it1).second < GetTime()) {
-            mAskedUsForMasternodeList.erase(it1++);
-        } else {
-            ++it1;
-        }
-    }
+    mAskedUsForMasternodeList.EraseExpired(nNow);
 
     // check who we asked for the Masternode list
-    it1 = mWeAskedForMasternodeList.begin();
-    while (it1 != mWeAskedForMasternodeList.end()) {
-        if ((*it1).second < GetTime()) {
-            mWeAskedForMasternodeList.erase(it1++);
-        } else {
-            ++it1;
-        }
-    }
+    mWeAskedForMasternodeList.EraseExpired(nNow);
 
     // check which Masternodes we've asked for
-    map<COutPoint, int64_t>::iterator it2 = mWeAskedForMasternodeListEntry.begin();
-    while (it2 != mWeAskedForMasternodeListEntry.end()) {
-        if ((*it2).second < GetTime()) {
-            mWeAskedForMasternodeListEntry.erase(it2++);
-        } else {
-            ++it2;
-        }
-    }
+    mWeAskedForMasternodeListEntry.EraseExpired(nNow);
 
     // remove expired mapSeenMasternodeBroadcast
-    map<uint256, CMasternodeBroadcast>::iterator it3 = mapSeenMasternodeBroadcast.begin();
-    while (it3 != mapSeenMasternodeBroadcast.end()) {
-        if ((*it3).second.lastPing.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
-            mapSeenMasternodeBroadcast.erase(it3++);
-            masternodeSync.mapSeenSyncMNB.erase((*it3).second.GetHash());
-        } else {
-            ++it3;
-        }
+    for (const uint256& hash : mapSeenMasternodeBroadcast.EraseExpired(nNow - (MASTERNODE_REMOVAL_SECONDS * 2))) {
+        masternodeSync.mapSeenSyncMNB.erase(hash);
     }
 
     // remove expired mapSeenMasternodePing
-    map<uint256, CMasternodePing>::iterator it4 = mapSeenMasternodePing.begin();
-    while (it4 != mapSeenMasternodePing.end()) {
-        if ((*it4).second.sigTime < GetTime() - (MASTERNODE_REMOVAL_SECONDS * 2)) {
-            mapSeenMasternodePing.erase(it4++);
-        } else {
-            ++it4;
-        }
-    }
+    mapSeenMasternodePing.EraseExpired(nNow - (MASTERNODE_REMOVAL_SECONDS * 2));
 }
 
 void CMasternodeMan::Clear()
 {
     LOCK(cs);
     vMasternodes.clear();
+    mapOutpointIndex.clear();
+    mapPayeeIndex.clear();
+    mapPubKeyIndex.clear();
     mAskedUsForMasternodeList.clear();
     mWeAskedForMasternodeList.clear();
     mWeAskedForMasternodeListEntry.clear();
     mapSeenMasternodeBroadcast.clear();
     mapSeenMasternodePing.clear();
     nDsqCount = 0;
+    nListVersion++;
+    scoreCache.Clear();
 }
 
 int CMasternodeMan::stable_size ()
@@ -275,9 +305,9 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman &connman)
 
     if (Params().NetworkIDString() == CBaseChainParams::MAIN) {
         if (!(pnode->addr.IsRFC1918() || pnode->addr.IsLocal())) {
-            std::map<CNetAddr, int64_t>::iterator it = mWeAskedForMasternodeList.find(pnode->addr);
-            if (it != mWeAskedForMasternodeList.end()) {
-                if (GetTime() < (*it).second) {
+            int64_t t;
+            if (mWeAskedForMasternodeList.Get(pnode->addr, t)) {
+                if (GetTime() < t) {
                     LogPrint(BCLog::MASTERNODE, "dseg - we already asked peer %i for the list; skipping...\n", pnode->GetId());
                     return;
                 }
@@ -287,31 +317,44 @@ void CMasternodeMan::DsegUpdate(CNode* pnode, CConnman &connman)
 
     connman.PushMessage(pnode, CNetMsgMaker(pnode->GetRecvVersion()).Make(NetMsgType::DSEG, CTxIn()));
     int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
-    mWeAskedForMasternodeList[pnode->addr] = askAgain;
+    mWeAskedForMasternodeList.Set(pnode->addr, askAgain);
 }
 
 CMasternode* CMasternodeMan::Find(const CScript& payee)
 {
     LOCK(cs);
-    CScript payee2;
 
-    for (CMasternode& mn : vMasternodes) {
-        payee2 = GetScriptForDestination(mn.pubKeyCollateralAddress.GetID());
-        if (payee2 == payee)
-            return &mn;
-    }
-    return NULL;
+    CTxDestination dest;
+    if (!ExtractDestination(payee, dest)) return NULL;
+    const CKeyID* keyID = boost::get<CKeyID>(&dest);
+    if (!keyID) return NULL;
+
+    auto it = mapPayeeIndex.find(*keyID);
+    if (it == mapPayeeIndex.end()) return NULL;
+
+    // a pay-to-pubkey script has the same key id, only the exact payee script matches
+    CMasternode& mn = vMasternodes[it->second];
+    if (GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) != payee) return NULL;
+    return &mn;
 }
 
 CMasternode* CMasternodeMan::Find(const CTxIn& vin)
 {
     LOCK(cs);
 
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.vin.prevout == vin.prevout)
-            return &mn;
-    }
-    return NULL;
+    auto it = mapOutpointIndex.find(vin.prevout);
+    if (it == mapOutpointIndex.end()) return NULL;
+    return &vMasternodes[it->second];
+}
+
+bool CMasternodeMan::GetMasternodePubKey(const CTxIn& vin, CPubKey& pubKeyMasternode) const
+{
+    LOCK(cs);
+
+    auto it = mapOutpointIndex.find(vin.prevout);
+    if (it == mapOutpointIndex.end()) return false;
+    pubKeyMasternode = vMasternodes[it->second].pubKeyMasternode;
+    return true;
 }
 
 
@@ -319,11 +362,60 @@ CMasternode* CMasternodeMan::Find(const CPubKey& pubKeyMasternode)
 {
     LOCK(cs);
 
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.pubKeyMasternode == pubKeyMasternode)
-            return &mn;
+    auto it = mapPubKeyIndex.find(pubKeyMasternode.GetID());
+    if (it == mapPubKeyIndex.end()) return NULL;
+
+    CMasternode& mn = vMasternodes[it->second];
+    if (mn.pubKeyMasternode != pubKeyMasternode) return NULL;
+    return &mn;
+}
+
+bool CMasternodeMan::UpdateFromNewBroadcast(CMasternode& mn, CMasternodeBroadcast& mnb, CConnman &connman)
+{
+    LOCK(cs);
+
+    auto it = mapOutpointIndex.find(mn.vin.prevout);
+    if (it == mapOutpointIndex.end() || &vMasternodes[it->second] != &mn)
+        return mn.UpdateFromNewBroadcast(mnb, connman);
+
+    // the broadcast may carry new keys
+    size_t nPosition = it->second;
+    UnindexMasternode(nPosition);
+    bool fUpdated = mn.UpdateFromNewBroadcast(mnb, connman);
+    IndexMasternode(nPosition);
+    if (fUpdated) {
+        Store(mn);
+        GetMainSignals().MasternodeChanged(mn, MasternodeChange::UPDATED);
     }
-    return NULL;
+    return fUpdated;
+}
+
+bool CMasternodeMan::Load(CMasternodeDB& db)
+{
+    const int64_t nStart = GetTimeMillis();
+    std::vector<CMasternode> vLoaded;
+    if (!db.ReadMasternodes(vLoaded))
+        return false;
+
+    LOCK(cs);
+    vMasternodes = std::move(vLoaded);
+    RebuildIndexes();
+
+    // what the list would be relayed with, so the same broadcasts and pings are not processed again
+    for (const CMasternode& mn : vMasternodes) {
+        CMasternodeBroadcast mnb(mn);
+        mapSeenMasternodeBroadcast.insert(std::make_pair(mnb.GetHash(), mnb));
+        if (!(mn.lastPing == CMasternodePing()))
+            mapSeenMasternodePing.insert(std::make_pair(mn.lastPing.GetHash(), mn.lastPing));
+    }
+
+    LogPrintf("Loaded %u masternodes from the masternode database  %dms\n", vMasternodes.size(), GetTimeMillis() - nStart);
+    return true;
+}
+
+void CMasternodeMan::Store(const CMasternode& mn)
+{
+    if (pmasternodedb) pmasternodedb->WriteMasternode(mn);
 }
 
 //
@@ -357,7 +449,7 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
         //make sure it has as many confirmations as there are masternodes
         if (mn.GetMasternodeInputAge() < nMnCount) continue;
 
-        vecMasternodeLastPaid.push_back(std::make_pair(mn.SecondsSincePayment(), mn.vin));
+        vecMasternodeLastPaid.push_back(std::make_pair(mn.SecondsSincePayment(nMnCount), mn.vin));
     }
 
     nCount = (int)vecMasternodeLastPaid.size();
@@ -368,6 +460,8 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
     // Sort them high to low
     sort(vecMasternodeLastPaid.rbegin(), vecMasternodeLastPaid.rend(), CompareLastPaid());
 
+    std::shared_ptr<const CMasternodeScoreSnapshot> scores = GetScores(nBlockHeight - 100);
+
     // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
     //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
     //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
@@ -379,7 +473,9 @@ CMasternode* CMasternodeMan::GetNextMasternodeInQueueForPayment(int nBlockHeight
         CMasternode* pmn = Find(s.second);
         if (!pmn) break;
 
-        arith_uint256 n = pmn->CalculateScore(1, nBlockHeight - 100);
+        arith_uint256 n = 0;
+        size_t nPosition;
+        if (scores && scores->Find(pmn->vin.prevout, nPosition)) n = scores->GetScores()[nPosition].nScore;
         if (n > nHigh) {
             nHigh = n;
             pBestMasternode = pmn;
@@ -402,18 +498,14 @@ CMasternode* CMasternodeMan::FindRandomNotInVec(std::vector<CTxIn>& vecToExclude
 
     int rand = GetRandInt(nCountEnabled - vecToExclude.size());
     LogPrint(BCLog::MASTERNODE, "CMasternodeMan::FindRandomNotInVec - rand %d\n", rand);
-    bool found;
+
+    std::unordered_set<COutPoint, SaltedOutpointHasher> setExclude;
+    for (const CTxIn& usedVin : vecToExclude)
+        setExclude.insert(usedVin.prevout);
 
     for (CMasternode& mn : vMasternodes) {
         if (mn.protocolVersion < protocolVersion || !mn.IsEnabled()) continue;
-        found = false;
-        for(CTxIn& usedVin : vecToExclude) {
-            if (mn.vin.prevout == usedVin.prevout) {
-                found = true;
-                break;
-            }
-        }
-        if (found) continue;
+        if (setExclude.count(mn.vin.prevout)) continue;
         if (--rand < 1) {
             return &mn;
         }
@@ -422,70 +514,90 @@ CMasternode* CMasternodeMan::FindRandomNotInVec(std::vector<CTxIn>& vecToExclude
     return NULL;
 }
 
-CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol)
+std::shared_ptr<const CMasternodeScoreSnapshot> CMasternodeMan::GetScores(int64_t nBlockHeight)
 {
-    int64_t score = 0;
-    CMasternode* winner = NULL;
+    //make sure we know about this block
+    uint256 hash;
+    if (!GetBlockHash(hash, nBlockHeight)) return nullptr;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
-        mn.Check();
-        if (mn.protocolVersion < minProtocol || !mn.IsEnabled()) continue;
+    return scoreCache.Get(hash, vMasternodes);
+}
+
+void CMasternodeMan::CacheScores(int64_t nBlockHeight)
+{
+    LOCK(cs);
+    GetScores(nBlockHeight);
+}
 
-        // calculate the score for each Masternode
-        arith_uint256 n = mn.CalculateScore(mod, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
+std::vector<CMasternode*> CMasternodeMan::RankMasternodes(const CMasternodeScoreSnapshot& scores, const std::function<bool(CMasternode&)>& filter)
+{
+    // every masternode goes to the slot of its score, so the ranking needs no sort
+    std::vector<CMasternode*> vSlots(scores.size(), nullptr);
+    for (CMasternode& mn : vMasternodes) {
+        size_t nPosition;
+        if (filter(mn) && scores.Find(mn.vin.prevout, nPosition))
+            vSlots[nPosition] = &mn;
+    }
 
-        // determine the winner
-        if (n2 > score) {
-            score = n2;
-            winner = &mn;
-        }
+    std::vector<CMasternode*> vRanked;
+    vRanked.reserve(vSlots.size());
+    for (CMasternode* pmn : vSlots) {
+        if (pmn) vRanked.push_back(pmn);
     }
+    return vRanked;
+}
+
+CMasternode* CMasternodeMan::GetCurrentMasterNode(int mod, int64_t nBlockHeight, int minProtocol)
+{
+    std::shared_ptr<const CMasternodeScoreSnapshot> scores = GetScores(nBlockHeight);
+    if (!scores) return NULL;
+
+    std::vector<CMasternode*> vRanked = RankMasternodes(*scores, [minProtocol](CMasternode& mn) {
+        mn.Check();
+        return mn.protocolVersion >= minProtocol && mn.IsEnabled();
+    });
+    if (vRanked.empty()) return NULL;
+
+    // the winner needs a positive score
+    size_t nPosition;
+    scores->Find(vRanked.front()->vin.prevout, nPosition);
+    if (scores->GetScores()[nPosition].nCompactScore <= 0) return NULL;
 
-    return winner;
+    return vRanked.front();
 }
 
 int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<pair<int64_t, CTxIn> > vecMasternodeScores;
     int64_t nMasternode_Min_Age = MN_WINNER_MINIMUM_AGE;
     int64_t nMasternode_Age = 0;
 
-    //make sure we know about this block
-    uint256 hash;
-    if (!GetBlockHash(hash, nBlockHeight)) return -1;
+    std::shared_ptr<const CMasternodeScoreSnapshot> scores = GetScores(nBlockHeight);
+    if (!scores) return -1;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
+    std::vector<CMasternode*> vRanked = RankMasternodes(*scores, [&](CMasternode& mn) {
         if (mn.protocolVersion < minProtocol) {
             LogPrint(BCLog::MASTERNODE,"Skipping Masternode with obsolete version %d\n", mn.protocolVersion);
-            continue;                                                       // Skip obsolete versions
+            return false;                                                   // Skip obsolete versions
         }
 
         if (sporkManager.IsSporkActive(SPORK_8_MASTERNODE_PAYMENT_ENFORCEMENT)) {
             nMasternode_Age = GetAdjustedTime() - mn.sigTime;
             if ((nMasternode_Age) < nMasternode_Min_Age) {
                 LogPrint(BCLog::MASTERNODE,"Skipping just activated Masternode. Age: %ld\n", nMasternode_Age);
-                continue;                                                   // Skip masternodes younger than (default) 1 hour
+                return false;                                               // Skip masternodes younger than (default) 1 hour
             }
         }
         if (fOnlyActive) {
             mn.Check();
-            if (!mn.IsEnabled()) continue;
+            if (!mn.IsEnabled()) return false;
         }
-        arith_uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        vecMasternodeScores.push_back(make_pair(n2, mn.vin));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
+        return true;
+    });
 
     int rank = 0;
-    for (const auto & s : vecMasternodeScores) {
+    for (const CMasternode* pmn : vRanked) {
         rank++;
-        if (s.second.prevout == vin.prevout) {
+        if (pmn->vin.prevout == vin.prevout) {
             return rank;
         }
     }
@@ -495,73 +607,89 @@ int CMasternodeMan::GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, in
 
 std::vector<pair<int, CMasternode> > CMasternodeMan::GetMasternodeRanks(int64_t nBlockHeight, int minProtocol)
 {
-    if (!masternodeSync.IsMasternodeListSynced())
-        return std::vector<pair<int, CMasternode>>();
-
-    std::vector<pair<int64_t, CMasternode> > vecMasternodeScores;
     std::vector<pair<int, CMasternode> > vecMasternodeRanks;
 
-    //make sure we know about this block
-    uint256 hash;
-    if (!GetBlockHash(hash, nBlockHeight)) return vecMasternodeRanks;
+    if (!masternodeSync.IsMasternodeListSynced())
+        return vecMasternodeRanks;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
-        mn.Check();
+    std::shared_ptr<const CMasternodeScoreSnapshot> scores = GetScores(nBlockHeight);
+    if (!scores) return vecMasternodeRanks;
 
-        if (mn.protocolVersion < minProtocol) continue;
+    std::vector<CMasternode*> vRanked = RankMasternodes(*scores, [minProtocol](CMasternode& mn) {
+        mn.Check();
+        return mn.protocolVersion >= minProtocol;
+    });
 
-        if (!mn.IsEnabled()) {
-            vecMasternodeScores.push_back(make_pair(9999, mn));
-            continue;
-        }
+    // disabled masternodes are ranked after all the enabled ones
+    int rank = 0;
+    for (CMasternode* pmn : vRanked) {
+        if (pmn->IsEnabled()) vecMasternodeRanks.push_back(make_pair(++rank, *pmn));
+    }
+    for (CMasternode* pmn : vRanked) {
+        if (!pmn->IsEnabled()) vecMasternodeRanks.push_back(make_pair(++rank, *pmn));
+    }
 
-        arith_uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
+    return vecMasternodeRanks;
+}
 
-        vecMasternodeScores.push_back(make_pair(n2, mn));
+std::shared_ptr<const CMasternodeListSnapshot> CMasternodeMan::GetListSnapshot()
+{
+    uint256 hashBlock;
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip()) hashBlock = chainActive.Tip()->GetBlockHash();
     }
 
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreMN());
+    LOCK(cs);
+    if (listSnapshot && listSnapshot->hashBlock == hashBlock && listSnapshot->nListVersion == nListVersion)
+        return listSnapshot;
 
-    int rank = 0;
-    for (const auto & s : vecMasternodeScores) {
-        rank++;
-        vecMasternodeRanks.push_back(make_pair(rank, s.second));
-    }
+    int64_t nTimeStart = GetTimeMicros();
+    auto snapshot = std::make_shared<CMasternodeListSnapshot>();
+    snapshot->hashBlock = hashBlock;
+    snapshot->nListVersion = nListVersion;
+    snapshot->vEntries.reserve(vMasternodes.size());
 
-    return vecMasternodeRanks;
+    const int nMnCount = CountEnabled();
+    for (CMasternode& mn : vMasternodes) {
+        CMasternodeListEntry entry;
+        entry.outpoint = mn.vin.prevout;
+        entry.strTxHash = mn.vin.prevout.hash.ToString();
+        entry.strNetwork = GetNetworkName(mn.addr.GetNetwork());
+        entry.strStatus = mn.Status();
+        entry.strPayee = EncodeDestination(mn.pubKeyCollateralAddress.GetID());
+        entry.nProtocolVersion = mn.protocolVersion;
+        entry.nLastSeen = mn.lastPing.sigTime;
+        entry.nActiveTime = mn.lastPing.sigTime - mn.sigTime;
+        entry.nLastPaid = mn.GetLastPaid(nMnCount);
+        entry.nTier = mn.nTier;
+        snapshot->vEntries.push_back(std::move(entry));
+    }
+
+    LogPrint(BCLog::MASTERNODE, "CMasternodeMan::GetListSnapshot - %u masternodes at %s in %.2fms\n",
+             snapshot->vEntries.size(), hashBlock.ToString(), (GetTimeMicros() - nTimeStart) * 0.001);
+
+    listSnapshot = std::move(snapshot);
+    return listSnapshot;
 }
 
 CMasternode* CMasternodeMan::GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol, bool fOnlyActive)
 {
-    std::vector<pair<int64_t, CTxIn> > vecMasternodeScores;
+    std::shared_ptr<const CMasternodeScoreSnapshot> scores = GetScores(nBlockHeight);
+    if (!scores) return NULL;
 
-    // scan for winner
-    for (CMasternode& mn : vMasternodes) {
-        if (mn.protocolVersion < minProtocol) continue;
+    std::vector<CMasternode*> vRanked = RankMasternodes(*scores, [minProtocol, fOnlyActive](CMasternode& mn) {
+        if (mn.protocolVersion < minProtocol) return false;
         if (fOnlyActive) {
             mn.Check();
-            if (!mn.IsEnabled()) continue;
+            if (!mn.IsEnabled()) return false;
         }
+        return true;
+    });
 
-        arith_uint256 n = mn.CalculateScore(1, nBlockHeight);
-        int64_t n2 = n.GetCompact(false);
-
-        vecMasternodeScores.push_back(make_pair(n2, mn.vin));
-    }
-
-    sort(vecMasternodeScores.rbegin(), vecMasternodeScores.rend(), CompareScoreTxIn());
-
-    int rank = 0;
-    for (const auto & s : vecMasternodeScores) {
-        rank++;
-        if (rank == nRank) {
-            return Find(s.second);
-        }
-    }
+    if (nRank < 1 || nRank > (int)vRanked.size()) return NULL;
 
-    return NULL;
+    return vRanked[nRank - 1];
 }
 
 void CMasternodeMan::ProcessMasternodeConnections()
@@ -581,46 +709,14 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, CValidationState &state, const
         CMasternodeBroadcast mnb;
         vRecv >> mnb;
 
-        if (mapSeenMasternodeBroadcast.count(mnb.GetHash())) { //seen
-            masternodeSync.AddedMasternodeList(mnb.GetHash());
-            return;
-        }
-        mapSeenMasternodeBroadcast.insert(make_pair(mnb.GetHash(), mnb));
-
-        int nDoS = 0;
-        if (!mnb.CheckAndUpdate(nDoS, connman)) {
-            if (nDoS > 0)
-            {
-                state.DoS(nDoS, false, REJECT_INVALID);
-            }
-
-            //failed
+        const uint256 hash = mnb.GetHash();
+        if (mapSeenMasternodeBroadcast.count(hash) || masternodeVerifier.IsPending(hash)) { //seen
+            masternodeSync.AddedMasternodeList(hash);
             return;
         }
 
-        // make sure the vout that was signed is related to the transaction that spawned the Masternode
-        //  - this is expensive, so it's only done once per Masternode
-        if (!CMessageSigner::IsVinAssociatedWithPubkey(mnb.vin, mnb.pubKeyCollateralAddress, static_cast<CMasternode::Tier>(mnb.nTier))) {
-            LogPrintf("%s : mnb - Got mismatched pubkey and vin\n", __func__);
-            state.DoS(33, false, REJECT_INVALID);
-            return;
-        }
-
-        // make sure it's still unspent
-        //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
-        if (mnb.CheckInputsAndAdd(nDoS, connman)) {
-            // use this as a peer
-            connman.AddNewAddresses({CAddress(mnb.addr, NODE_NETWORK)}, pfrom->addr, 2 * 60 * 60);
-
-            masternodeSync.AddedMasternodeList(mnb.GetHash());
-        } else {
-            LogPrintf("%s : - Rejected Masternode entry %s\n", __func__, mnb.vin.prevout.hash.ToString());
-
-            if (nDoS > 0)
-            {
-                state.DoS(nDoS, false, REJECT_INVALID);
-            }
-        }
+        // the signature is checked on the verification thread, which applies the broadcast afterwards
+        if (!masternodeVerifier.AddBroadcast(pfrom, mnb)) ProcessBroadcast(pfrom, state, mnb, connman);
     }
 
     else if (strCommand == NetMsgType::MNPING) { //Masternode Ping
@@ -629,25 +725,10 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, CValidationState &state, const
 
         LogPrint(BCLog::MASTERNODE, "mnp - Masternode ping, vin: %s\n", mnp.vin.prevout.hash.ToString());
 
-        if (mapSeenMasternodePing.count(mnp.GetHash())) return; //seen
-        mapSeenMasternodePing.insert(make_pair(mnp.GetHash(), mnp));
-
-        int nDoS = 0;
-        if (mnp.CheckAndUpdate(nDoS, true, connman)) return;
-
-        if (nDoS > 0) {
-            // if anything significant failed, mark that node
-            state.DoS(nDoS, false, REJECT_INVALID);
-        } else {
-            // if nothing significant failed, search existing Masternode list
-            CMasternode* pmn = Find(mnp.vin);
-            // if it's known, don't ask for the mnb, just return
-            if (pmn != NULL) return;
-        }
+        const uint256 hash = mnp.GetHash();
+        if (mapSeenMasternodePing.count(hash) || masternodeVerifier.IsPending(hash)) return; //seen
 
-        // something significant is broken or mn is unknown,
-        // we might have to ask for a masternode entry once
-        AskForMN(pfrom, mnp.vin, connman);
+        if (!masternodeVerifier.AddPing(pfrom, mnp)) ProcessPing(pfrom, state, mnp, connman);
 
     } else if (strCommand == NetMsgType::DSEG) { //Get Masternode list or specific entry
 
@@ -659,9 +740,8 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, CValidationState &state, const
             bool isLocal = (pfrom->addr.IsRFC1918() || pfrom->addr.IsLocal());
 
             if (!isLocal && Params().NetworkIDString() == CBaseChainParams::MAIN) {
-                std::map<CNetAddr, int64_t>::iterator i = mAskedUsForMasternodeList.find(pfrom->addr);
-                if (i != mAskedUsForMasternodeList.end()) {
-                    int64_t t = (*i).second;
+                int64_t t;
+                if (mAskedUsForMasternodeList.Get(pfrom->addr, t)) {
                     if (GetTime() < t) {
                         state.DoS(34, false, REJECT_INVALID);
                         LogPrintf("%s : dseg - peer already asked me for the list\n", __func__);
@@ -669,7 +749,7 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, CValidationState &state, const
                     }
                 }
                 int64_t askAgain = GetTime() + MASTERNODES_DSEG_SECONDS;
-                mAskedUsForMasternodeList[pfrom->addr] = askAgain;
+                mAskedUsForMasternodeList.Set(pfrom->addr, askAgain);
             }
         } //else, asking for a specific node which is ok
 
@@ -704,19 +784,90 @@ void CMasternodeMan::ProcessMessage(CNode* pfrom, CValidationState &state, const
     }
 }
 
-void CMasternodeMan::Remove(CTxIn vin)
+void CMasternodeMan::ProcessBroadcast(CNode* pfrom, CValidationState& state, CMasternodeBroadcast& mnb, CConnman& connman)
 {
-    LOCK(cs);
+    LOCK(cs_process_message);
 
-    vector<CMasternode>::iterator it = vMasternodes.begin();
-    while (it != vMasternodes.end()) {
-        if ((*it).vin == vin) {
-            LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", (*it).vin.prevout.hash.ToString(), size() - 1);
-            vMasternodes.erase(it);
-            break;
+    if (mapSeenMasternodeBroadcast.count(mnb.GetHash())) { //seen
+        masternodeSync.AddedMasternodeList(mnb.GetHash());
+        return;
+    }
+    mapSeenMasternodeBroadcast.insert(make_pair(mnb.GetHash(), mnb));
+
+    int nDoS = 0;
+    if (!mnb.CheckAndUpdate(nDoS, connman)) {
+        if (nDoS > 0)
+        {
+            state.DoS(nDoS, false, REJECT_INVALID);
         }
-        ++it;
+
+        //failed
+        return;
     }
+
+    // make sure the vout that was signed is related to the transaction that spawned the Masternode
+    //  - this is expensive, so it's only done once per Masternode
+    if (!CMessageSigner::IsVinAssociatedWithPubkey(mnb.vin, mnb.pubKeyCollateralAddress, static_cast<CMasternode::Tier>(mnb.nTier))) {
+        LogPrintf("%s : mnb - Got mismatched pubkey and vin\n", __func__);
+        state.DoS(33, false, REJECT_INVALID);
+        return;
+    }
+
+    // make sure it's still unspent
+    //  - this is checked later by .check() in many places and by ThreadCheckObfuScationPool()
+    if (mnb.CheckInputsAndAdd(nDoS, connman)) {
+        // use this as a peer
+        connman.AddNewAddresses({CAddress(mnb.addr, NODE_NETWORK)}, pfrom->addr, 2 * 60 * 60);
+
+        masternodeSync.AddedMasternodeList(mnb.GetHash());
+    } else {
+        LogPrintf("%s : - Rejected Masternode entry %s\n", __func__, mnb.vin.prevout.hash.ToString());
+
+        if (nDoS > 0)
+        {
+            state.DoS(nDoS, false, REJECT_INVALID);
+        }
+    }
+}
+
+void CMasternodeMan::ProcessPing(CNode* pfrom, CValidationState& state, CMasternodePing& mnp, CConnman& connman)
+{
+    LOCK(cs_process_message);
+
+    if (mapSeenMasternodePing.count(mnp.GetHash())) return; //seen
+    mapSeenMasternodePing.insert(make_pair(mnp.GetHash(), mnp));
+
+    int nDoS = 0;
+    if (mnp.CheckAndUpdate(nDoS, true, connman)) return;
+
+    if (nDoS > 0) {
+        // if anything significant failed, mark that node
+        state.DoS(nDoS, false, REJECT_INVALID);
+    } else {
+        // if nothing significant failed, search existing Masternode list
+        CMasternode* pmn = Find(mnp.vin);
+        // if it's known, don't ask for the mnb, just return
+        if (pmn != NULL) return;
+    }
+
+    // something significant is broken or mn is unknown,
+    // we might have to ask for a masternode entry once
+    AskForMN(pfrom, mnp.vin, connman);
+}
+
+void CMasternodeMan::Remove(CTxIn vin)
+{
+    LOCK(cs);
+
+    auto it = mapOutpointIndex.find(vin.prevout);
+    if (it == mapOutpointIndex.end()) return;
+    const CMasternode& mn = vMasternodes[it->second];
+    if (mn.vin != vin) return;
+
+    LogPrint(BCLog::MASTERNODE, "CMasternodeMan: Removing Masternode %s - %i now\n", mn.vin.prevout.hash.ToString(), size() - 1);
+    if (pmasternodedb) pmasternodedb->EraseMasternode(mn.vin.prevout);
+    GetMainSignals().MasternodeChanged(mn, MasternodeChange::REMOVED);
+    EraseMasternodes({it->second});
 }
 
 void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman &connman)
@@ -733,7 +884,7 @@ void CMasternodeMan::UpdateMasternodeList(CMasternodeBroadcast mnb, CConnman &co
         if (Add(mn)) {
             masternodeSync.AddedMasternodeList(mnb.GetHash());
         }
-    } else if (pmn->UpdateFromNewBroadcast(mnb, connman)) {
+    } else if (UpdateFromNewBroadcast(*pmn, mnb, connman)) {
         masternodeSync.AddedMasternodeList(mnb.GetHash());
     }
 }
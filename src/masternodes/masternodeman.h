@@ -7,20 +7,63 @@
 #define MASTERNODEMAN_H
 
 #include <base58.h>
+#include <coins.h>
 #include <key.h>
 #include <masternodes/masternode.h>
+#include <masternodes/masternode-scores.h>
+#include <masternodes/masternode-seen.h>
 #include <net.h>
 #include <sync.h>
 
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
 #define MASTERNODES_DUMP_SECONDS (15 * 60)
 #define MASTERNODES_DSEG_SECONDS (3 * 60 * 60)
 
 using namespace std;
 
+class CMasternodeDB;
 class CMasternodeMan;
 
 extern CMasternodeMan mnodeman;
 
+class SaltedKeyIDHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedKeyIDHasher();
+
+    size_t operator()(const CKeyID& id) const;
+};
+
+/** What listmasternodes reports about a masternode, computed when the list snapshot is built */
+struct CMasternodeListEntry
+{
+    COutPoint outpoint;
+    std::string strTxHash;
+    std::string strNetwork;
+    std::string strStatus;
+    std::string strPayee;
+    int nProtocolVersion;
+    int64_t nLastSeen;
+    int64_t nActiveTime;
+    int64_t nLastPaid;
+    int nTier;
+};
+
+/** The masternode list as of one block, never modified once built */
+struct CMasternodeListSnapshot
+{
+    uint256 hashBlock;
+    unsigned int nListVersion;
+    std::vector<CMasternodeListEntry> vEntries;
+};
+
 class CMasternodeMan
 {
 private:
@@ -32,18 +75,39 @@ private:
 
     // map to hold all MNs
     std::vector<CMasternode> vMasternodes;
+    // positions in vMasternodes by collateral outpoint, collateral key (payee) and masternode key
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapOutpointIndex;
+    std::unordered_map<CKeyID, size_t, SaltedKeyIDHasher> mapPayeeIndex;
+    std::unordered_map<CKeyID, size_t, SaltedKeyIDHasher> mapPubKeyIndex;
     // who's asked for the Masternode list and the last time
-    std::map<CNetAddr, int64_t> mAskedUsForMasternodeList;
+    CAskedTimes<CNetAddr> mAskedUsForMasternodeList;
     // who we asked for the Masternode list and the last time
-    std::map<CNetAddr, int64_t> mWeAskedForMasternodeList;
+    CAskedTimes<CNetAddr> mWeAskedForMasternodeList;
     // which Masternodes we've asked for
-    std::map<COutPoint, int64_t> mWeAskedForMasternodeListEntry;
+    CAskedTimes<COutPoint> mWeAskedForMasternodeListEntry;
+    // scores of the masternodes at the recent blocks, not serialized
+    CMasternodeScoreCache scoreCache;
+    // changes whenever masternodes are added, removed or rekeyed
+    unsigned int nListVersion;
+    std::shared_ptr<const CMasternodeListSnapshot> listSnapshot;
+
+    void IndexMasternode(size_t nPosition);
+    void UnindexMasternode(size_t nPosition);
+    /// Erase the entries at the ascending vPositions, keeping the order of the others
+    void EraseMasternodes(const std::vector<size_t>& vPositions);
+    /// Index all of vMasternodes again, after it was read
+    void RebuildIndexes();
+
+    /// Scores of all the masternodes at nBlockHeight, null when the block is unknown
+    std::shared_ptr<const CMasternodeScoreSnapshot> GetScores(int64_t nBlockHeight);
+    /// Masternodes accepted by filter, from the best score to the worst
+    std::vector<CMasternode*> RankMasternodes(const CMasternodeScoreSnapshot& scores, const std::function<bool(CMasternode&)>& filter);
 
 public:
     // Keep track of all broadcasts I've seen
-    map<uint256, CMasternodeBroadcast> mapSeenMasternodeBroadcast;
+    CSeenMasternodeMessages<CMasternodeBroadcast> mapSeenMasternodeBroadcast;
     // Keep track of all pings I've seen
-    map<uint256, CMasternodePing> mapSeenMasternodePing;
+    CSeenMasternodeMessages<CMasternodePing> mapSeenMasternodePing;
 
     // keep track of dsq count to prevent masternodes from gaming obfuscation queue
     int64_t nDsqCount;
@@ -55,6 +119,7 @@ public:
     {
         LOCK(cs);
         READWRITE(vMasternodes);
+        if (ser_action.ForRead()) RebuildIndexes();
         READWRITE(mAskedUsForMasternodeList);
         READWRITE(mWeAskedForMasternodeList);
         READWRITE(mWeAskedForMasternodeListEntry);
@@ -93,10 +158,20 @@ public:
     CMasternode* Find(const CScript& payee);
     CMasternode* Find(const CTxIn& vin);
     CMasternode* Find(const CPubKey& pubKeyMasternode);
+    /// Copy the masternode key of an entry, false if there is none
+    bool GetMasternodePubKey(const CTxIn& vin, CPubKey& pubKeyMasternode) const;
 
     /// Find an entry in the masternode list that is next to be paid
     CMasternode* GetNextMasternodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCount);
 
+    /// Update an entry from a newer broadcast, keeping the lookups in sync with its keys
+    bool UpdateFromNewBroadcast(CMasternode& mn, CMasternodeBroadcast& mnb, CConnman &connman);
+
+    /// Restore the list from the masternode database
+    bool Load(CMasternodeDB& db);
+    /// Write an entry that was changed in place to the masternode database
+    void Store(const CMasternode& mn);
+
     /// Find a random entry
     CMasternode* FindRandomNotInVec(std::vector<CTxIn>& vecToExclude, int protocolVersion = -1);
 
@@ -108,6 +183,12 @@ public:
         return vMasternodes;
     }
 
+    /// The masternode list at the tip, rebuilt at most once per block or list change
+    std::shared_ptr<const CMasternodeListSnapshot> GetListSnapshot();
+
+    /// Score all the masternodes at nBlockHeight ahead of the ranking calls
+    void CacheScores(int64_t nBlockHeight);
+
     std::vector<pair<int, CMasternode> > GetMasternodeRanks(int64_t nBlockHeight, int minProtocol = 0);
     int GetMasternodeRank(const CTxIn& vin, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
     CMasternode* GetMasternodeByRank(int nRank, int64_t nBlockHeight, int minProtocol = 0, bool fOnlyActive = true);
@@ -116,6 +197,11 @@ public:
 
     void ProcessMessage(CNode* pfrom, CValidationState &state, const std::string& strCommand, CDataStream& vRecv, CConnman &connman);
 
+    /// Check a broadcast received from pfrom and add or update its masternode
+    void ProcessBroadcast(CNode* pfrom, CValidationState& state, CMasternodeBroadcast& mnb, CConnman& connman);
+    /// Check a ping received from pfrom and update its masternode, asking pfrom for unknown ones
+    void ProcessPing(CNode* pfrom, CValidationState& state, CMasternodePing& mnp, CConnman& connman);
+
     /// Return the number of (unique) Masternodes
     int size() { return vMasternodes.size(); }
 
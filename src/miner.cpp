@@ -26,6 +26,7 @@
 #include <validationinterface.h>
 #include <wallet/wallet.h>
 #include <blocksigner.h>
+#include <consensus/kernel.h>
 #include <masternodes/masternode-sync.h>
 
 #include <boost/thread.hpp>
@@ -91,6 +92,17 @@ BlockAssembler::BlockAssembler(const CChainParams& params) :
     nLastCoinStakeSearchInterval = GetAdjustedTime();
 }
 
+// Proof-of-stake kernel search state. It is captured under cs_main and
+// searched without any global lock before the block is assembled.
+struct CStakeSearch
+{
+    CStakeKernelContext context;
+    std::vector<CStakeCandidate> vCandidates;
+    CWallet::StakeCoinsSet setCombineCoins;
+    const CStakeCandidate* pkernel = nullptr;
+    unsigned int nTxNewTime = 0;
+};
+
 void BlockAssembler::resetBlock()
 {
     inBlock.clear();
@@ -124,10 +136,41 @@ static bool SignInputsInCoinstake(const SigningProvider &provider, CMutableTrans
     return true;
 }
 
+bool BlockAssembler::SearchStakeKernel(CWallet *wallet, CStakeSearch &search)
+{
+    assert(wallet);
+    boost::this_thread::interruption_point();
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindexPrev = chainActive.Tip();
+        assert(pindexPrev != nullptr);
+        CBlockHeader header;
+        header.nTime = GetAdjustedTime();
+        search.context.Init(pindexPrev, GetNextWorkRequired(pindexPrev, &header, chainparams.GetConsensus()));
+        bool fGenerateSegwit = IsWitnessEnabled(search.context.nHeight, chainparams.GetConsensus());
+        if (!wallet->SelectStakeCandidates(search.context, fGenerateSegwit, search.vCandidates, search.setCombineCoins))
+            return false;
+    }
+
+    bool fStakeFound = false;
+    int64_t nSearchTime = GetAdjustedTime(); // search to current time
+    if (nSearchTime >= nLastCoinStakeSearchTime) {
+        fStakeFound = wallet->FindStakeKernel(search.context, search.vCandidates, search.pkernel, search.nTxNewTime);
+        nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
+        nLastCoinStakeSearchTime = nSearchTime;
+    }
+
+    return fStakeFound;
+}
+
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet, const CScript &scriptPubKeyIn, bool fProofOfStake, bool fMineWitnessTx)
 {
     int64_t nTimeStart = GetTimeMicros();
 
+    CStakeSearch stakeSearch;
+    if (fProofOfStake && !SearchStakeKernel(wallet, stakeSearch))
+        return nullptr;
+
     resetBlock();
 
     pblocktemplate.reset(new CBlockTemplate());
@@ -144,6 +187,10 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     LOCK2(cs_main, mempool.cs);
     CBlockIndex* pindexPrev = chainActive.Tip();
     assert(pindexPrev != nullptr);
+    if (fProofOfStake && pindexPrev != stakeSearch.context.pindexPrev) {
+        LogPrint(BCLog::MINER, "CreateNewBlock(): chain tip changed after the kernel search\n");
+        return nullptr;
+    }
     nHeight = pindexPrev->nHeight + 1;
 
     pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
@@ -186,29 +233,15 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(CWallet *wallet,
     std::vector<const CWalletTx*> vwtxPrev;
     if(fProofOfStake)
     {
-        assert(wallet);
-        boost::this_thread::interruption_point();
-        pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
+        pblock->nBits = stakeSearch.context.nBits;
         CMutableTransaction coinstakeTx;
-        int64_t nSearchTime = pblock->nTime; // search to current time
-        bool fStakeFound = false;
-        if (nSearchTime >= nLastCoinStakeSearchTime) {
-            unsigned int nTxNewTime = 0;
-            if (wallet->CreateCoinStake(pblock->nBits, blockReward,
-                                        coinstakeTx, nTxNewTime, vwtxPrev, fIncludeWitness))
-            {
-                pblock->nTime = nTxNewTime;
-                coinbaseTx.vout[0].SetEmpty();
-                pblock->vtx.emplace_back(MakeTransactionRef(coinstakeTx));
-                fStakeFound = true;
-            }
-
-            nLastCoinStakeSearchInterval = nSearchTime - nLastCoinStakeSearchTime;
-            nLastCoinStakeSearchTime = nSearchTime;
-        }
-
-        if (!fStakeFound)
+        if (!wallet->CreateCoinStake(stakeSearch.context, *stakeSearch.pkernel, stakeSearch.setCombineCoins,
+                                     blockReward, coinstakeTx, vwtxPrev))
             return nullptr;
+
+        pblock->nTime = stakeSearch.nTxNewTime;
+        coinbaseTx.vout[0].SetEmpty();
+        pblock->vtx.emplace_back(MakeTransactionRef(coinstakeTx));
     }
     else
     {
@@ -542,13 +575,13 @@ static bool ProcessBlockFound(const std::shared_ptr<const CBlock> &pblock, const
             return error("ProcessBlockFound -- generated block is stale");
     }
 
-    // Inform about the new block
-    // GetMainSignals().BlockFound(pblock->GetHash());
-
     // Process this block the same as if we had received it from another node
     if (!ProcessNewBlock(chainparams, pblock, true, nullptr))
         return error("ProcessBlockFound -- ProcessNewBlock() failed, block not accepted");
 
+    // Inform about the new block
+    GetMainSignals().BlockFound(pblock);
+
     return true;
 }
 
@@ -638,9 +671,15 @@ void static DIVIMiner(const CChainParams& chainparams, CConnman& connman,
 
 
             // check if block is valid
-            CValidationState state;
-            if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
-                throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+            {
+                LOCK(cs_main);
+                if (pindexPrev != chainActive.Tip())
+                    continue;
+
+                CValidationState state;
+                if (!TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+                    throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+                }
             }
 
             MilliSleep(10000);
@@ -20,6 +20,7 @@ class CChainParams;
 class CWallet;
 class CScript;
 class CConnman;
+struct CStakeSearch;
 
 namespace Consensus { struct Params; };
 
@@ -174,6 +175,10 @@ private:
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
+    /** Search for a stake kernel on top of the current tip. Only takes cs_main
+      * to capture the tip and the stake candidates, the search itself runs
+      * without any global lock held. */
+    bool SearchStakeKernel(CWallet* wallet, CStakeSearch& search) LOCKS_EXCLUDED(cs_main, mempool.cs);
     /** Add a tx to the block */
     void AddToBlock(CTxMemPool::txiter iter);
 
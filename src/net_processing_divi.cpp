@@ -8,6 +8,7 @@
 #include <boost/thread.hpp>
 #include <masternodes/masternode-payments.h>
 #include <masternodes/masternode-sync.h>
+#include <masternodes/masternode-verifier.h>
 #include <masternodes/masternodeman.h>
 #include <masternodes/masternode.h>
 
@@ -86,14 +87,16 @@ static const MapSporkHandlers &GetMapGetDataHandlers()
                         return {};
                     });
         ADD_HANDLER(MSG_MASTERNODE_ANNOUNCE, {
-                        if(mnodeman.mapSeenMasternodeBroadcast.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MNANNOUNCE, mnodeman.mapSeenMasternodeBroadcast[hash]);
+                        CMasternodeBroadcast mnb;
+                        if(mnodeman.mapSeenMasternodeBroadcast.Get(hash, mnb)) {
+                            return msgMaker.Make(NetMsgType::MNANNOUNCE, mnb);
                         }
                         return {};
                     });
         ADD_HANDLER(MSG_MASTERNODE_PING, {
-                        if(mnodeman.mapSeenMasternodePing.count(hash)) {
-                            return msgMaker.Make(NetMsgType::MNPING, mnodeman.mapSeenMasternodePing[hash]);
+                        CMasternodePing mnp;
+                        if(mnodeman.mapSeenMasternodePing.Get(hash, mnp)) {
+                            return msgMaker.Make(NetMsgType::MNPING, mnp);
                         }
                         return {};
                     });
@@ -222,13 +225,13 @@ bool net_processing_divi::AlreadyHave(const CInv &inv)
         return mapSporks.count(inv.hash);
 
     case MSG_MASTERNODE_WINNER:
-        return masternodePayments.mapMasternodePayeeVotes.count(inv.hash);
+        return masternodePayments.mapMasternodePayeeVotes.count(inv.hash) || masternodeVerifier.IsPending(inv.hash);
 
     case MSG_MASTERNODE_ANNOUNCE:
-        return mnodeman.mapSeenMasternodeBroadcast.count(inv.hash);
+        return mnodeman.mapSeenMasternodeBroadcast.count(inv.hash) || masternodeVerifier.IsPending(inv.hash);
 
     case MSG_MASTERNODE_PING:
-        return mnodeman.mapSeenMasternodePing.count(inv.hash);
+        return mnodeman.mapSeenMasternodePing.count(inv.hash) || masternodeVerifier.IsPending(inv.hash);
     }
     return true;
 }
@@ -151,6 +151,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "logging", 1, "exclude" },
     { "disconnectnode", 1, "nodeid" },
     { "getaddressutxos", 0, "addresses" },
+    { "getaddressbalance", 0, "addresses" },
+    { "getaddresstxids", 0, "addresses" },
+    { "getaddressdeltas", 0, "addresses" },
+    { "getaddressmempool", 0, "addresses" },
+    { "getspentinfo", 0, "json" },
+    { "listmasternodes", 1, "offset" },
+    { "listmasternodes", 2, "limit" },
     // Echo with conversion (For testing only)
     { "echojson", 0, "arg0" },
     { "echojson", 1, "arg1" },
@@ -167,7 +174,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "createwallet", 1, "disable_private_keys"},
     { "getnodeaddresses", 0, "count"},
     { "stop", 0, "wait" },
-    { "setstakesplitthreshold", 0, "threshold"}
+    { "setstakesplitthreshold", 0, "threshold"},
+    { "walletverify", 0, "verbose"}
 };
 // clang-format on
 
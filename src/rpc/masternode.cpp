@@ -25,6 +25,7 @@
 #include <boost/algorithm/string.hpp>
 #include <univalue.h>
 #include <fstream>
+#include <limits>
 
 static CMasternode::Tier GetMasternodeTierFromString(std::string str)
 {
@@ -222,78 +223,77 @@ string nodeHelp(string indent = "")
 
 static UniValue listmasternodes(const JSONRPCRequest& request)
 {
-    std::string strFilter = "";
-
-    if (request.params.size() == 1) strFilter = request.params[0].get_str();
-
-    if (request.fHelp || (request.params.size() > 1))
+    if (request.fHelp || (request.params.size() > 3))
         throw runtime_error(
-                "listmasternodes ( \"filter\" )\n"
-                "\nGet a ranked list of masternodes\n"
+                "listmasternodes ( \"filter\" offset limit )\n"
+                "\nGet the list of masternodes, as of the last block\n"
 
                 "\nArguments:\n"
                 "1. \"filter\"    (string, optional) Filter search text. Partial match by txhash, status, or addr.\n"
+                "2. offset      (numeric, optional, default=0) The number of matching masternodes to skip\n"
+                "3. limit       (numeric, optional, default=all) The number of matching masternodes to return\n"
 
                 "\nResult:\n"
                 "[\n"
                 "  {\n"
-                "    \"rank\": n,           (numeric) Masternode Rank (or 0 if not enabled)\n"
+                "    \"network\": \"net\",    (string) Network of the masternode address (ipv4/ipv6/onion)\n"
                 "    \"txhash\": \"hash\",    (string) Collateral transaction hash\n"
                 "    \"outidx\": n,         (numeric) Collateral transaction output index\n"
                 "    \"status\": s,         (string) Status (ENABLED/EXPIRED/REMOVE/etc)\n"
-                "    \"addr\": \"addr\",      (string) Masternode PIVX address\n"
+                "    \"addr\": \"addr\",      (string) Masternode DIVI address\n"
                 "    \"version\": v,        (numeric) Masternode protocol version\n"
                 "    \"lastseen\": ttt,     (numeric) The time in seconds since epoch (Jan 1 1970 GMT) of the last seen\n"
-                "    \"activetime\": ttt,   (numeric) The time in seconds since epoch (Jan 1 1970 GMT) masternode has been active\n"
+                "    \"activetime\": ttt,   (numeric) The time in seconds masternode has been active\n"
                 "    \"lastpaid\": ttt,     (numeric) The time in seconds since epoch (Jan 1 1970 GMT) masternode was last paid\n"
+                "    \"tier\": \"tier\",      (string) Masternode tier\n"
                 "  }\n"
                 "  ,...\n"
                 "]\n"
                 "\nExamples:\n" +
-                HelpExampleCli("masternodelist", "") + HelpExampleRpc("masternodelist", ""));
+                HelpExampleCli("listmasternodes", "") + HelpExampleCli("listmasternodes", "\"ENABLED\" 100 50") +
+                HelpExampleRpc("listmasternodes", "\"ENABLED\", 100, 50"));
+
+    std::string strFilter;
+    if (!request.params[0].isNull()) strFilter = request.params[0].get_str();
+
+    int nOffset = 0;
+    if (!request.params[1].isNull()) nOffset = request.params[1].get_int();
+    if (nOffset < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative offset");
+
+    int nLimit = std::numeric_limits<int>::max();
+    if (!request.params[2].isNull()) nLimit = request.params[2].get_int();
+    if (nLimit < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative limit");
+
+    std::shared_ptr<const CMasternodeListSnapshot> snapshot = mnodeman.GetListSnapshot();
+    if (snapshot->hashBlock.IsNull()) return 0;
 
     UniValue ret(UniValue::VARR);
-    int nHeight;
-    {
-        LOCK(cs_main);
-        CBlockIndex* pindex = chainActive.Tip();
-        if(!pindex) return 0;
-        nHeight = pindex->nHeight;
-    }
-    for(auto &&entry : mnodeman.GetFullMasternodeVector()) {
-        UniValue obj(UniValue::VOBJ);
-        std::string strVin = entry.vin.prevout.ToStringShort();
-        std::string strTxHash = entry.vin.prevout.hash.ToString();
-        uint32_t oIdx = entry.vin.prevout.n;
-
-        CMasternode* mn = mnodeman.Find(entry.vin);
-
-        if (mn != NULL) {
-            if (strFilter != "" && strTxHash.find(strFilter) == string::npos &&
-                    mn->Status().find(strFilter) == string::npos &&
-                    EncodeDestination(mn->pubKeyCollateralAddress.GetID()).find(strFilter) == string::npos) continue;
-
-            std::string strStatus = mn->Status();
-            std::string strHost;
-            int port;
-            SplitHostPort(mn->addr.ToString(), port, strHost);
-            CNetAddr node;
-            LookupHost(strHost.c_str(), node, false);
-            std::string strNetwork = GetNetworkName(node.GetNetwork());
-
-            obj.pushKV("network", strNetwork);
-            obj.pushKV("txhash", strTxHash);
-            obj.pushKV("outidx", (uint64_t)oIdx);
-            obj.pushKV("status", strStatus);
-            obj.pushKV("addr", EncodeDestination(mn->pubKeyCollateralAddress.GetID()));
-            obj.pushKV("version", mn->protocolVersion);
-            obj.pushKV("lastseen", (int64_t)mn->lastPing.sigTime);
-            obj.pushKV("activetime", (int64_t)(mn->lastPing.sigTime - mn->sigTime));
-            obj.pushKV("lastpaid", (int64_t)mn->GetLastPaid());
-            obj.pushKV("tier", CMasternode::TierToString(static_cast<CMasternode::Tier>(mn->nTier)));
-
-            ret.push_back(obj);
+    for (const CMasternodeListEntry& entry : snapshot->vEntries) {
+        if (!strFilter.empty() && entry.strTxHash.find(strFilter) == string::npos &&
+                entry.strStatus.find(strFilter) == string::npos &&
+                entry.strPayee.find(strFilter) == string::npos) continue;
+
+        if (nOffset > 0) {
+            nOffset--;
+            continue;
         }
+        if ((int)ret.size() >= nLimit) break;
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("network", entry.strNetwork);
+        obj.pushKV("txhash", entry.strTxHash);
+        obj.pushKV("outidx", (uint64_t)entry.outpoint.n);
+        obj.pushKV("status", entry.strStatus);
+        obj.pushKV("addr", entry.strPayee);
+        obj.pushKV("version", entry.nProtocolVersion);
+        obj.pushKV("lastseen", entry.nLastSeen);
+        obj.pushKV("activetime", entry.nActiveTime);
+        obj.pushKV("lastpaid", entry.nLastPaid);
+        obj.pushKV("tier", CMasternode::TierToString(static_cast<CMasternode::Tier>(entry.nTier)));
+
+        ret.push_back(obj);
     }
 
     return ret;
@@ -502,13 +502,13 @@ UniValue mnsync(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
-  { "masternode",            "listmasternodes",          &listmasternodes,          {"filter"} },
+  { "masternode",            "listmasternodes",          &listmasternodes,          {"filter", "offset", "limit"} },
   { "masternode",            "mnsync",                   &mnsync,                   {"command"} },
   { "masternode",            "getmasternodestatus",      &getmasternodestatus,      {}},
   { "masternode",            "startmasternode",          &startmasternode,          {"alias"}},
   { "masternode",            "getmasternodecount",       &getmasternodecount,       {}},
   { "masternode",            "masternodeconnect",        &masternodeconnect,        {"address"}},
-  { "masternode",            "listmasternodes",          &listmasternodes,          {"filter"}},
+  { "masternode",            "listmasternodes",          &listmasternodes,          {"filter", "offset", "limit"}},
   { "masternode",            "fundmasternode",           &fundmasternode,           {"alias", "amount", "txid", "type"}},
   { "masternode",            "allocatefunds",            &allocatefunds,            {"purpose", "identifier", "amount"}},
 };
@@ -10,6 +10,8 @@
 #include <key_io.h>
 #include <validation.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
 #include <net.h>
 #include <netbase.h>
 #include <outputtype.h>
@@ -17,13 +19,16 @@
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <timedata.h>
+#include <txmempool.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <warnings.h>
 #include <spork.h>
 #include <script/standard.h>
 
+#include <set>
 #include <stdint.h>
+#include <tuple>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
 #endif
@@ -285,6 +290,20 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCBlockIndexMemoryInfo()
+{
+    size_t nEntries;
+    {
+        LOCK(cs_main);
+        nEntries = mapBlockIndex.size();
+    }
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("entries", uint64_t(nEntries));
+    obj.pushKV("entry_size", uint64_t(sizeof(CBlockIndex)));
+    obj.pushKV("lottery_winners_cached", uint64_t(GetLotteryWinnersCacheSize()));
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -328,6 +347,11 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"blockindex\": {           (json object) Information about the in-memory block index\n"
+            "    \"entries\": xxxxx,       (numeric) Number of block index entries\n"
+            "    \"entry_size\": xxx,      (numeric) Bytes per entry, lottery winners and zerocoin fields are kept out of it\n"
+            "    \"lottery_winners_cached\": xxxxx, (numeric) Number of entries with their lottery winners in memory\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
@@ -341,6 +365,7 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("locked", RPCLockedMemoryInfo());
+        obj.pushKV("blockindex", RPCBlockIndexMemoryInfo());
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -422,6 +447,36 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint16
     return true;
 }
 
+static AddressIndex& EnsureAddressIndex()
+{
+    if (!g_addressindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled. Start with -addressindex to use this command");
+    }
+    // Answer from an index that has caught up with the chain as of this call
+    g_addressindex->BlockUntilSyncedToCurrentChain();
+    return *g_addressindex;
+}
+
+/** Read the optional "start" and "end" heights of an address query object. */
+static void getHeightRangeFromParams(const UniValue& params, int& start, int& end)
+{
+    start = 0;
+    end = 0;
+    if (!params[0].isObject()) return;
+
+    const UniValue& startValue = find_value(params[0].get_obj(), "start");
+    const UniValue& endValue = find_value(params[0].get_obj(), "end");
+    if (startValue.isNull() && endValue.isNull()) return;
+    if (!startValue.isNum() || !endValue.isNum()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Start and end are expected to be both set");
+    }
+    start = startValue.get_int();
+    end = endValue.get_int();
+    if (start <= 0 || end <= 0 || end < start) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Start and end are expected to be a positive height range");
+    }
+}
+
 static UniValue getaddressutxos(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -457,11 +512,19 @@ static UniValue getaddressutxos(const JSONRPCRequest& request)
     if (!getAddressesFromParams(request.params, addresses))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
 
+    const AddressIndex& index = EnsureAddressIndex();
     std::vector<AddressUnspent> unspentOutputs;
 
     for (const auto &address : addresses)
-        if (!GetAddressUnspent(address.first, address.second, unspentOutputs))
+    {
+        bool fOk = index.ForEachAddressUnspent(address.second, address.first,
+            [&unspentOutputs](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+                unspentOutputs.emplace_back(key, value);
+                return true;
+            });
+        if (!fOk)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
 
     std::sort(std::begin(unspentOutputs), std::end(unspentOutputs),
               [](const AddressUnspent &a, const AddressUnspent &b)
@@ -494,6 +557,306 @@ static UniValue getaddressutxos(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue getaddressbalance(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressbalance\n"
+            "\nReturns the balance for an address(es) (requires addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"balance\"  (number) The current balance in duffs\n"
+            "  \"received\"  (number) The total number of duffs received (including change)\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleRpc("getaddressbalance", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
+        );
+
+    std::vector<std::pair<uint160, int>> addresses;
+
+    if (!getAddressesFromParams(request.params, addresses))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    const AddressIndex& index = EnsureAddressIndex();
+    CAmount balance = 0;
+    CAmount received = 0;
+
+    for (const auto &address : addresses)
+    {
+        CAddressBalanceValue value;
+        if (!index.GetAddressBalance(address.second, address.first, value))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        balance += value.balance;
+        received += value.received;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("balance", balance);
+    result.pushKV("received", received);
+    return result;
+}
+
+static UniValue getaddresstxids(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddresstxids\n"
+            "\nReturns the txids for an address(es) (requires addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number) The start block height\n"
+            "  \"end\" (number) The end block height\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  \"transactionid\"  (string) The transaction id\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
+        );
+
+    std::vector<std::pair<uint160, int>> addresses;
+
+    if (!getAddressesFromParams(request.params, addresses))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    int start, end;
+    getHeightRangeFromParams(request.params, start, end);
+
+    const AddressIndex& index = EnsureAddressIndex();
+
+    // Ordered by height and position in block; a transaction touching several
+    // outputs of the queried addresses is listed once
+    std::set<std::tuple<int, unsigned int, uint256>> txids;
+    for (const auto &address : addresses)
+    {
+        bool fOk = index.ForEachAddressDelta(address.second, address.first, start, end,
+            [&txids](const CAddressIndexKey& key, CAmount) {
+                txids.emplace(key.blockHeight, key.txindex, key.txhash);
+                return true;
+            });
+        if (!fOk)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    UniValue result(UniValue::VARR);
+    for (const auto &txid : txids)
+        result.push_back(std::get<2>(txid).GetHex());
+
+    return result;
+}
+
+static UniValue getaddressdeltas(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1 || !request.params[0].isObject())
+        throw std::runtime_error(
+            "getaddressdeltas\n"
+            "\nReturns all changes for an address (requires addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "  \"start\" (number) The start block height\n"
+            "  \"end\" (number) The end block height\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"satoshis\"  (number) The difference of duffs\n"
+            "    \"txid\"  (string) The related txid\n"
+            "    \"index\"  (number) The related input or output index\n"
+            "    \"blockindex\"  (number) The transaction index in the block\n"
+            "    \"height\"  (number) The block height\n"
+            "    \"address\"  (string) The base58check encoded address\n"
+            "  }\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
+        );
+
+    std::vector<std::pair<uint160, int>> addresses;
+
+    if (!getAddressesFromParams(request.params, addresses))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    int start, end;
+    getHeightRangeFromParams(request.params, start, end);
+
+    const AddressIndex& index = EnsureAddressIndex();
+    UniValue result(UniValue::VARR);
+
+    for (const auto &address : addresses)
+    {
+        std::string addressStr;
+        if (!getAddressFromIndex(address.second, address.first, addressStr))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+
+        bool fOk = index.ForEachAddressDelta(address.second, address.first, start, end,
+            [&result, &addressStr](const CAddressIndexKey& key, CAmount amount) {
+                UniValue delta(UniValue::VOBJ);
+                delta.pushKV("satoshis", amount);
+                delta.pushKV("txid", key.txhash.GetHex());
+                delta.pushKV("index", static_cast<int>(key.index));
+                delta.pushKV("blockindex", static_cast<int>(key.txindex));
+                delta.pushKV("height", key.blockHeight);
+                delta.pushKV("address", addressStr);
+                result.push_back(delta);
+                return true;
+            });
+        if (!fOk)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    return result;
+}
+
+static UniValue getaddressmempool(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw std::runtime_error(
+            "getaddressmempool\n"
+            "\nReturns all mempool deltas for an address (requires addressindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"addresses\"\n"
+            "    [\n"
+            "      \"address\"  (string) The base58check encoded address\n"
+            "      ,...\n"
+            "    ]\n"
+            "}\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"address\"  (string) The base58check encoded address\n"
+            "    \"txid\"  (string) The related txid\n"
+            "    \"index\"  (number) The related input or output index\n"
+            "    \"satoshis\"  (number) The difference of duffs\n"
+            "    \"timestamp\"  (number) The time the transaction entered the mempool (seconds)\n"
+            "    \"prevtxid\"  (string) The previous txid (if spending)\n"
+            "    \"prevout\"  (number) The previous transaction output index (if spending)\n"
+            "  }\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddressmempool", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+            + HelpExampleRpc("getaddressmempool", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
+        );
+
+    std::vector<std::pair<uint160, int>> addresses;
+
+    if (!getAddressesFromParams(request.params, addresses))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    if (!g_addressindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled. Start with -addressindex to use this command");
+
+    std::vector<MempoolAddressDelta> indexes;
+    mempool.getAddressIndex(addresses, indexes);
+
+    std::sort(std::begin(indexes), std::end(indexes),
+              [](const MempoolAddressDelta &a, const MempoolAddressDelta &b)
+    {
+        return a.second.time < b.second.time;
+    });
+
+    UniValue result(UniValue::VARR);
+
+    for (const auto &entry : indexes)
+    {
+        std::string address;
+        if (!getAddressFromIndex(entry.first.type, entry.first.addressBytes, address))
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+
+        UniValue delta(UniValue::VOBJ);
+        delta.pushKV("address", address);
+        delta.pushKV("txid", entry.first.txhash.GetHex());
+        delta.pushKV("index", static_cast<int>(entry.first.index));
+        delta.pushKV("satoshis", entry.second.amount);
+        delta.pushKV("timestamp", entry.second.time);
+        if (entry.second.amount < 0) {
+            delta.pushKV("prevtxid", entry.second.prevhash.GetHex());
+            delta.pushKV("prevout", static_cast<int>(entry.second.prevout));
+        }
+        result.push_back(delta);
+    }
+
+    return result;
+}
+
+static UniValue getspentinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1 || !request.params[0].isObject())
+        throw std::runtime_error(
+            "getspentinfo\n"
+            "\nReturns the txid and index where an output is spent (requires spentindex to be enabled).\n"
+            "\nArguments:\n"
+            "{\n"
+            "  \"txid\" (string) The hex string of the txid\n"
+            "  \"index\" (number) The output index\n"
+            "}\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"txid\"  (string) The transaction id\n"
+            "  \"index\"  (number) The spending input index\n"
+            "  \"height\"  (number) The height of the block containing the spending transaction\n"
+            "  \"satoshis\"  (number) The value of the spent output in duffs\n"
+            "  \"address\"  (string, optional) The base58check encoded address of the spent output\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getspentinfo", "'{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}'")
+            + HelpExampleRpc("getspentinfo", "{\"txid\": \"0437cd7f8525ceed2324359c2d0ba26006d92d856a9c20fa0241106ee5a597c9\", \"index\": 0}")
+        );
+
+    const UniValue& txidValue = find_value(request.params[0].get_obj(), "txid");
+    const UniValue& indexValue = find_value(request.params[0].get_obj(), "index");
+
+    if (!txidValue.isStr() || !indexValue.isNum())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid txid or index");
+
+    uint256 txid = ParseHashV(txidValue, "txid");
+    int outputIndex = indexValue.get_int();
+    if (outputIndex < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid index");
+
+    if (!g_spentindex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled. Start with -spentindex to use this command");
+    g_spentindex->BlockUntilSyncedToCurrentChain();
+
+    CSpentIndexValue value;
+    if (!g_spentindex->GetSpentInfo(CSpentIndexKey(txid, outputIndex), value))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("txid", value.txid.GetHex());
+    obj.pushKV("index", static_cast<int>(value.inputIndex));
+    obj.pushKV("height", value.blockHeight);
+    obj.pushKV("satoshis", value.satoshis);
+    std::string address;
+    if (getAddressFromIndex(value.addressType, value.addressHash, address))
+        obj.pushKV("address", address);
+
+    return obj;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -653,6 +1016,11 @@ static const CRPCCommand commands[] =
 
   /* Address index */
     { "addressindex",       "getaddressutxos",        &getaddressutxos,        {"addresses"}},
+    { "addressindex",       "getaddressbalance",      &getaddressbalance,      {"addresses"}},
+    { "addressindex",       "getaddresstxids",        &getaddresstxids,        {"addresses"}},
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       {"addresses"}},
+    { "addressindex",       "getaddressmempool",      &getaddressmempool,      {"addresses"}},
+    { "addressindex",       "getspentinfo",           &getspentinfo,           {"json"}},
 
     /* Not shown in help */
     { "hidden",             "setmocktime",            &setmocktime,            {"timestamp"}},
@@ -7,6 +7,7 @@
 #include "base58.h"
 #include "key.h"
 #include <validation.h>
+#include <validationinterface.h>
 #include <messagesigner.h>
 #include <net.h>
 #include <protocol.h>
@@ -112,6 +113,10 @@ void CSporkManager::LoadSporksFromDB()
         {
             ExecuteSpork(spork.nSporkID);
         }
+        else if(IsMultiValueSpork(spork.nSporkID))
+        {
+            ExecuteMultiValueSpork(spork.nSporkID);
+        }
 
         LogPrintf("%s : loaded spork %s with value %d\n", __func__, sporkManager.GetSporkNameByID(spork.nSporkID), spork.strValue);
     }
@@ -156,9 +161,14 @@ void CSporkManager::ProcessSpork(CNode* pfrom, CValidationState &state, const st
 
         if(AddActiveSpork(spork)) {
             pSporkDB->WriteSpork(spork.nSporkID, spork);
+            GetMainSignals().SporkUpdated(spork);
 
             //does a task if needed
-            ExecuteSpork(spork.nSporkID);
+            if(IsMultiValueSpork(spork.nSporkID)) {
+                ExecuteMultiValueSpork(spork.nSporkID);
+            } else {
+                ExecuteSpork(spork.nSporkID);
+            }
         }
 
         spork.Relay(connman);
@@ -246,6 +256,20 @@ void CSporkManager::ExecuteSpork(int nSporkID)
 
 void CSporkManager::ExecuteMultiValueSpork(int nSporkID)
 {
+    const auto &sporks = mapSporksActive.at(nSporkID);
+    switch (nSporkID) {
+    case SPORK_13_BLOCK_PAYMENTS:
+        std::atomic_store(&blockPaymentTimeline, std::make_shared<const CMultiValueSporkTimeline<BlockPaymentSporkValue>>(sporks));
+        break;
+    case SPORK_15_BLOCK_VALUE:
+        std::atomic_store(&blockSubsidityTimeline, std::make_shared<const CMultiValueSporkTimeline<BlockSubsiditySporkValue>>(sporks));
+        break;
+    case SPORK_16_LOTTERY_TICKET_MIN_VALUE:
+        std::atomic_store(&lotteryTicketMinValueTimeline, std::make_shared<const CMultiValueSporkTimeline<LotteryTicketMinValueSporkValue>>(sporks));
+        break;
+    default:
+        break;
+    }
 }
 
 static int GetActivationHeightHelper(int nSporkID, const std::string strValue)
@@ -284,7 +308,12 @@ bool CSporkManager::UpdateSpork(int nSporkID, std::string strValue, CConnman *co
     if(spork.Sign(sporkPrivKey, sporkPubKey)) {
         spork.Relay(connman);
         mapSporks[spork.GetHash()] = spork;
-        AddActiveSpork(spork);
+        if(AddActiveSpork(spork)) {
+            GetMainSignals().SporkUpdated(spork);
+            if(IsMultiValueSpork(nSporkID)) {
+                ExecuteMultiValueSpork(nSporkID);
+            }
+        }
         return true;
     }
 
@@ -331,6 +360,21 @@ std::vector<CSporkMessage> CSporkManager::GetMultiValueSpork(int nSporkID) const
     return std::vector<CSporkMessage>();
 }
 
+BlockPaymentSporkValue CSporkManager::GetBlockPaymentSpork(int nHeight, int64_t nBlockTime) const
+{
+    return GetActiveFromTimeline(blockPaymentTimeline, nHeight, nBlockTime);
+}
+
+BlockSubsiditySporkValue CSporkManager::GetBlockSubsiditySpork(int nHeight, int64_t nBlockTime) const
+{
+    return GetActiveFromTimeline(blockSubsidityTimeline, nHeight, nBlockTime);
+}
+
+LotteryTicketMinValueSporkValue CSporkManager::GetLotteryTicketMinValueSpork(int nHeight, int64_t nBlockTime) const
+{
+    return GetActiveFromTimeline(lotteryTicketMinValueTimeline, nHeight, nBlockTime);
+}
+
 // grab the value of the spork on the network, or the default
 std::string CSporkManager::GetSporkValue(int nSporkID) const
 {
@@ -14,6 +14,9 @@
 #include <protocol.h>
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <memory>
+
 class CSporkMessage;
 class CSporkManager;
 class CValidationState;
@@ -159,6 +162,42 @@ struct TxFeeSporkValue {
     const int nMinFeePerKb;
 };
 
+//
+// The values of a multi value spork parsed once, ordered by the time they were signed
+//
+template <class T>
+class CMultiValueSporkTimeline
+{
+private:
+    MultiValueSporkList<T> vSporks;
+
+public:
+    explicit CMultiValueSporkTimeline(const std::vector<CSporkMessage> &vMultiValueSpork)
+    {
+        for(auto &&spork : vMultiValueSpork) {
+            vSporks.emplace_back(T::FromString(spork.strValue), spork.nTimeSigned);
+        }
+    }
+
+    // Same choice as CSporkManager::GetActiveMultiValueSpork: the newest spork
+    // signed before nBlockTime that is active at nHeight
+    T GetActive(int nHeight, int64_t nBlockTime) const
+    {
+        auto it = std::lower_bound(std::begin(vSporks), std::end(vSporks), nBlockTime, [](const std::pair<T, int64_t> &entry, int64_t nTime) {
+            return entry.second < nTime;
+        });
+
+        while(it != std::begin(vSporks)) {
+            --it;
+            if(nHeight >= it->first.nActivationBlockHeight) {
+                return it->first;
+            }
+        }
+
+        return T();
+    }
+};
+
 class CSporkManager
 {
 private:
@@ -166,6 +205,12 @@ private:
     // Some sporks require to have history, we will use sorted vector for this approach.
     std::map<int, std::vector<CSporkMessage>> mapSporksActive;
 
+    // Parsed multi value sporks, replaced as a whole when a newer spork is accepted,
+    // so readers need neither cs_main nor a copy of mapSporksActive
+    std::shared_ptr<const CMultiValueSporkTimeline<BlockPaymentSporkValue>> blockPaymentTimeline;
+    std::shared_ptr<const CMultiValueSporkTimeline<BlockSubsiditySporkValue>> blockSubsidityTimeline;
+    std::shared_ptr<const CMultiValueSporkTimeline<LotteryTicketMinValueSporkValue>> lotteryTicketMinValueTimeline;
+
     CPubKey sporkPubKey;
     CKey sporkPrivKey;
 
@@ -175,6 +220,13 @@ private:
     void ExecuteSpork(int nSporkID);
     void ExecuteMultiValueSpork(int nSporkID);
 
+    template <class T>
+    static T GetActiveFromTimeline(const std::shared_ptr<const CMultiValueSporkTimeline<T>> &timeline, int nHeight, int64_t nBlockTime)
+    {
+        auto current = std::atomic_load(&timeline);
+        return current ? current->GetActive(nHeight, nBlockTime) : T();
+    }
+
 public:
 
     CSporkManager();
@@ -187,6 +239,11 @@ public:
     bool IsSporkActive(int nSporkID);
     std::vector<CSporkMessage> GetMultiValueSpork(int nSporkID) const;
 
+    /// Active value of a multi value spork for the block at nHeight, invalid if there is none
+    BlockPaymentSporkValue GetBlockPaymentSpork(int nHeight, int64_t nBlockTime) const;
+    BlockSubsiditySporkValue GetBlockSubsiditySpork(int nHeight, int64_t nBlockTime) const;
+    LotteryTicketMinValueSporkValue GetLotteryTicketMinValueSpork(int nHeight, int64_t nBlockTime) const;
+
     template <class T>
     static void ConvertMultiValueSporkVector(const std::vector<CSporkMessage> &vMultiValueSprok, MultiValueSporkList<T> &vResult)
     {
@@ -0,0 +1,163 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <script/standard.h>
+#include <test/test_divi.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static CAmount SumDeltas(const AddressIndex& index, const uint160& hashBytes, int& count)
+{
+    CAmount total = 0;
+    count = 0;
+    BOOST_CHECK(index.ForEachAddressDelta(ADDRESS_TYPE_PUBKEYHASH, hashBytes, 0, 0,
+        [&total, &count](const CAddressIndexKey& key, CAmount amount) {
+            total += amount;
+            ++count;
+            return true;
+        }));
+    return total;
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex address_index(1 << 20, true);
+    const uint160 hashBytes = coinbaseKey.GetPubKey().GetID();
+
+    int count;
+    CAddressBalanceValue balance;
+
+    // Nothing should be indexed before the index is started.
+    BOOST_CHECK_EQUAL(SumDeltas(address_index, hashBytes, count), 0);
+    BOOST_CHECK_EQUAL(count, 0);
+    BOOST_CHECK(address_index.GetAddressBalance(ADDRESS_TYPE_PUBKEYHASH, hashBytes, balance));
+    BOOST_CHECK(balance.IsNull());
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!address_index.BlockUntilSyncedToCurrentChain());
+
+    address_index.Start();
+
+    // Allow the address index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!address_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Every coinbase pays the pubkey of coinbaseKey and none was spent.
+    CAmount expected = 0;
+    for (const auto& txn : m_coinbase_txns) {
+        expected += txn->vout[0].nValue;
+    }
+    BOOST_CHECK_EQUAL(SumDeltas(address_index, hashBytes, count), expected);
+    BOOST_CHECK_EQUAL(count, (int)m_coinbase_txns.size());
+    BOOST_CHECK(address_index.GetAddressBalance(ADDRESS_TYPE_PUBKEYHASH, hashBytes, balance));
+    BOOST_CHECK_EQUAL(balance.balance, expected);
+    BOOST_CHECK_EQUAL(balance.received, expected);
+
+    int unspent = 0;
+    BOOST_CHECK(address_index.ForEachAddressUnspent(ADDRESS_TYPE_PUBKEYHASH, hashBytes,
+        [&unspent](const CAddressUnspentKey&, const CAddressUnspentValue&) {
+            ++unspent;
+            return true;
+        }));
+    BOOST_CHECK_EQUAL(unspent, (int)m_coinbase_txns.size());
+
+    // Check that new blocks make it into the index.
+    CScript coinbase_script_pub_key = GetScriptForDestination(coinbaseKey.GetPubKey().GetID());
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock& block = CreateAndProcessBlock(no_txns, coinbase_script_pub_key);
+    BOOST_CHECK(address_index.BlockUntilSyncedToCurrentChain());
+
+    expected += block.vtx[0]->vout[0].nValue;
+    BOOST_CHECK(address_index.GetAddressBalance(ADDRESS_TYPE_PUBKEYHASH, hashBytes, balance));
+    BOOST_CHECK_EQUAL(balance.balance, expected);
+
+    address_index.Stop(); // Stop thread before calling destructor
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_reorg_same_block_spend, TestChain100Setup)
+{
+    AddressIndex address_index(1 << 20, true);
+    const uint160 hashBytes = coinbaseKey.GetPubKey().GetID();
+    const CScript coinbase_script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    address_index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!address_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    int count_before;
+    const CAmount deltas_before = SumDeltas(address_index, hashBytes, count_before);
+    CAddressBalanceValue balance_before;
+    BOOST_CHECK(address_index.GetAddressBalance(ADDRESS_TYPE_PUBKEYHASH, hashBytes, balance_before));
+
+    // The second transaction spends the output the first one creates in the same block.
+    std::vector<CMutableTransaction> spends;
+    spends.push_back(SpendToKey(*m_coinbase_txns[0], coinbase_script_pub_key));
+    spends.push_back(SpendToKey(CTransaction(spends[0]), coinbase_script_pub_key));
+    const uint256 hash_first = spends[0].GetHash();
+
+    CKey other_key;
+    other_key.MakeNewKey(true);
+    const CScript other_script_pub_key = GetScriptForDestination(other_key.GetPubKey().GetID());
+
+    const CBlock block = CreateAndProcessBlock(spends, other_script_pub_key);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block.GetHash());
+    BOOST_CHECK(address_index.BlockUntilSyncedToCurrentChain());
+
+    // Disconnect the block and connect another one in its place, which rewinds the index.
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    mempool.clear();
+
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock replacement = CreateAndProcessBlock(no_txns, other_script_pub_key);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == replacement.GetHash());
+    BOOST_CHECK(address_index.BlockUntilSyncedToCurrentChain());
+
+    // Nothing of the disconnected block is left, and the spent coinbase is unspent again.
+    int count;
+    BOOST_CHECK_EQUAL(SumDeltas(address_index, hashBytes, count), deltas_before);
+    BOOST_CHECK_EQUAL(count, count_before);
+
+    CAddressBalanceValue balance;
+    BOOST_CHECK(address_index.GetAddressBalance(ADDRESS_TYPE_PUBKEYHASH, hashBytes, balance));
+    BOOST_CHECK_EQUAL(balance.balance, balance_before.balance);
+    BOOST_CHECK_EQUAL(balance.received, balance_before.received);
+
+    int unspent = 0;
+    bool coinbase_unspent = false;
+    BOOST_CHECK(address_index.ForEachAddressUnspent(ADDRESS_TYPE_PUBKEYHASH, hashBytes,
+        [&](const CAddressUnspentKey& key, const CAddressUnspentValue&) {
+            BOOST_CHECK(key.txhash != hash_first);
+            coinbase_unspent |= key.txhash == m_coinbase_txns[0]->GetHash();
+            ++unspent;
+            return true;
+        }));
+    BOOST_CHECK_EQUAL(unspent, (int)m_coinbase_txns.size());
+    BOOST_CHECK(coinbase_unspent);
+
+    address_index.Stop(); // Stop thread before calling destructor
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,257 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockprevalidator.h>
+
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <miner.h>
+#include <net_processing.h>
+#include <netmessagemaker.h>
+#include <pow.h>
+#include <test/test_divi.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <atomic>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockprevalidator_tests, BasicTestingSetup)
+
+// Every job gets its own copy, CheckBlock marks the block it checked
+static std::shared_ptr<const CBlock> MakeBlock()
+{
+    return std::make_shared<const CBlock>(Params().GenesisBlock());
+}
+
+static void WaitForCommits(Mutex& cs, const std::vector<int>& vCommitted, size_t nExpected)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (true) {
+        {
+            LOCK(cs);
+            if (vCommitted.size() >= nExpected) return;
+        }
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(10);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(commit_in_submission_order)
+{
+    CBlockPreValidator prevalidator;
+    Mutex cs;
+    std::vector<int> vCommitted;
+
+    // nothing can be queued ahead of a block before the threads run, it is committed right away
+    bool fCommitted = false;
+    BOOST_CHECK(prevalidator.Submit(MakeBlock(), [&fCommitted]() { fCommitted = true; }));
+    BOOST_CHECK(fCommitted);
+
+    prevalidator.Start();
+    const int nBlocks = 100;
+    for (int i = 0; i < nBlocks; i++) {
+        BOOST_CHECK(prevalidator.Submit(MakeBlock(), [&cs, &vCommitted, i]() {
+            LOCK(cs);
+            vCommitted.push_back(i);
+        }));
+    }
+    WaitForCommits(cs, vCommitted, nBlocks);
+    prevalidator.Stop();
+
+    LOCK(cs);
+    BOOST_REQUIRE_EQUAL(vCommitted.size(), (size_t)nBlocks);
+    for (int i = 0; i < nBlocks; i++) {
+        BOOST_CHECK_EQUAL(vCommitted[i], i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(full_queue_does_not_wait)
+{
+    CBlockPreValidator prevalidator;
+    Mutex cs;
+    std::vector<int> vCommitted;
+    std::atomic<bool> fCommitting{false};
+    std::atomic<bool> fRelease{false};
+
+    prevalidator.Start();
+
+    // the first commit holds the others back until it is released
+    BOOST_CHECK(prevalidator.Submit(MakeBlock(), [&]() {
+        fCommitting = true;
+        while (!fRelease) MilliSleep(1);
+        LOCK(cs);
+        vCommitted.push_back(0);
+    }));
+    int64_t time_start = GetTimeMillis();
+    while (!fCommitting) {
+        BOOST_REQUIRE(time_start + 10 * 1000 > GetTimeMillis());
+        MilliSleep(1);
+    }
+
+    for (size_t i = 1; i <= MAX_BLOCK_PREVALIDATION_QUEUE; i++) {
+        BOOST_CHECK(prevalidator.Submit(MakeBlock(), [&cs, &vCommitted, i]() {
+            LOCK(cs);
+            vCommitted.push_back(i);
+        }));
+    }
+    BOOST_CHECK_EQUAL(prevalidator.size(), MAX_BLOCK_PREVALIDATION_QUEUE);
+
+    // the block is refused instead of waiting for room or being committed ahead of the queue
+    bool fCommitted = false;
+    BOOST_CHECK(!prevalidator.Submit(MakeBlock(), [&fCommitted]() { fCommitted = true; }));
+    BOOST_CHECK(!fCommitted);
+
+    fRelease = true;
+    WaitForCommits(cs, vCommitted, MAX_BLOCK_PREVALIDATION_QUEUE + 1);
+    BOOST_CHECK(prevalidator.Submit(MakeBlock(), []() {}));
+    prevalidator.Stop();
+}
+
+BOOST_AUTO_TEST_CASE(interrupt_refuses_blocks)
+{
+    CBlockPreValidator prevalidator;
+    prevalidator.Start();
+    prevalidator.Interrupt();
+
+    bool fCommitted = false;
+    BOOST_CHECK(!prevalidator.Submit(MakeBlock(), [&fCommitted]() { fCommitted = true; }));
+    prevalidator.Stop();
+    BOOST_CHECK(!fCommitted);
+    BOOST_CHECK_EQUAL(prevalidator.size(), 0U);
+
+    // stopped, the blocks are committed by the caller again
+    BOOST_CHECK(prevalidator.Submit(MakeBlock(), [&fCommitted]() { fCommitted = true; }));
+    BOOST_CHECK(fCommitted);
+}
+
+BOOST_AUTO_TEST_CASE(contains_blocks_until_committed)
+{
+    CBlockPreValidator prevalidator;
+    std::atomic<bool> fCommitting{false};
+    std::atomic<bool> fRelease{false};
+    prevalidator.Start();
+
+    const std::shared_ptr<const CBlock> pblock = MakeBlock();
+    BOOST_CHECK(!prevalidator.Contains(pblock->GetHash()));
+    BOOST_CHECK(prevalidator.Submit(pblock, [&]() {
+        fCommitting = true;
+        while (!fRelease) MilliSleep(1);
+    }));
+    BOOST_CHECK(prevalidator.Contains(pblock->GetHash()));
+
+    // the block is being committed, a child of it arriving now is still in order
+    int64_t time_start = GetTimeMillis();
+    while (!fCommitting) {
+        BOOST_REQUIRE(time_start + 10 * 1000 > GetTimeMillis());
+        MilliSleep(1);
+    }
+    BOOST_CHECK(prevalidator.Contains(pblock->GetHash()));
+
+    fRelease = true;
+    time_start = GetTimeMillis();
+    while (prevalidator.Contains(pblock->GetHash())) {
+        BOOST_REQUIRE(time_start + 10 * 1000 > GetTimeMillis());
+        MilliSleep(1);
+    }
+    prevalidator.Stop();
+}
+
+// Hand a message to the node as the socket handler does
+static void ReceiveMessage(CNode& node, const CSerializedNetMsg& msg)
+{
+    CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), msg.data.size());
+    const uint256 hash = Hash(msg.data.begin(), msg.data.end());
+    memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+    ssHeader << hdr;
+
+    CNetMessage netmsg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    BOOST_REQUIRE_EQUAL(netmsg.readHeader(ssHeader.data(), ssHeader.size()), (int)ssHeader.size());
+    BOOST_REQUIRE_EQUAL(netmsg.readData((const char*)msg.data.data(), msg.data.size()), (int)msg.data.size());
+    BOOST_REQUIRE(netmsg.complete());
+    netmsg.nTime = GetTimeMicros();
+
+    LOCK(node.cs_vProcessMsg);
+    node.nProcessQueueSize += netmsg.vRecv.size() + CMessageHeader::HEADER_SIZE;
+    node.vProcessMsg.push_back(std::move(netmsg));
+}
+
+static CBlock MineBlock(CBlock block, const uint256& hashPrev, int nHeight, uint32_t nTime)
+{
+    CMutableTransaction txCoinbase(*block.vtx[0]);
+    txCoinbase.vin[0].scriptSig = CScript() << nHeight << OP_0;
+    block.vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+    block.hashPrevBlock = hashPrev;
+    block.nTime = nTime;
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+    return block;
+}
+
+BOOST_FIXTURE_TEST_CASE(child_arrives_before_parent, TestChain100Setup)
+{
+    CAddress addr(CService(CNetAddr(), 8333), NODE_NONE);
+    CNode node(0, ServiceFlags(NODE_NETWORK | NODE_WITNESS), 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", /*fInboundIn=*/ false);
+    node.SetSendVersion(PROTOCOL_VERSION);
+    node.SetRecvVersion(PROTOCOL_VERSION);
+    peerLogic->InitializeNode(&node);
+
+    // the peer serves witness blocks, they are requested from it
+    std::atomic<bool> interrupt(false);
+    const uint64_t nServices = NODE_NETWORK | NODE_WITNESS;
+    ReceiveMessage(node, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::VERSION, PROTOCOL_VERSION, nServices, GetTime(),
+                                                               CAddress(CService(), NODE_NONE), CAddress(CService(), NODE_NONE), (uint64_t)1, std::string(), 0, true));
+    peerLogic->ProcessMessages(&node, interrupt);
+    BOOST_REQUIRE_EQUAL(node.nVersion, PROTOCOL_VERSION);
+    node.fSuccessfullyConnected = true;
+
+    // a parent and a child that are not known yet
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    const CBlock blockTemplate = BlockAssembler(Params()).CreateNewBlock(CScript() << OP_TRUE)->block;
+    const CBlock parent = MineBlock(blockTemplate, pindexTip->GetBlockHash(), pindexTip->nHeight + 1, blockTemplate.nTime);
+    const CBlock child = MineBlock(blockTemplate, parent.GetHash(), pindexTip->nHeight + 2, blockTemplate.nTime + 1);
+
+    // the headers announce them, both are requested
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    ReceiveMessage(node, msgMaker.Make(NetMsgType::HEADERS, std::vector<CBlock>{parent.GetBlockHeader(), child.GetBlockHeader()}));
+    peerLogic->ProcessMessages(&node, interrupt);
+
+    // the blocks arrive while the pre-validator is busy, the child first
+    std::atomic<bool> fRelease{false};
+    blockPreValidator.Start();
+    BOOST_CHECK(blockPreValidator.Submit(MakeBlock(), [&fRelease]() {
+        while (!fRelease) MilliSleep(1);
+    }));
+    ReceiveMessage(node, msgMaker.Make(NetMsgType::BLOCK, child));
+    peerLogic->ProcessMessages(&node, interrupt);
+    ReceiveMessage(node, msgMaker.Make(NetMsgType::BLOCK, parent));
+    peerLogic->ProcessMessages(&node, interrupt);
+    fRelease = true;
+
+    // the child is connected after its parent
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (true) {
+        {
+            LOCK(cs_main);
+            if (chainActive.Tip()->GetBlockHash() == child.GetHash()) break;
+        }
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(10);
+    }
+    blockPreValidator.Stop();
+
+    bool dummy;
+    peerLogic->FinalizeNode(node.GetId(), dummy);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
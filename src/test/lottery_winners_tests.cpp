@@ -0,0 +1,300 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <masternodes/masternode-payments.h>
+#include <streams.h>
+#include <test/test_divi.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(lottery_winners_tests, TestingSetup)
+
+static CDiskBlockIndex MakeDiskBlockIndex(int32_t nVersion)
+{
+    CDiskBlockIndex diskindex;
+    diskindex.nHeight = 1234;
+    diskindex.nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA;
+    diskindex.nTx = 3;
+    diskindex.nFile = 2;
+    diskindex.nDataPos = 4567;
+    diskindex.nMint = 1250 * COIN;
+    diskindex.nMoneySupply = 1000000 * COIN;
+    diskindex.nFlags = CBlockIndex::BLOCK_PROOF_OF_STAKE | CBlockIndex::BLOCK_STAKE_ENTROPY;
+    diskindex.nStakeModifier = 0x0123456789abcdef;
+    diskindex.prevoutStake = COutPoint(InsecureRand256(), 1);
+    diskindex.nStakeTime = 1500000000;
+    diskindex.hashProofOfStake = InsecureRand256();
+    for (int i = 0; i < 11; i++)
+        diskindex.vLotteryWinnersCoinstakes.push_back(InsecureRand256());
+    diskindex.nVersion = nVersion;
+    diskindex.hashPrev = InsecureRand256();
+    diskindex.hashMerkleRoot = InsecureRand256();
+    diskindex.nTime = 1500000060;
+    diskindex.nBits = 0x1e0ffff0;
+    diskindex.nNonce = 42;
+    if (nVersion >= VERSIONBITS_SEGWIT_BLOCK_VERSION)
+        diskindex.hashStakeModifierV3 = InsecureRand256();
+    return diskindex;
+}
+
+/** The layout block tree records had before the lottery payout scripts were recorded */
+static CDataStream SerializeOldFormat(const CDiskBlockIndex& diskindex)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    int nClientVersion = CLIENT_VERSION;
+    ss << VARINT(nClientVersion, VarIntMode::NONNEGATIVE_SIGNED);
+    ss << VARINT(diskindex.nHeight, VarIntMode::NONNEGATIVE_SIGNED);
+    ss << VARINT(diskindex.nStatus) << VARINT(diskindex.nTx);
+    ss << VARINT(diskindex.nFile, VarIntMode::NONNEGATIVE_SIGNED) << VARINT(diskindex.nDataPos);
+    ss << diskindex.nMint << diskindex.nMoneySupply << diskindex.nFlags << diskindex.nStakeModifier;
+    ss << diskindex.prevoutStake << diskindex.nStakeTime << diskindex.hashProofOfStake;
+    ss << diskindex.vLotteryWinnersCoinstakes;
+    ss << diskindex.nVersion << diskindex.hashPrev << diskindex.hashMerkleRoot;
+    ss << diskindex.nTime << diskindex.nBits << diskindex.nNonce;
+    if (diskindex.nVersion == VERSIONBITS_PRESEGWIT_BLOCK_VERSION) {
+        ss << diskindex.nAccumulatorCheckpoint << diskindex.mapZerocoinSupply << diskindex.vMintDenominationsInBlock;
+    }
+    if (diskindex.nVersion >= VERSIONBITS_SEGWIT_BLOCK_VERSION) {
+        ss << diskindex.hashStakeModifierV3;
+    }
+    return ss;
+}
+
+static void CheckSameRecord(const CDiskBlockIndex& a, const CDiskBlockIndex& b)
+{
+    BOOST_CHECK_EQUAL(a.nHeight, b.nHeight);
+    BOOST_CHECK_EQUAL(a.nStatus, b.nStatus);
+    BOOST_CHECK_EQUAL(a.nDataPos, b.nDataPos);
+    BOOST_CHECK_EQUAL(a.nFlags, b.nFlags);
+    BOOST_CHECK_EQUAL(a.nStakeModifier, b.nStakeModifier);
+    BOOST_CHECK(a.prevoutStake == b.prevoutStake);
+    BOOST_CHECK(a.hashProofOfStake == b.hashProofOfStake);
+    BOOST_CHECK(a.vLotteryWinnersCoinstakes == b.vLotteryWinnersCoinstakes);
+    BOOST_CHECK(a.nAccumulatorCheckpoint == b.nAccumulatorCheckpoint);
+    BOOST_CHECK(a.mapZerocoinSupply == b.mapZerocoinSupply);
+    BOOST_CHECK(a.vMintDenominationsInBlock == b.vMintDenominationsInBlock);
+    BOOST_CHECK(a.hashStakeModifierV3 == b.hashStakeModifierV3);
+    BOOST_CHECK(a.GetBlockHash() == b.GetBlockHash());
+}
+
+BOOST_AUTO_TEST_CASE(block_index_record_format)
+{
+    CDiskBlockIndex presegwit = MakeDiskBlockIndex(VERSIONBITS_PRESEGWIT_BLOCK_VERSION);
+    presegwit.nAccumulatorCheckpoint = InsecureRand256();
+    presegwit.mapZerocoinSupply[libzerocoin::CoinDenomination::ZQ_TEN] = 7;
+    presegwit.vMintDenominationsInBlock.push_back(libzerocoin::CoinDenomination::ZQ_TEN);
+
+    for (const CDiskBlockIndex& diskindex : {presegwit, MakeDiskBlockIndex(VERSIONBITS_SEGWIT_BLOCK_VERSION)}) {
+        // records are written exactly as before, with the flags untouched
+        CDataStream ssOld = SerializeOldFormat(diskindex);
+        CDataStream ssNew(SER_DISK, CLIENT_VERSION);
+        ssNew << diskindex;
+        BOOST_CHECK(ssOld.str() == ssNew.str());
+
+        // and the records written before read back unchanged
+        CDiskBlockIndex read;
+        ssOld >> read;
+        BOOST_CHECK(ssOld.empty());
+        CheckSameRecord(read, diskindex);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(lottery_payout_scripts_round_trip)
+{
+    const CDiskBlockIndex diskindex = MakeDiskBlockIndex(VERSIONBITS_SEGWIT_BLOCK_VERSION);
+    const uint256 hash = diskindex.GetBlockHash();
+    std::vector<std::pair<uint256, CScript>> vScripts;
+    for (const uint256& hashCoinstake : diskindex.vLotteryWinnersCoinstakes)
+        vScripts.emplace_back(hashCoinstake, CScript() << OP_DUP << OP_HASH160 << ToByteVector(InsecureRand256()) << OP_EQUALVERIFY << OP_CHECKSIG);
+
+    CBlockTreeDB blocktree(1 << 20, true);
+
+    // a record written without the scripts, as by an older version
+    BOOST_REQUIRE(blocktree.WriteBatchSync({}, 0, {std::make_pair(hash, diskindex)}, {}));
+    CDiskBlockIndex read;
+    BOOST_REQUIRE(blocktree.ReadDiskBlockIndex(hash, read));
+    CheckSameRecord(read, diskindex);
+    CScript scriptPayout;
+    BOOST_CHECK(!blocktree.ReadLotteryPayoutScript(vScripts[0].first, scriptPayout));
+
+    // the scripts are kept next to the record, which stays the same
+    BOOST_REQUIRE(blocktree.WriteBatchSync({}, 0, {std::make_pair(hash, diskindex)}, vScripts));
+    BOOST_REQUIRE(blocktree.ReadDiskBlockIndex(hash, read));
+    CheckSameRecord(read, diskindex);
+    for (const auto& payout : vScripts) {
+        BOOST_REQUIRE(blocktree.ReadLotteryPayoutScript(payout.first, scriptPayout));
+        BOOST_CHECK(scriptPayout == payout.second);
+    }
+}
+
+/** A chain of nHeight block index entries, the last one with a block tree record holding vWinners */
+struct LotteryChain
+{
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vIndex;
+
+    LotteryChain(int nHeight, const std::vector<uint256>& vWinners, const std::vector<std::pair<uint256, CScript>>& vScripts)
+        : vHashes(nHeight), vIndex(nHeight)
+    {
+        for (int i = 0; i < nHeight; i++) {
+            vHashes[i] = ArithToUint256(arith_uint256(i + 1));
+            vIndex[i].phashBlock = &vHashes[i];
+            vIndex[i].pprev = i ? &vIndex[i - 1] : nullptr;
+            vIndex[i].nHeight = i;
+            vIndex[i].nVersion = VERSIONBITS_SEGWIT_BLOCK_VERSION;
+            vIndex[i].BuildSkip();
+        }
+        CDiskBlockIndex diskindex(&vIndex.back());
+        diskindex.vLotteryWinnersCoinstakes = vWinners;
+        bool written = pblocktree->WriteBatchSync({}, 0, {std::make_pair(vHashes.back(), diskindex)}, vScripts);
+        BOOST_REQUIRE(written);
+    }
+
+    ~LotteryChain()
+    {
+        // the winners are cached by block index entry
+        UnloadBlockIndex();
+    }
+
+    const CBlockIndex* Tip() const { return &vIndex.back(); }
+};
+
+static CBlock MakeStakeBlock()
+{
+    CMutableTransaction txCoinBase;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vout.emplace_back(0, CScript());
+
+    // too small a stake to enter the lottery
+    CMutableTransaction txCoinStake;
+    txCoinStake.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    txCoinStake.vout.emplace_back(0, CScript());
+    txCoinStake.vout.emplace_back(COIN, CScript() << OP_TRUE);
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(lottery_winners_from_block_tree)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const int nHeight = consensus.nLotteryBlockStartBlock + 100;
+    std::vector<uint256> vWinners;
+    std::vector<std::pair<uint256, CScript>> vScripts;
+    for (int i = 0; i < 11; i++) {
+        vWinners.push_back(InsecureRand256());
+        vScripts.emplace_back(vWinners.back(), CScript() << ToByteVector(InsecureRand256()) << OP_CHECKSIG);
+    }
+    LotteryChain chain(nHeight, vWinners, vScripts);
+
+    LOCK(cs_main);
+    // the coinstakes are nowhere to be found, the recorded scripts are all that is needed
+    auto winners = GetLotteryWinners(chain.Tip());
+    BOOST_REQUIRE(winners);
+    BOOST_REQUIRE_EQUAL(winners->size(), vScripts.size());
+    for (size_t i = 0; i < vScripts.size(); i++) {
+        BOOST_CHECK((*winners)[i].hashCoinstake == vScripts[i].first);
+        BOOST_CHECK((*winners)[i].scriptPayout == vScripts[i].second);
+    }
+
+    std::vector<CLotteryWinner> vNext;
+    BOOST_CHECK(CalculateLotteryWinners(MakeStakeBlock(), chain.Tip(), nHeight, consensus, vNext));
+    BOOST_CHECK(vNext == *winners);
+}
+
+BOOST_AUTO_TEST_CASE(missing_lottery_winner_is_an_error)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+    const int nHeight = consensus.nLotteryBlockStartBlock + 100;
+    // an old record whose coinstake has no script recorded and cannot be looked up
+    LotteryChain chain(nHeight, {InsecureRand256()}, {});
+
+    LOCK(cs_main);
+    BOOST_CHECK(!GetLotteryWinners(chain.Tip()));
+
+    std::vector<CLotteryWinner> vNext;
+    BOOST_CHECK(!CalculateLotteryWinners(MakeStakeBlock(), chain.Tip(), nHeight, consensus, vNext));
+}
+
+/** Mark the tip of chain dirty, flush, and read its record back */
+static CDiskBlockIndex FlushDirtyTip(LotteryChain& chain)
+{
+    CBlockIndex* pindex = &chain.vIndex.back();
+    {
+        LOCK(cs_main);
+        pindex->nStatus |= BLOCK_FAILED_VALID;
+        ResetBlockFailureFlags(pindex);
+    }
+    FlushStateToDisk();
+
+    CDiskBlockIndex read;
+    BOOST_REQUIRE(pblocktree->ReadDiskBlockIndex(pindex->GetBlockHash(), read));
+    BOOST_CHECK_EQUAL(read.nStatus, pindex->nStatus);
+    return read;
+}
+
+BOOST_AUTO_TEST_CASE(dirty_entry_keeps_lottery_winners)
+{
+    const int nHeight = Params().GetConsensus().nLotteryBlockStartBlock + 100;
+    std::vector<uint256> vWinners;
+    std::vector<std::pair<uint256, CScript>> vScripts;
+    for (int i = 0; i < 11; i++) {
+        vWinners.push_back(InsecureRand256());
+        vScripts.emplace_back(vWinners.back(), CScript() << ToByteVector(InsecureRand256()) << OP_CHECKSIG);
+    }
+
+    // winners not cached, kept from the record read when the entry was marked dirty
+    {
+        LotteryChain chain(nHeight, vWinners, vScripts);
+        BOOST_CHECK(FlushDirtyTip(chain).vLotteryWinnersCoinstakes == vWinners);
+    }
+
+    // winners cached, written from the cache
+    {
+        LotteryChain chain(nHeight, vWinners, vScripts);
+        {
+            LOCK(cs_main);
+            BOOST_REQUIRE(GetLotteryWinners(chain.Tip()));
+        }
+        BOOST_CHECK(FlushDirtyTip(chain).vLotteryWinnersCoinstakes == vWinners);
+        UnloadBlockIndex();
+
+        // and read back once the cache is dropped
+        LOCK(cs_main);
+        auto winners = GetLotteryWinners(chain.Tip());
+        BOOST_REQUIRE(winners);
+        BOOST_REQUIRE_EQUAL(winners->size(), vScripts.size());
+        for (size_t i = 0; i < vScripts.size(); i++) {
+            BOOST_CHECK((*winners)[i].hashCoinstake == vScripts[i].first);
+            BOOST_CHECK((*winners)[i].scriptPayout == vScripts[i].second);
+        }
+    }
+
+    // a pre-segwit entry keeps its zerocoin fields, which are not kept in memory
+    LotteryChain chain(nHeight, vWinners, vScripts);
+    CBlockIndex& tip = chain.vIndex.back();
+    tip.nVersion = VERSIONBITS_PRESEGWIT_BLOCK_VERSION;
+    CDiskBlockIndex diskindex(&tip);
+    diskindex.vLotteryWinnersCoinstakes = vWinners;
+    diskindex.nAccumulatorCheckpoint = InsecureRand256();
+    diskindex.mapZerocoinSupply[libzerocoin::CoinDenomination::ZQ_TEN] = 7;
+    diskindex.vMintDenominationsInBlock.push_back(libzerocoin::CoinDenomination::ZQ_TEN);
+    BOOST_REQUIRE(pblocktree->WriteBatchSync({}, 0, {std::make_pair(tip.GetBlockHash(), diskindex)}, {}));
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(GetLotteryWinners(chain.Tip()));
+    }
+    const CDiskBlockIndex read = FlushDirtyTip(chain);
+    diskindex.nStatus = read.nStatus;
+    CheckSameRecord(read, diskindex);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-db.h>
+#include <masternodes/masternodeman.h>
+
+#include <random.h>
+#include <test/test_divi.h>
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_db_tests, BasicTestingSetup)
+
+static CMasternodePaymentWinner MakeVote(int nBlockHeight, const CScript& payee)
+{
+    CMasternodePaymentWinner winner(CTxIn(COutPoint(InsecureRand256(), 0)));
+    winner.nBlockHeight = nBlockHeight;
+    winner.AddPayee(payee);
+    return winner;
+}
+
+BOOST_AUTO_TEST_CASE(masternode_entries)
+{
+    CMasternodeDB db(1 << 20, true);
+
+    int nVersion = 0;
+    BOOST_CHECK(!db.ReadVersion(nVersion));
+    BOOST_CHECK(db.WriteVersion(MASTERNODE_DB_VERSION));
+    BOOST_CHECK(db.ReadVersion(nVersion));
+    BOOST_CHECK_EQUAL(nVersion, MASTERNODE_DB_VERSION);
+
+    std::vector<CMasternode> vMasternodes(3);
+    for (size_t i = 0; i < vMasternodes.size(); i++) {
+        vMasternodes[i].vin = CTxIn(COutPoint(InsecureRand256(), i));
+        vMasternodes[i].nTier = CMasternode::MASTERNODE_TIER_GOLD;
+        vMasternodes[i].sigTime = 1000 + i;
+        BOOST_CHECK(db.WriteMasternode(vMasternodes[i]));
+    }
+
+    // a later write of an entry replaces it
+    vMasternodes[1].sigTime = 2000;
+    BOOST_CHECK(db.WriteMasternode(vMasternodes[1]));
+    BOOST_CHECK(db.EraseMasternode(vMasternodes[0].vin.prevout));
+
+    CMasternodeMan man;
+    BOOST_CHECK(man.Load(db));
+    BOOST_CHECK_EQUAL(man.size(), 2);
+    BOOST_CHECK(man.Find(vMasternodes[0].vin) == nullptr);
+    for (size_t i = 1; i < vMasternodes.size(); i++) {
+        const CMasternode* pmn = man.Find(vMasternodes[i].vin);
+        BOOST_REQUIRE(pmn != nullptr);
+        BOOST_CHECK_EQUAL(pmn->sigTime, vMasternodes[i].sigTime);
+        BOOST_CHECK_EQUAL(pmn->nTier, CMasternode::MASTERNODE_TIER_GOLD);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(payment_votes)
+{
+    CMasternodeDB db(1 << 20, true);
+
+    const CScript payee = CScript() << OP_TRUE;
+    const CScript payeeOther = CScript() << OP_FALSE;
+    std::vector<CMasternodePaymentWinner> vVotes{MakeVote(100, payee), MakeVote(100, payee), MakeVote(100, payeeOther), MakeVote(101, payeeOther)};
+    BOOST_CHECK(db.WritePaymentVotes({vVotes[0], vVotes[1]}));
+    BOOST_CHECK(db.WritePaymentVote(vVotes[2]));
+    BOOST_CHECK(db.WritePaymentVote(vVotes[3]));
+    BOOST_CHECK(db.ErasePaymentVotes({vVotes[3].GetHash()}));
+
+    // the payees of a block are counted from the votes again
+    CMasternodePayments payments;
+    BOOST_CHECK(payments.Load(db));
+    BOOST_CHECK_EQUAL(payments.mapMasternodePayeeVotes.size(), 3U);
+    BOOST_CHECK(payments.mapMasternodeBlocks.count(100));
+    BOOST_CHECK(!payments.mapMasternodeBlocks.count(101));
+    BOOST_CHECK(payments.mapMasternodeBlocks[100].HasPayeeWithVotes(payee, 2));
+    BOOST_CHECK(payments.mapMasternodeBlocks[100].HasPayeeWithVotes(payeeOther, 1));
+    BOOST_CHECK(!payments.mapMasternodeBlocks[100].HasPayeeWithVotes(payeeOther, 2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,82 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternodeman.h>
+
+#include <random.h>
+#include <test/test_divi.h>
+#include <validationinterface.h>
+
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_notification_tests, TestingSetup)
+
+struct TestMasternodeListener : public CValidationInterface
+{
+    std::vector<std::pair<COutPoint, MasternodeChange>> vChanges;
+
+protected:
+    void MasternodeChanged(const CMasternode& mn, MasternodeChange change) override
+    {
+        vChanges.emplace_back(mn.vin.prevout, change);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(list_changes_notified)
+{
+    TestMasternodeListener listener;
+    RegisterValidationInterface(&listener);
+
+    CMasternode mn;
+    mn.vin = CTxIn(COutPoint(InsecureRand256(), 0));
+    mn.activeState = CMasternode::MASTERNODE_ENABLED;
+
+    CMasternodeMan man;
+    BOOST_CHECK(man.Add(mn));
+    // an entry already in the list is not added again
+    BOOST_CHECK(!man.Add(mn));
+    man.Remove(mn.vin);
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&listener);
+
+    BOOST_REQUIRE_EQUAL(listener.vChanges.size(), 2U);
+    BOOST_CHECK(listener.vChanges[0].first == mn.vin.prevout);
+    BOOST_CHECK(listener.vChanges[0].second == MasternodeChange::ADDED);
+    BOOST_CHECK(listener.vChanges[1].first == mn.vin.prevout);
+    BOOST_CHECK(listener.vChanges[1].second == MasternodeChange::REMOVED);
+}
+
+BOOST_AUTO_TEST_CASE(state_changes_notified)
+{
+    TestMasternodeListener listener;
+    RegisterValidationInterface(&listener);
+
+    // never pinged, so the first check finds it due for removal
+    CMasternode mn;
+    mn.vin = CTxIn(COutPoint(InsecureRand256(), 0));
+    mn.activeState = CMasternode::MASTERNODE_ENABLED;
+    mn.unitTest = true;
+
+    CMasternodeMan man;
+    BOOST_CHECK(man.Add(mn));
+    man.Check();
+
+    // checking the entry again through the list finds the same state
+    CMasternode* pmn = man.Find(mn.vin);
+    BOOST_REQUIRE(pmn);
+    BOOST_CHECK_EQUAL(pmn->activeState, CMasternode::MASTERNODE_REMOVE);
+    pmn->Check(true);
+    SyncWithValidationInterfaceQueue();
+    UnregisterValidationInterface(&listener);
+
+    BOOST_REQUIRE_EQUAL(listener.vChanges.size(), 2U);
+    BOOST_CHECK(listener.vChanges[0].second == MasternodeChange::ADDED);
+    BOOST_CHECK(listener.vChanges[1].first == mn.vin.prevout);
+    BOOST_CHECK(listener.vChanges[1].second == MasternodeChange::STATE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
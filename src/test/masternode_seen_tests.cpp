@@ -0,0 +1,124 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-seen.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <test/test_divi.h>
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_seen_tests, BasicTestingSetup)
+
+static CMasternodePing MakePing(const COutPoint& outpoint, int64_t sigTime)
+{
+    CMasternodePing mnp;
+    mnp.vin = CTxIn(outpoint);
+    mnp.sigTime = sigTime;
+    return mnp;
+}
+
+BOOST_AUTO_TEST_CASE(seen_pings_expire)
+{
+    const COutPoint outpoint(InsecureRand256(), 0);
+    const COutPoint outpointOther(InsecureRand256(), 1);
+
+    CSeenMasternodeMessages<CMasternodePing> seen;
+    std::vector<CMasternodePing> vPings{MakePing(outpoint, 100), MakePing(outpoint, 200), MakePing(outpointOther, 150), MakePing(outpointOther, 300)};
+    for (const CMasternodePing& mnp : vPings) {
+        BOOST_CHECK(seen.insert(std::make_pair(mnp.GetHash(), mnp)));
+    }
+    BOOST_CHECK(!seen.insert(std::make_pair(vPings[0].GetHash(), vPings[0])));
+    BOOST_CHECK_EQUAL(seen.size(), 4U);
+
+    // pings signed before 200 expire
+    std::vector<uint256> vExpired = seen.EraseExpired(200);
+    BOOST_CHECK_EQUAL(vExpired.size(), 2U);
+    BOOST_CHECK(!seen.count(vPings[0].GetHash()));
+    BOOST_CHECK(!seen.count(vPings[2].GetHash()));
+    BOOST_CHECK(seen.count(vPings[1].GetHash()));
+
+    std::vector<uint256> vErased = seen.EraseOutpoint(outpointOther);
+    BOOST_CHECK_EQUAL(vErased.size(), 1U);
+    BOOST_CHECK(vErased[0] == vPings[3].GetHash());
+    BOOST_CHECK_EQUAL(seen.size(), 1U);
+
+    CMasternodePing mnp;
+    BOOST_CHECK(seen.Get(vPings[1].GetHash(), mnp));
+    BOOST_CHECK_EQUAL(mnp.sigTime, 200);
+}
+
+BOOST_AUTO_TEST_CASE(seen_broadcast_last_ping)
+{
+    const COutPoint outpoint(InsecureRand256(), 0);
+
+    CMasternodeBroadcast mnb;
+    mnb.vin = CTxIn(outpoint);
+    mnb.lastPing = MakePing(outpoint, 100);
+    const uint256 hash = mnb.GetHash();
+
+    CSeenMasternodeMessages<CMasternodeBroadcast> seen;
+    BOOST_CHECK(seen.insert(std::make_pair(hash, mnb)));
+
+    // a new ping keeps the broadcast from expiring
+    seen.UpdateLastPing(hash, MakePing(outpoint, 500));
+    BOOST_CHECK(seen.EraseExpired(200).empty());
+    BOOST_CHECK(seen.Get(hash, mnb));
+    BOOST_CHECK_EQUAL(mnb.lastPing.sigTime, 500);
+    BOOST_CHECK_EQUAL(seen.EraseExpired(600).size(), 1U);
+    BOOST_CHECK_EQUAL(seen.size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(asked_times)
+{
+    CAskedTimes<COutPoint> asked;
+    const COutPoint outpoint(InsecureRand256(), 0);
+    const COutPoint outpointOther(InsecureRand256(), 1);
+
+    asked.Set(outpoint, 100);
+    asked.Set(outpointOther, 150);
+    // asking again moves the time
+    asked.Set(outpoint, 300);
+    asked.EraseExpired(200);
+
+    int64_t nTime;
+    BOOST_CHECK(!asked.Get(outpointOther, nTime));
+    BOOST_CHECK(asked.Get(outpoint, nTime));
+    BOOST_CHECK_EQUAL(nTime, 300);
+
+    asked.erase(outpoint);
+    BOOST_CHECK_EQUAL(asked.size(), 0U);
+    asked.EraseExpired(1000);
+}
+
+BOOST_AUTO_TEST_CASE(serialized_as_maps)
+{
+    // the old cache files hold maps by hash and by key
+    std::map<uint256, CMasternodePing> mapPings;
+    for (int i = 0; i < 3; i++) {
+        CMasternodePing mnp = MakePing(COutPoint(InsecureRand256(), i), 100 + i);
+        mapPings.emplace(mnp.GetHash(), mnp);
+    }
+    std::map<COutPoint, int64_t> mapTimes{{COutPoint(InsecureRand256(), 0), 100}, {COutPoint(InsecureRand256(), 1), 200}};
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << mapPings << mapTimes;
+    const std::string strSerialized = ss.str();
+
+    CSeenMasternodeMessages<CMasternodePing> seen;
+    CAskedTimes<COutPoint> asked;
+    ss >> seen >> asked;
+    BOOST_CHECK_EQUAL(seen.size(), 3U);
+    BOOST_CHECK_EQUAL(asked.size(), 2U);
+
+    // written back in hash and key order, as the maps wrote them
+    CDataStream ssOut(SER_DISK, CLIENT_VERSION);
+    ssOut << seen << asked;
+    BOOST_CHECK(ssOut.str() == strSerialized);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <masternodes/masternode-verifier.h>
+
+#include <key.h>
+#include <messagesigner.h>
+#include <test/test_divi.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(masternode_verifier_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(verify_masternode_message)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CKey keyOther;
+    keyOther.MakeNewKey(true);
+
+    const std::string strMessage = "masternode ping";
+    std::vector<unsigned char> vchSig;
+    BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vchSig, key, CPubKey::InputScriptType::SPENDP2PKH));
+
+    std::string strError;
+    // the second check of each message is answered by the signature cache
+    for (int i = 0; i < 2; ++i) {
+        BOOST_CHECK(VerifyMasternodeMessage(key.GetPubKey().GetID(), vchSig, strMessage, strError));
+        BOOST_CHECK(!VerifyMasternodeMessage(keyOther.GetPubKey().GetID(), vchSig, strMessage, strError));
+        BOOST_CHECK(!VerifyMasternodeMessage(key.GetPubKey().GetID(), vchSig, strMessage + "!", strError));
+    }
+
+    std::vector<unsigned char> vchBadSig(vchSig);
+    vchBadSig[10] ^= 0x01;
+    BOOST_CHECK(!VerifyMasternodeMessage(key.GetPubKey().GetID(), vchBadSig, strMessage, strError));
+    BOOST_CHECK(VerifyMasternodeMessage(key.GetPubKey().GetID(), vchSig, strMessage, strError));
+}
+
+BOOST_AUTO_TEST_CASE(batch_with_invalid_signature)
+{
+    // enough signatures to be spread over the threads
+    const size_t nMessages = 200;
+    std::vector<CKey> vKeys(nMessages);
+    std::vector<std::vector<unsigned char>> vSigs(nMessages);
+    std::vector<CMasternodeSignatureCheck> vChecks;
+    for (size_t i = 0; i < nMessages; i++) {
+        vKeys[i].MakeNewKey(true);
+        const std::string strMessage = "masternode ping " + std::to_string(i);
+        BOOST_CHECK(CMessageSigner::SignMessage(strMessage, vSigs[i], vKeys[i], CPubKey::InputScriptType::SPENDP2PKH));
+        vChecks.push_back(CMasternodeSignatureCheck{vKeys[i].GetPubKey().GetID(), &vSigs[i], strMessage});
+    }
+    BOOST_CHECK(VerifyMasternodeSignatures(vChecks));
+
+    // one message signed by another key fails the whole batch
+    const size_t nInvalid = 137;
+    std::vector<CMasternodeSignatureCheck> vBadChecks(vChecks);
+    vBadChecks[nInvalid].keyID = vKeys[nInvalid - 1].GetPubKey().GetID();
+    BOOST_CHECK(!VerifyMasternodeSignatures(vBadChecks));
+
+    // and only that message is rejected when the batch is applied
+    std::string strError;
+    for (size_t i = 0; i < nMessages; i++) {
+        BOOST_CHECK_EQUAL(VerifyMasternodeMessage(vBadChecks[i].keyID, *vBadChecks[i].pvchSig, vBadChecks[i].strMessage, strError), i != nInvalid);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(verifier_not_running)
+{
+    // without the verification thread the message handler processes the messages itself
+    CMasternodeMessageVerifier verifier;
+    BOOST_CHECK(!verifier.AddPing(nullptr, CMasternodePing()));
+    BOOST_CHECK(!verifier.IsPending(CMasternodePing().GetHash()));
+    BOOST_CHECK_EQUAL(verifier.size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
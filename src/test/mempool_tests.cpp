@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <coins.h>
 #include <policy/policy.h>
 #include <txmempool.h>
 #include <util/system.h>
@@ -749,4 +750,30 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 6ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAddressIndexUsageTest)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    for (int i = 0; i < 10; i++)
+        tx.vout.emplace_back(10 * COIN, CScript() << OP_DUP << OP_HASH160 << g_insecure_rand_ctx.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG);
+
+    CTxMemPool pool;
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+    LOCK(pool.cs);
+    pool.addUnchecked(entry.FromTx(tx));
+    const size_t nUsageTx = pool.DynamicMemoryUsage();
+
+    // the address deltas count towards the size of the pool
+    pool.addAddressIndex(entry.FromTx(tx), view);
+    BOOST_CHECK(pool.DynamicMemoryUsage() > nUsageTx + 10 * sizeof(CMempoolAddressDeltaKey));
+
+    // and are all released with the transaction
+    pool.removeRecursive(CTransaction(tx));
+    pool.addUnchecked(entry.FromTx(tx));
+    BOOST_CHECK_EQUAL(pool.DynamicMemoryUsage(), nUsageTx);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
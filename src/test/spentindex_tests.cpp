@@ -0,0 +1,154 @@
+// Copyright (c) 2017-2018 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/addressindex.h>
+#include <index/spentindex.h>
+#include <script/standard.h>
+#include <test/test_divi.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(spentindex_tests)
+
+BOOST_FIXTURE_TEST_CASE(spentindex_sync_and_rewind, TestChain100Setup)
+{
+    SpentIndex spent_index(1 << 20, true);
+    const CScript coinbase_script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Spend a mature coinbase before the index is started, so it is picked up by the initial sync.
+    std::vector<CMutableTransaction> spends;
+    spends.push_back(SpendToKey(*m_coinbase_txns[0], coinbase_script_pub_key));
+    const CBlock block_first = CreateAndProcessBlock(spends, coinbase_script_pub_key);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block_first.GetHash());
+
+    CSpentIndexValue value;
+    const CSpentIndexKey key_first(m_coinbase_txns[0]->GetHash(), 0);
+
+    // Nothing should be indexed before the index is started.
+    BOOST_CHECK(!spent_index.GetSpentInfo(key_first, value));
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!spent_index.BlockUntilSyncedToCurrentChain());
+
+    spent_index.Start();
+
+    // Allow the spent index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!spent_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    BOOST_REQUIRE(spent_index.GetSpentInfo(key_first, value));
+    BOOST_CHECK(value.txid == spends[0].GetHash());
+    BOOST_CHECK_EQUAL(value.inputIndex, 0U);
+    BOOST_CHECK_EQUAL(value.blockHeight, chainActive.Height());
+    BOOST_CHECK_EQUAL(value.satoshis, m_coinbase_txns[0]->vout[0].nValue);
+    BOOST_CHECK_EQUAL(value.addressType, ADDRESS_TYPE_PUBKEYHASH);
+    BOOST_CHECK(value.addressHash == coinbaseKey.GetPubKey().GetID());
+
+    // Outputs are not indexed as spent until they are.
+    BOOST_CHECK(!spent_index.GetSpentInfo(CSpentIndexKey(m_coinbase_txns[1]->GetHash(), 0), value));
+
+    // Check that spends in new blocks make it into the index.
+    std::vector<CMutableTransaction> spends_second;
+    spends_second.push_back(SpendToKey(*m_coinbase_txns[1], coinbase_script_pub_key));
+    spends_second.push_back(SpendToKey(CTransaction(spends_second[0]), coinbase_script_pub_key));
+    const CBlock block_second = CreateAndProcessBlock(spends_second, coinbase_script_pub_key);
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == block_second.GetHash());
+    BOOST_CHECK(spent_index.BlockUntilSyncedToCurrentChain());
+
+    const CSpentIndexKey key_second(m_coinbase_txns[1]->GetHash(), 0);
+    const CSpentIndexKey key_same_block(spends_second[0].GetHash(), 0);
+    BOOST_CHECK(spent_index.GetSpentInfo(key_second, value));
+    BOOST_REQUIRE(spent_index.GetSpentInfo(key_same_block, value));
+    BOOST_CHECK(value.txid == spends_second[1].GetHash());
+
+    // Disconnect the last block and connect another one in its place, which rewinds the index.
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    mempool.clear();
+
+    std::vector<CMutableTransaction> no_txns;
+    const CBlock replacement = CreateAndProcessBlock(no_txns, GetScriptForDestination(coinbaseKey.GetPubKey().GetID()));
+    BOOST_REQUIRE(chainActive.Tip()->GetBlockHash() == replacement.GetHash());
+    BOOST_CHECK(spent_index.BlockUntilSyncedToCurrentChain());
+
+    // The spends of the disconnected block are gone, the ones below it are kept.
+    BOOST_CHECK(!spent_index.GetSpentInfo(key_second, value));
+    BOOST_CHECK(!spent_index.GetSpentInfo(key_same_block, value));
+    BOOST_CHECK(spent_index.GetSpentInfo(key_first, value));
+
+    spent_index.Stop(); // Stop thread before calling destructor
+}
+
+static void WaitForSync(SpentIndex& spent_index)
+{
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!spent_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(spentindex_rewind_past_locator, TestChain100Setup)
+{
+    const CScript coinbase_script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CSpentIndexKey key(m_coinbase_txns[0]->GetHash(), 0);
+    CSpentIndexValue value;
+
+    {
+        SpentIndex spent_index(1 << 20, false, true);
+        spent_index.Start();
+        WaitForSync(spent_index);
+
+        // Commit the best block locator at the current tip.
+        FlushStateToDisk();
+        SyncWithValidationInterfaceQueue();
+
+        // The spend is written, the locator stays behind it.
+        std::vector<CMutableTransaction> spends;
+        spends.push_back(SpendToKey(*m_coinbase_txns[0], coinbase_script_pub_key));
+        CreateAndProcessBlock(spends, coinbase_script_pub_key);
+        BOOST_CHECK(spent_index.BlockUntilSyncedToCurrentChain());
+        BOOST_REQUIRE(spent_index.GetSpentInfo(key, value));
+
+        spent_index.Stop();
+    }
+
+    // The block is replaced while the index is not running.
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        BOOST_CHECK(InvalidateBlock(state, Params(), chainActive.Tip()));
+    }
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    mempool.clear();
+    std::vector<CMutableTransaction> no_txns;
+    CreateAndProcessBlock(no_txns, GetScriptForDestination(coinbaseKey.GetPubKey().GetID()));
+
+    // The index restarts from the locator, below the block whose spend it wrote,
+    // and has to erase that spend all the same.
+    SpentIndex spent_index(1 << 20);
+    spent_index.Start();
+    WaitForSync(spent_index);
+    BOOST_CHECK(!spent_index.GetSpentInfo(key, value));
+
+    spent_index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/kernel.h>
+#include <kernelscanner.h>
+#include <test/test_divi.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stake_kernel_tests, BasicTestingSetup)
+
+static const uint32_t BLOCK_FROM_TIME = 1500000000;
+static const unsigned int STAKE_HASH_DRIFT = 45;
+
+// About half of the inputs of StakeInputs() meet this target
+static unsigned int HalfTargetBits(bool fModifierV3)
+{
+    arith_uint256 bnTarget = arith_uint256(1) << (fModifierV3 ? 219 : 238);
+    return bnTarget.GetCompact();
+}
+
+static std::vector<CStakeKernelInput> StakeInputs()
+{
+    std::vector<CStakeKernelInput> vInputs(200);
+    for (CStakeKernelInput& input : vInputs) {
+        input.prevout = COutPoint(InsecureRand256(), InsecureRandRange(4));
+        input.nValue = (1 + InsecureRandRange(1000)) * COIN;
+        input.nBlockFromTime = BLOCK_FROM_TIME;
+        input.nStakeModifier = InsecureRandBits(64);
+    }
+    return vInputs;
+}
+
+// The miner searches with the scanner, which has to find the kernels the
+// context check accepts, at the same time and with the same proof hash
+static void CheckScannerAgrees(const CStakeKernelContext& context, const CStakeKernelInput& input, unsigned int nTimeTx,
+                               bool fHit, unsigned int nTimeKernel, const uint256& hashProofOfStake)
+{
+    CStakeKernelResult result;
+    BOOST_CHECK_EQUAL(ScanStakeKernels(context, {input}, nTimeTx, STAKE_HASH_DRIFT, result), fHit);
+    if (fHit) {
+        BOOST_CHECK_EQUAL(result.nTimeTx, nTimeKernel);
+        BOOST_CHECK(result.hashProofOfStake == hashProofOfStake);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(kernel_checks_agree_v3)
+{
+    const Consensus::Params& consensus = Params().GetConsensus();
+
+    CBlockIndex indexFrom;
+    indexFrom.nTime = BLOCK_FROM_TIME;
+    CBlockIndex indexPrev;
+    indexPrev.nHeight = consensus.nSegwitHeight + 10;
+    indexPrev.hashStakeModifierV3 = InsecureRand256();
+
+    CStakeKernelContext context;
+    context.pindexPrev = &indexPrev;
+    context.nHeight = indexPrev.nHeight + 1;
+    context.nBits = HalfTargetBits(true);
+    context.fModifierV3 = true;
+    context.hashStakeModifierV3 = indexPrev.hashStakeModifierV3;
+
+    const unsigned int nTimeTx = BLOCK_FROM_TIME + nStakeMaxAge;
+    int nHits = 0;
+    for (const CStakeKernelInput& input : StakeInputs()) {
+        unsigned int nTimeConsensus = nTimeTx;
+        uint256 hashConsensus;
+        const bool fConsensus = CheckStakeKernelHash(&indexPrev, context.nBits, &indexFrom, input.nValue, input.prevout, context.nHeight,
+                                                     nTimeConsensus, STAKE_HASH_DRIFT, true, hashConsensus);
+
+        unsigned int nTimeMiner = nTimeTx;
+        uint256 hashMiner;
+        const bool fMiner = CheckStakeKernelHash(context, input.nBlockFromTime, input.nStakeModifier, input.nValue, input.prevout,
+                                                 nTimeMiner, STAKE_HASH_DRIFT, hashMiner);
+
+        BOOST_CHECK_EQUAL(fConsensus, fMiner);
+        BOOST_CHECK_EQUAL(nTimeConsensus, nTimeMiner);
+        BOOST_CHECK(hashConsensus == hashMiner);
+        CheckScannerAgrees(context, input, nTimeTx, fMiner, nTimeMiner, hashMiner);
+        nHits += fMiner;
+    }
+    // the target is neither always nor never met
+    BOOST_CHECK(nHits > 0 && nHits < 200);
+}
+
+BOOST_AUTO_TEST_CASE(kernel_checks_agree_v2)
+{
+    CStakeKernelContext context;
+    context.nBits = HalfTargetBits(false);
+    context.fModifierV3 = false;
+
+    const unsigned int nTimeTx = BLOCK_FROM_TIME + nStakeMinAge + STAKE_HASH_DRIFT;
+    int nHits = 0;
+    for (const CStakeKernelInput& input : StakeInputs()) {
+        // a check of the kernel found hashes only its own time
+        unsigned int nTimeMiner = nTimeTx;
+        uint256 hashMiner;
+        const bool fMiner = CheckStakeKernelHash(context, input.nBlockFromTime, input.nStakeModifier, input.nValue, input.prevout,
+                                                 nTimeMiner, STAKE_HASH_DRIFT, hashMiner);
+        if (fMiner) {
+            unsigned int nTimeCheck = nTimeMiner;
+            uint256 hashCheck;
+            BOOST_CHECK(CheckStakeKernelHash(context, input.nBlockFromTime, input.nStakeModifier, input.nValue, input.prevout,
+                                             nTimeCheck, 1, hashCheck));
+            BOOST_CHECK_EQUAL(nTimeCheck, nTimeMiner);
+            BOOST_CHECK(hashCheck == hashMiner);
+        }
+        CheckScannerAgrees(context, input, nTimeTx, fMiner, nTimeMiner, hashMiner);
+        nHits += fMiner;
+    }
+    BOOST_CHECK(nHits > 0 && nHits < 200);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -15,6 +15,7 @@
 #include <pow.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
+#include <script/interpreter.h>
 #include <script/sigcache.h>
 #include <streams.h>
 #include <ui_interface.h>
@@ -171,6 +172,25 @@ TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransaction>&
     return result;
 }
 
+CMutableTransaction TestChain100Setup::SpendToKey(const CTransaction& prev_tx, const CScript& scriptPubKey)
+{
+    CMutableTransaction tx;
+    tx.nVersion = 1;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(prev_tx.GetHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = prev_tx.vout[0].nValue - CENT;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(prev_tx.vout[0].scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    bool signed_spend = coinbaseKey.Sign(hash, vchSig);
+    assert(signed_spend);
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
 TestChain100Setup::~TestChain100Setup()
 {
 }
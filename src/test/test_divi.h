@@ -100,6 +100,10 @@ struct TestChain100Setup : public TestingSetup {
     CBlock CreateAndProcessBlock(const std::vector<CMutableTransaction>& txns,
                                  const CScript& scriptPubKey);
 
+    // Spend the first output of prev_tx, paying to coinbaseKey, to
+    // scriptPubKey less a fee of CENT.
+    CMutableTransaction SpendToKey(const CTransaction& prev_tx, const CScript& scriptPubKey);
+
     ~TestChain100Setup();
 
     std::vector<CTransactionRef> m_coinbase_txns; // For convenience, coinbase transactions
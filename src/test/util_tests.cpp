@@ -9,8 +9,10 @@
 #include <sync.h>
 #include <util/strencodings.h>
 #include <util/moneystr.h>
+#include <util/parallel.h>
 #include <test/test_divi.h>
 
+#include <atomic>
 #include <stdint.h>
 #include <vector>
 #ifndef WIN32
@@ -1256,4 +1258,26 @@ BOOST_AUTO_TEST_CASE(test_Capitalize)
     BOOST_CHECK_EQUAL(Capitalize("\x00\xfe\xff"), "\x00\xfe\xff");
 }
 
+BOOST_AUTO_TEST_CASE(test_ParallelFor)
+{
+    BOOST_CHECK_EQUAL(GetParallelThreadCount(0, 16), 1U);
+    BOOST_CHECK_EQUAL(GetParallelThreadCount(31, 16), 1U);
+    BOOST_CHECK(GetParallelThreadCount(1000000, 1) <= (size_t)std::max(1, GetNumCores()));
+
+    // every share runs once
+    const size_t nThreads = 8;
+    std::vector<std::atomic<int>> vRuns(nThreads);
+    ParallelFor(nThreads, [&vRuns](size_t n) { ++vRuns[n]; });
+    for (const std::atomic<int>& nRuns : vRuns)
+        BOOST_CHECK_EQUAL(nRuns, 1);
+
+    // a share that throws does not stop the others, the exception reaches the caller
+    std::atomic<int> nDone{0};
+    BOOST_CHECK_THROW(ParallelFor(nThreads, [&nDone](size_t n) {
+        if (n == 3) throw std::runtime_error("share failed");
+        ++nDone;
+    }), std::runtime_error);
+    BOOST_CHECK_EQUAL(nDone, (int)nThreads - 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
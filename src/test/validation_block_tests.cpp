@@ -5,6 +5,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <chainparams.h>
+#include <coins.h>
 #include <consensus/merkle.h>
 #include <consensus/validation.h>
 #include <miner.h>
@@ -184,4 +185,40 @@ BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
     BOOST_CHECK_EQUAL(sub.m_expected_tip, chainActive.Tip()->GetBlockHash());
 }
 
+BOOST_FIXTURE_TEST_CASE(coinstake_spent_on_tip_is_punished, TestingSetup)
+{
+    LOCK(cs_main);
+    const COutPoint stake(InsecureRand256(), 0);
+    pcoinsTip->AddCoin(stake, Coin(CTxOut(1000 * COIN, CScript() << OP_TRUE), 0, false, false), false);
+
+    CMutableTransaction txCoinBase;
+    txCoinBase.vin.resize(1);
+    txCoinBase.vin[0].prevout.SetNull();
+    txCoinBase.vout.emplace_back(0, CScript());
+    CMutableTransaction txCoinStake;
+    txCoinStake.vin.emplace_back(stake);
+    txCoinStake.vout.emplace_back(0, CScript());
+    txCoinStake.vout.emplace_back(1000 * COIN, CScript() << OP_TRUE);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinBase)));
+    block.vtx.push_back(MakeTransactionRef(std::move(txCoinStake)));
+    BOOST_REQUIRE(block.IsProofOfStake());
+
+    // a block on the tip
+    CBlockIndex index;
+    index.pprev = chainActive.Tip();
+    index.nHeight = chainActive.Height() + 1;
+
+    CValidationState state;
+    BOOST_CHECK(CheckCoinStakeInputs(block, &index, state, Params().GetConsensus()));
+    BOOST_CHECK(state.IsValid());
+
+    // the stake is spent by the tip, the block is invalid and its peer punished
+    pcoinsTip->SpendCoin(stake);
+    BOOST_CHECK(!CheckCoinStakeInputs(block, &index, state, Params().GetConsensus()));
+    int nDoS = 0;
+    BOOST_CHECK(state.IsInvalid(nDoS));
+    BOOST_CHECK_EQUAL(nDoS, 100);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
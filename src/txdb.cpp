@@ -11,9 +11,12 @@
 #include <pow.h>
 #include <shutdown.h>
 #include <uint256.h>
+#include <util/parallel.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <ui_interface.h>
 
+#include <algorithm>
 #include <stdint.h>
 
 #include <boost/thread.hpp>
@@ -21,7 +24,6 @@
 static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -29,6 +31,7 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_LOTTERY_PAYOUT_SCRIPT = 'w';
 
 namespace {
 
@@ -223,18 +226,29 @@ void CCoinsViewDBCursor::Next()
     }
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<std::pair<uint256, CDiskBlockIndex> >& blockinfo, const std::vector<std::pair<uint256, CScript> >& lotteryPayoutScripts) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
     }
     batch.Write(DB_LAST_BLOCK, nLastFile);
-    for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
-        batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+    for (std::vector<std::pair<uint256, CDiskBlockIndex> >::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
+        batch.Write(std::make_pair(DB_BLOCK_INDEX, it->first), it->second);
+    }
+    for (const std::pair<uint256, CScript>& payout : lotteryPayoutScripts) {
+        batch.Write(std::make_pair(DB_LOTTERY_PAYOUT_SCRIPT, payout.first), payout.second);
     }
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256& hash, CDiskBlockIndex& diskindex) {
+    return Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex);
+}
+
+bool CBlockTreeDB::ReadLotteryPayoutScript(const uint256& hashCoinstake, CScript& scriptPayout) {
+    return Read(std::make_pair(DB_LOTTERY_PAYOUT_SCRIPT, hashCoinstake), scriptPayout);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -247,98 +261,133 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+namespace {
+/** A block index entry as read from the database, decoded on one of the loading threads */
+struct CBlockIndexRecord
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    uint256 hash;
+    CDataStream ssValue{SER_DISK, CLIENT_VERSION};
+    CDiskBlockIndex diskindex;
+};
+} // namespace
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+//! Block index entries read from the database before they are decoded together
+static const size_t BLOCK_INDEX_LOAD_BATCH_SIZE = 50000;
+//! Block index entries decoded by each thread at least
+static const size_t MIN_BLOCK_INDEX_ENTRIES_PER_THREAD = 2000;
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                //Proof Of Stake
-                pindexNew->nMint = diskindex.nMint;
-                pindexNew->nMoneySupply = diskindex.nMoneySupply;
-                pindexNew->nFlags = diskindex.nFlags;
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->prevoutStake = diskindex.prevoutStake;
-                pindexNew->nStakeTime = diskindex.nStakeTime;
-                pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
-                pindexNew->hashStakeModifierV3 = diskindex.hashStakeModifierV3;
-
-                if(pindexNew->nHeight <= Params().GetConsensus().nLastPOWBlock)
-                {
-                    if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
-                    {
-                        return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-                    }
-                }
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
+/**
+ * Decode a batch of block index entries on all cores. The hash of an entry is
+ * its database key and has been checked when the header was accepted, so it
+ * is only hashed again (with Quark for the older headers) when fCheckHashes is set.
+ */
+static bool DecodeBlockIndexBatch(std::vector<CBlockIndexRecord>& vRecords, const Consensus::Params& consensusParams, bool fCheckHashes)
+{
+    const size_t nThreads = GetParallelThreadCount(vRecords.size(), MIN_BLOCK_INDEX_ENTRIES_PER_THREAD);
+    std::vector<char> vOk(nThreads, true);
+
+    // Entries are interleaved over the threads
+    auto decode = [&](size_t nFirst) {
+        for (size_t i = nFirst; i < vRecords.size(); i += nThreads) {
+            CBlockIndexRecord& record = vRecords[i];
+            try {
+                record.ssValue >> record.diskindex;
+            } catch (const std::exception& e) {
+                vOk[nFirst] = error("%s: failed to read value of block %s: %s", __func__, record.hash.ToString(), e.what());
+                return;
+            }
+            record.ssValue.clear();
+            if (fCheckHashes && record.diskindex.GetBlockHash() != record.hash) {
+                vOk[nFirst] = error("%s: block index entry %s does not match its header", __func__, record.hash.ToString());
+                return;
+            }
+            if (record.diskindex.nHeight <= consensusParams.nLastPOWBlock &&
+                !CheckProofOfWork(record.hash, record.diskindex.nBits, consensusParams)) {
+                vOk[nFirst] = error("%s: CheckProofOfWork failed: %s", __func__, record.diskindex.ToString());
+                return;
             }
-        } else {
-            break;
         }
-    }
+    };
 
-    return true;
-}
+    ParallelFor(nThreads, decode);
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<AddressUnspent> &vect)
-{
-    CDBBatch batch(*this);
-    for (const auto &addressPair : vect)
-    {
-        if (addressPair.second.IsNull())
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, addressPair.first));
-        else
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, addressPair.first), addressPair.second);
-    }
-    return WriteBatch(batch);
+    return std::all_of(vOk.begin(), vOk.end(), [](char fOk) { return fOk; });
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<AddressUnspent> &unspentOutputs)
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, bool fCheckHashes)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    while (pcursor->Valid()) {
+    int64_t nTimeRead = 0, nTimeDecode = 0, nTimeInsert = 0;
+    size_t nEntries = 0;
+
+    // Load mapBlockIndex
+    std::vector<CBlockIndexRecord> vRecords;
+    bool fDone = false;
+    while (!fDone) {
         boost::this_thread::interruption_point();
-        std::pair<char, CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.emplace_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
+
+        const int64_t nTime1 = GetTimeMicros();
+        vRecords.clear();
+        vRecords.reserve(BLOCK_INDEX_LOAD_BATCH_SIZE);
+        while (vRecords.size() < BLOCK_INDEX_LOAD_BATCH_SIZE) {
+            std::pair<char, uint256> key;
+            if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) {
+                fDone = true;
+                break;
             }
-        } else {
-            break;
+            vRecords.emplace_back();
+            vRecords.back().hash = key.second;
+            pcursor->GetValueStream(vRecords.back().ssValue);
+            pcursor->Next();
+        }
+
+        const int64_t nTime2 = GetTimeMicros();
+        if (!DecodeBlockIndexBatch(vRecords, consensusParams, fCheckHashes)) {
+            return false;
         }
+
+        const int64_t nTime3 = GetTimeMicros();
+        for (const CBlockIndexRecord& record : vRecords) {
+            const CDiskBlockIndex& diskindex = record.diskindex;
+
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(record.hash);
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+
+            //Proof Of Stake
+            pindexNew->nMint = diskindex.nMint;
+            pindexNew->nMoneySupply = diskindex.nMoneySupply;
+            pindexNew->nFlags = diskindex.nFlags;
+            pindexNew->nStakeModifier = diskindex.nStakeModifier;
+            pindexNew->prevoutStake = diskindex.prevoutStake;
+            pindexNew->nStakeTime = diskindex.nStakeTime;
+            pindexNew->hashProofOfStake = diskindex.hashProofOfStake;
+            pindexNew->hashStakeModifierV3 = diskindex.hashStakeModifierV3;
+        }
+
+        nEntries += vRecords.size();
+        nTimeRead += nTime2 - nTime1;
+        nTimeDecode += nTime3 - nTime2;
+        nTimeInsert += GetTimeMicros() - nTime3;
     }
 
+    LogPrint(BCLog::BENCH, "    - Block index entries: %u, read %.2fms, decode %.2fms, insert %.2fms\n",
+             nEntries, nTimeRead * 0.001, nTimeDecode * 0.001, nTimeInsert * 0.001);
+
     return true;
 }
 
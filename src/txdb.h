@@ -10,7 +10,6 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
-#include <spentindex.h>
 
 #include <map>
 #include <memory>
@@ -38,6 +37,12 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/divi/divi/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to the address index DB specific cache (MiB)
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to the spent index DB specific cache (MiB)
+static const int64_t nMaxSpentIndexCache = 1024;
+//! Max memory allocated to all block filter index caches combined in MiB.
+static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
@@ -89,17 +94,18 @@ class CBlockTreeDB : public CDBWrapper
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<std::pair<uint256, CDiskBlockIndex> >& blockinfo, const std::vector<std::pair<uint256, CScript> >& lotteryPayoutScripts);
+    bool ReadDiskBlockIndex(const uint256& hash, CDiskBlockIndex& diskindex);
+    /** The payout script of a lottery coinstake, kept next to the block index entries so their format is unchanged */
+    bool ReadLotteryPayoutScript(const uint256& hashCoinstake, CScript& scriptPayout);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
     void ReadReindexing(bool &fReindexing);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
-
-    bool UpdateAddressUnspentIndex(const std::vector<AddressUnspent> &vect);
-    bool ReadAddressUnspentIndex(uint160 addressHash, int type, std::vector<AddressUnspent> &unspentOutputs);
+    /** Load all block index entries. With fCheckHashes the header of every entry is hashed and compared with its key. */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, bool fCheckHashes = false);
 };
 
 #endif // BITCOIN_TXDB_H
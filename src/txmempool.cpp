@@ -8,6 +8,7 @@
 #include <consensus/consensus.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <index/addressindex.h>
 #include <validation.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
@@ -426,6 +427,65 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
+    removeAddressIndex(hash);
+}
+
+void CTxMemPool::addAddressIndex(const CTxMemPoolEntry& entry, const CCoinsViewCache& view)
+{
+    const CTransaction& tx = entry.GetTx();
+    const uint256 txhash = tx.GetHash();
+    std::vector<CMempoolAddressDeltaKey> inserted;
+    uint160 hashBytes;
+    unsigned int type;
+
+    for (unsigned int j = 0; j < tx.vin.size(); j++) {
+        const CTxIn& input = tx.vin[j];
+        const Coin& coin = view.AccessCoin(input.prevout);
+        if (!GetAddressIndexKey(coin.out.scriptPubKey, hashBytes, type)) continue;
+
+        CMempoolAddressDeltaKey key(type, hashBytes, txhash, j, true);
+        mapAddress.emplace(key, CMempoolAddressDelta(entry.GetTime(), -coin.out.nValue, input.prevout.hash, input.prevout.n));
+        inserted.push_back(key);
+    }
+
+    for (unsigned int k = 0; k < tx.vout.size(); k++) {
+        const CTxOut& out = tx.vout[k];
+        if (!GetAddressIndexKey(out.scriptPubKey, hashBytes, type)) continue;
+
+        CMempoolAddressDeltaKey key(type, hashBytes, txhash, k, false);
+        mapAddress.emplace(key, CMempoolAddressDelta(entry.GetTime(), out.nValue));
+        inserted.push_back(key);
+    }
+
+    if (!inserted.empty()) {
+        cachedAddressUsage += memusage::DynamicUsage(inserted);
+        mapAddressInserted.emplace(txhash, std::move(inserted));
+    }
+}
+
+void CTxMemPool::getAddressIndex(const std::vector<std::pair<uint160, int>>& addresses,
+                                 std::vector<MempoolAddressDelta>& results) const
+{
+    LOCK(cs);
+    for (const auto& address : addresses) {
+        auto it = mapAddress.lower_bound(CMempoolAddressDeltaKey(address.second, address.first));
+        while (it != mapAddress.end() && it->first.addressBytes == address.first && it->first.type == address.second) {
+            results.push_back(*it);
+            ++it;
+        }
+    }
+}
+
+void CTxMemPool::removeAddressIndex(const uint256& txhash)
+{
+    auto it = mapAddressInserted.find(txhash);
+    if (it == mapAddressInserted.end()) return;
+
+    for (const CMempoolAddressDeltaKey& key : it->second) {
+        mapAddress.erase(key);
+    }
+    cachedAddressUsage -= memusage::DynamicUsage(it->second);
+    mapAddressInserted.erase(it);
 }
 
 // Calculates descendants of entry that are not already in setDescendants, and adds to
@@ -580,6 +640,9 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapAddress.clear();
+    mapAddressInserted.clear();
+    cachedAddressUsage = 0;
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -911,7 +974,8 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage +
+           memusage::DynamicUsage(mapAddress) + memusage::DynamicUsage(mapAddressInserted) + cachedAddressUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
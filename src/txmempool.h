@@ -19,6 +19,7 @@
 #include <indirectmap.h>
 #include <policy/feerate.h>
 #include <primitives/transaction.h>
+#include <spentindex.h>
 #include <sync.h>
 #include <random.h>
 
@@ -512,6 +513,13 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
+    /** Address index deltas of the pool, only filled while the address index is enabled. */
+    std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta> mapAddress GUARDED_BY(cs);
+    std::map<uint256, std::vector<CMempoolAddressDeltaKey>> mapAddressInserted GUARDED_BY(cs);
+    uint64_t cachedAddressUsage GUARDED_BY(cs) = 0; //!< sum of dynamic memory usage of the mapAddressInserted key lists
+
+    void removeAddressIndex(const uint256& txhash) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -562,6 +570,12 @@ public:
      */
     bool HasNoInputsOf(const CTransaction& tx) const;
 
+    /** Record the address deltas of a newly added entry, resolving its inputs through view */
+    void addAddressIndex(const CTxMemPoolEntry& entry, const CCoinsViewCache& view) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Append the pool deltas of the given (type, hash) addresses */
+    void getAddressIndex(const std::vector<std::pair<uint160, int>>& addresses,
+                         std::vector<MempoolAddressDelta>& results) const;
+
     /** Affect CreateNewBlock prioritisation of transactions */
     void PrioritiseTransaction(const uint256& hash, const CAmount& nFeeDelta);
     void ApplyDelta(const uint256 hash, CAmount &nFeeDelta) const;
@@ -0,0 +1,52 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/parallel.h>
+
+#include <util/system.h>
+
+#include <algorithm>
+#include <exception>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+size_t GetParallelThreadCount(size_t nItems, size_t nMinItemsPerThread)
+{
+    return std::max<size_t>(1, std::min<size_t>(GetNumCores(), nItems / std::max<size_t>(1, nMinItemsPerThread)));
+}
+
+void ParallelFor(size_t nThreads, const std::function<void(size_t)>& fn)
+{
+    std::vector<std::exception_ptr> vErrors(nThreads);
+    auto run = [&fn, &vErrors](size_t n) {
+        try {
+            fn(n);
+        } catch (...) {
+            vErrors[n] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    size_t nStarted = 1;
+    try {
+        vThreads.reserve(nThreads);
+        for (; nStarted < nThreads; nStarted++)
+            vThreads.emplace_back(run, nStarted);
+    } catch (const std::system_error&) {
+        // out of threads, the shares not started are run below
+    } catch (const std::bad_alloc&) {
+    }
+
+    run(0);
+    for (size_t n = nStarted; n < nThreads; n++)
+        run(n);
+    for (std::thread& thread : vThreads)
+        thread.join();
+
+    for (const std::exception_ptr& error : vErrors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
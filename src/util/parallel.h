@@ -0,0 +1,26 @@
+// Copyright (c) 2019 The DIVI Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_PARALLEL_H
+#define BITCOIN_UTIL_PARALLEL_H
+
+#include <functional>
+#include <stddef.h>
+
+/**
+ * Number of threads to spread nItems over: one per core, but no more than
+ * leaves each thread nMinItemsPerThread, below which starting a thread costs
+ * more than it saves. At least one.
+ */
+size_t GetParallelThreadCount(size_t nItems, size_t nMinItemsPerThread);
+
+/**
+ * Call fn(n) for every n from 0 to nThreads - 1, each on a thread of its own,
+ * and wait for all of them. The calling thread takes n = 0. A share whose
+ * thread cannot be started runs on the calling thread instead. An exception
+ * thrown by fn is rethrown on the calling thread once every thread is joined.
+ */
+void ParallelFor(size_t nThreads, const std::function<void(size_t)>& fn);
+
+#endif // BITCOIN_UTIL_PARALLEL_H
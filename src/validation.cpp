@@ -18,6 +18,7 @@
 #include <consensus/kernel.h>
 #include <cuckoocache.h>
 #include <hash.h>
+#include <index/addressindex.h>
 #include <index/txindex.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -44,11 +45,14 @@
 #include <warnings.h>
 #include <spork.h>
 #include <sporkdb.h>
+#include <masternodes/masternode-lastpaid.h>
 #include <masternodes/masternode-payments.h>
 #include <masternodes/masternode-sync.h>
+#include <masternodes/masternodeman.h>
 
 #include <future>
 #include <sstream>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -241,7 +245,6 @@ size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
-bool fAddressIndex = false;
 
 uint256 hashAssumeValid;
 arith_uint256 nMinimumChainWork;
@@ -256,7 +259,6 @@ CTxMemPool mempool(&feeEstimator);
 std::atomic_bool g_is_mempool_loaded{false};
 
 std::map<unsigned int, unsigned int> mapHashedBlocks;
-static std::map<uint256, uint256> mapProofOfStake;
 std::unique_ptr<CSporkDB> pSporkDB;
 
 /** Constant stuff for coinbase transactions we create: */
@@ -285,6 +287,35 @@ bool fCheckForPruning = false;
 /** Dirty block index entries. */
 std::set<CBlockIndex*> setDirtyBlockIndex;
 
+/**
+ * Lottery winners of the block index entries of about the last two lottery cycles,
+ * the ones of older blocks are read back from the block tree when needed.
+ * Consecutive blocks without a new lottery participant share one list. The
+ * entries are ordered by height as well, so the oldest are dropped first.
+ */
+static std::unordered_map<const CBlockIndex*, std::shared_ptr<const std::vector<CLotteryWinner>>> mapLotteryWinners GUARDED_BY(cs_main);
+static std::set<std::pair<int, const CBlockIndex*>> setLotteryWinnersByHeight GUARDED_BY(cs_main);
+
+/**
+ * Block tree records of dirty entries whose lottery winners are not cached, or
+ * which are pre-segwit blocks with zerocoin fields. They are read when the entry
+ * is first marked dirty, still under cs_main, so that flushing only has writes to
+ * do. Entries of recent blocks have their winners cached and need no read.
+ */
+static std::unordered_map<const CBlockIndex*, CDiskBlockIndex> mapDirtyBlockRecords GUARDED_BY(cs_main);
+
+typedef std::unordered_set<COutPoint, SaltedOutpointHasher> BlockSpends;
+/**
+ * Outpoints spent by the side branch blocks within the reorganization limit. A
+ * branch is the chain of these sets from its tip back to the fork point, shared
+ * by every block built on top of it, so a coinstake on a side branch is checked
+ * without reading the branch from disk. Blocks that extended the tip when they
+ * were accepted are only added once a branch has to read them back. The entries
+ * are ordered by height as well, so the ones below the limit are dropped first.
+ */
+static std::unordered_map<const CBlockIndex*, std::shared_ptr<const BlockSpends>> mapBlockSpends GUARDED_BY(cs_main);
+static std::set<std::pair<int, const CBlockIndex*>> setBlockSpendsByHeight GUARDED_BY(cs_main);
+
 /** Dirty block file entries. */
 std::set<int> setDirtyFileInfo;
 } // anon namespace
@@ -312,6 +343,11 @@ std::unique_ptr<CCoinsViewDB> pcoinsdbview;
 std::unique_ptr<CCoinsViewCache> pcoinsTip;
 std::unique_ptr<CBlockTreeDB> pblocktree;
 
+static CDiskBlockIndex GetDiskBlockIndex(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+static void SetDirtyBlockIndex(CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+static std::shared_ptr<const std::vector<CLotteryWinner>> LookupLotteryWinners(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+static void EvictLotteryWinners() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 enum class FlushStateMode {
     NONE,
     IF_NEEDED,
@@ -978,6 +1014,9 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
 
         // Store transaction in memory
         pool.addUnchecked(entry, setAncestors, validForFeeEstimation);
+        if (g_addressindex) {
+            pool.addAddressIndex(entry, view);
+        }
 
         // trim mempool and check if tx was trimmed
         if (!bypass_limits) {
@@ -1247,10 +1286,8 @@ static CAmount GetFullBlockValue(int nHeight, const Consensus::Params &consensus
     }
 
     if(sporkManager.IsSporkActive(SPORK_15_BLOCK_VALUE)) {
-        MultiValueSporkList<BlockSubsiditySporkValue> vBlockSubsiditySporkValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager.GetMultiValueSpork(SPORK_15_BLOCK_VALUE), vBlockSubsiditySporkValues);
         auto nBlockTime = chainActive[nHeight] ? chainActive[nHeight]->nTime : GetAdjustedTime();
-        BlockSubsiditySporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vBlockSubsiditySporkValues, nHeight, nBlockTime);
+        BlockSubsiditySporkValue activeSpork = sporkManager.GetBlockSubsiditySpork(nHeight, nBlockTime);
 
         if(activeSpork.IsValid()) {
             // we expect that this value is in coins, not in satoshis
@@ -1290,10 +1327,8 @@ CBlockRewards GetBlockSubsidity(int nHeight, const Consensus::Params &consensus)
 
 
     if(sporkManager.IsSporkActive(SPORK_13_BLOCK_PAYMENTS)) {
-        MultiValueSporkList<BlockPaymentSporkValue> vBlockPaymentsValues;
-        CSporkManager::ConvertMultiValueSporkVector(sporkManager.GetMultiValueSpork(SPORK_13_BLOCK_PAYMENTS), vBlockPaymentsValues);
         auto nBlockTime = chainActive[nHeight] ? chainActive[nHeight]->nTime : GetAdjustedTime();
-        BlockPaymentSporkValue activeSpork = CSporkManager::GetActiveMultiValueSpork(vBlockPaymentsValues, nHeight, nBlockTime);
+        BlockPaymentSporkValue activeSpork = sporkManager.GetBlockPaymentSpork(nHeight, nBlockTime);
 
         if(activeSpork.IsValid()) {
             // we expect that this value is in coins, not in satoshis
@@ -1443,7 +1478,7 @@ void CChainState::InvalidBlockFound(CBlockIndex *pindex, const CValidationState
     if (!state.CorruptionPossible()) {
         pindex->nStatus |= BLOCK_FAILED_VALID;
         m_failed_blocks.insert(pindex);
-        setDirtyBlockIndex.insert(pindex);
+        SetDirtyBlockIndex(pindex);
         setBlockIndexCandidates.erase(pindex);
         InvalidChainFound(pindex);
     }
@@ -1634,7 +1669,9 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
 {
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
@@ -1665,6 +1702,8 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1736,34 +1775,12 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
         return DISCONNECT_FAILED;
     }
 
-    std::vector<AddressUnspent> addressUnspentIndex;
-
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = *(block.vtx[i]);
         uint256 hash = tx.GetHash();
         bool is_coinbase = tx.IsCoinBase();
 
-        if (fAddressIndex)
-        {
-            for (size_t k = tx.vout.size(); k > 0; --k)
-            {
-                const auto &out = tx.vout[k];
-
-                // undo unspent indexes
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-                    addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-                    addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                }
-            }
-        }
-
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
         for (size_t o = 0; o < tx.vout.size(); o++) {
@@ -1785,28 +1802,10 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
                 return DISCONNECT_FAILED;
             }
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
-                const auto &input = tx.vin[j];
-                const auto &out = input.prevout;
-                int undoHeight = txundo.vprevout[j].nHeight;
+                const COutPoint &out = tx.vin[j].prevout;
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                if (fAddressIndex) {
-                    const auto &coin = view.AccessCoin(input.prevout);
-                    const auto &prevout = coin.out;
-                    // restore unspent indexes
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-                        addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-                        addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    }
-                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -1815,15 +1814,6 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (fAddressIndex)
-    {
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
-        {
-            error("DisconnectBlock(): Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -1870,7 +1860,7 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
         // update nUndoPos in block index
         pindex->nUndoPos = _pos.nPos;
         pindex->nStatus |= BLOCK_HAVE_UNDO;
-        setDirtyBlockIndex.insert(pindex);
+        SetDirtyBlockIndex(pindex);
     }
 
     return true;
@@ -2156,6 +2146,20 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
     }
 
+    // ppcoin: check the kernel and record the proof-of-stake hash value, the
+    // stake inputs are still unspent in view at this point
+    if (block.IsProofOfStake()) {
+        uint256 hashProofOfStake;
+        if (!CheckProofOfStake(block, pindex->pprev, view, hashProofOfStake))
+            return state.DoS(100, error("ConnectBlock(): check proof-of-stake failed for block %s", block.GetHash().ToString()),
+                             REJECT_INVALID, "bad-proof-of-stake");
+
+        if (!fJustCheck && pindex->hashProofOfStake != hashProofOfStake) {
+            pindex->hashProofOfStake = hashProofOfStake;
+            SetDirtyBlockIndex(pindex);
+        }
+    }
+
     // Start enforcing BIP68 (sequence locks) and BIP112 (CHECKSEQUENCEVERIFY) using versionbits logic.
     int nLockTimeFlags = 0;
     if (IsWitnessEnabled(pindex->nHeight, chainparams.GetConsensus())) {
@@ -2182,13 +2186,11 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
-    std::vector<AddressUnspent> addressUnspentIndex;
     CAmount nValueOut = 0;
     CAmount nValueIn = 0;
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const auto &txhash = tx.GetHash();
         nInputs += tx.vin.size();
 
         if (!tx.IsCoinBase())
@@ -2215,33 +2217,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); ++j)
-                {
-                    const auto input = tx.vin[j];
-                    const auto &coin = view.AccessCoin(tx.vin[j].prevout);
-                    const auto &prevout = coin.out;
-                    uint160 hashBytes;
-                    int addressType = 0;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
-                        addressType = 1;
-                    }
-
-                    // remove address from unspent index
-                    if (addressType > 0)
-                        addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                }
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
@@ -2271,26 +2246,6 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
         nValueOut += tx.GetValueOut();
 
-        if (fAddressIndex)
-        {
-            for (size_t k = 0; k < tx.vout.size(); ++k)
-            {
-                const auto &out = tx.vout[k];
-
-                // record unspent outputs
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-                    addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-                    addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressUnspentIndex.emplace_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                }
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2323,6 +2278,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                          REJECT_INVALID, "bad-cb-amount");
     }
 
+    if (IsValidLotteryBlockHeight(pindex->nHeight, chainparams.GetConsensus()) && !LookupLotteryWinners(pindex->pprev))
+        return AbortNode(state, "Failed to read the lottery winners of a block");
+
     if (!IsBlockPayeeValid(*coinbaseTx, pindex->nHeight, pindex->pprev, chainparams.GetConsensus())) {
         //        mapRejectedBlocks.insert(std::make_pair(block.GetHash(), GetTime()));
         return state.DoS(0, error("ConnectBlock(): couldn't find masternode or superblock payments"),
@@ -2340,13 +2298,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
         return false;
 
-    if (fAddressIndex)
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex))
-            return AbortNode(state, "Failed to write address unspent index");
-
     if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
-        setDirtyBlockIndex.insert(pindex);
+        SetDirtyBlockIndex(pindex);
     }
 
     if(g_txindex) {
@@ -2440,15 +2394,28 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                         vFiles.push_back(std::make_pair(*it, &vinfoBlockFile[*it]));
                         setDirtyFileInfo.erase(it++);
                     }
-                    std::vector<const CBlockIndex*> vBlocks;
+                    std::vector<std::pair<uint256, CDiskBlockIndex> > vBlocks;
                     vBlocks.reserve(setDirtyBlockIndex.size());
+                    std::vector<std::pair<uint256, CScript> > vLotteryPayoutScripts;
+                    std::set<uint256> setLotteryCoinstakes;
                     for (std::set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
-                        vBlocks.push_back(*it);
+                        vBlocks.emplace_back((*it)->GetBlockHash(), GetDiskBlockIndex(*it));
+                        // the payout scripts go next to the record, which only holds the coinstakes
+                        auto itWinners = mapLotteryWinners.find(*it);
+                        if (itWinners != mapLotteryWinners.end()) {
+                            for (const CLotteryWinner& winner : *itWinners->second) {
+                                if (setLotteryCoinstakes.insert(winner.hashCoinstake).second)
+                                    vLotteryPayoutScripts.emplace_back(winner.hashCoinstake, winner.scriptPayout);
+                            }
+                        }
+                        mapDirtyBlockRecords.erase(*it);
                         setDirtyBlockIndex.erase(it++);
                     }
-                    if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                    if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks, vLotteryPayoutScripts)) {
                         return AbortNode(state, "Failed to write to block index database");
                     }
+                    // the winners that were held back for the write can go now
+                    EvictLotteryWinners();
                 }
                 // Finally remove any pruned files
                 if (fFlushForPrune)
@@ -2618,6 +2585,8 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
         }
     }
 
+    masternodeLastPaid.BlockDisconnected(block, pindexDelete, chainparams.GetConsensus());
+
     chainActive.SetTip(pindexDelete->pprev);
 
     UpdateTip(pindexDelete->pprev, chainparams);
@@ -2763,6 +2732,7 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update chainActive & related variables.
     chainActive.SetTip(pindexNew);
+    masternodeLastPaid.BlockConnected(blockConnecting, pindexNew, chainparams.GetConsensus());
     UpdateTip(pindexNew, chainparams);
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
@@ -3126,14 +3096,14 @@ bool CChainState::InvalidateBlock(CValidationState& state, const CChainParams& c
     // (note this may not be all descendants).
     while (pindex_was_in_chain && invalid_walk_tip != pindex) {
         invalid_walk_tip->nStatus |= BLOCK_FAILED_CHILD;
-        setDirtyBlockIndex.insert(invalid_walk_tip);
+        SetDirtyBlockIndex(invalid_walk_tip);
         setBlockIndexCandidates.erase(invalid_walk_tip);
         invalid_walk_tip = invalid_walk_tip->pprev;
     }
 
     // Mark the block itself as invalid.
     pindex->nStatus |= BLOCK_FAILED_VALID;
-    setDirtyBlockIndex.insert(pindex);
+    SetDirtyBlockIndex(pindex);
     setBlockIndexCandidates.erase(pindex);
     m_failed_blocks.insert(pindex);
 
@@ -3174,7 +3144,7 @@ void CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
     while (it != mapBlockIndex.end()) {
         if (!it->second->IsValid() && it->second->GetAncestor(nHeight) == pindex) {
             it->second->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(it->second);
+            SetDirtyBlockIndex(it->second);
             if (it->second->IsValid(BLOCK_VALID_TRANSACTIONS) && it->second->HaveTxsDownloaded() && setBlockIndexCandidates.value_comp()(chainActive.Tip(), it->second)) {
                 setBlockIndexCandidates.insert(it->second);
             }
@@ -3191,7 +3161,7 @@ void CChainState::ResetBlockFailureFlags(CBlockIndex *pindex) {
     while (pindex != nullptr) {
         if (pindex->nStatus & BLOCK_FAILED_MASK) {
             pindex->nStatus &= ~BLOCK_FAILED_MASK;
-            setDirtyBlockIndex.insert(pindex);
+            SetDirtyBlockIndex(pindex);
             m_failed_blocks.erase(pindex);
         }
         pindex = pindex->pprev;
@@ -3202,11 +3172,161 @@ void ResetBlockFailureFlags(CBlockIndex *pindex) {
     return g_chainstate.ResetBlockFailureFlags(pindex);
 }
 
-static void AcceptProofOfStakeBlock(const CBlock &block, CBlockIndex *pindexNew)
+/**
+ * Payout scripts are kept in the block tree since they were recorded with the
+ * winners, the ones of older coinstakes are not. Those are taken from the winners
+ * of the earlier blocks of the cycle, or read from the block that entered the
+ * coinstake into the lottery.
+ */
+static bool ResolveLotteryPayoutScript(const CBlockIndex* pindex, const uint256& hashCoinstake, CScript& scriptPayout) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
-    if(!pindexNew)
+    if (pblocktree->ReadLotteryPayoutScript(hashCoinstake, scriptPayout))
+        return true;
+
+    const CBlockIndex* pindexEntered = pindex;
+    for (const CBlockIndex* pwalk = pindex->pprev; pwalk; pwalk = pwalk->pprev) {
+        auto it = mapLotteryWinners.find(pwalk);
+        if (it != mapLotteryWinners.end()) {
+            for (const CLotteryWinner& winner : *it->second) {
+                if (winner.hashCoinstake == hashCoinstake) {
+                    scriptPayout = winner.scriptPayout;
+                    return true;
+                }
+            }
+            break;
+        }
+
+        CDiskBlockIndex record;
+        if (!pblocktree->ReadDiskBlockIndex(pwalk->GetBlockHash(), record))
+            break;
+        if (std::find(record.vLotteryWinnersCoinstakes.begin(), record.vLotteryWinnersCoinstakes.end(), hashCoinstake) == record.vLotteryWinnersCoinstakes.end())
+            break;
+        pindexEntered = pwalk;
+    }
+
+    CTransactionRef tx;
+    uint256 hashBlock;
+    const bool fHaveBlock = pindexEntered->nStatus & BLOCK_HAVE_DATA;
+    if (!(fHaveBlock && GetTransaction(hashCoinstake, tx, Params().GetConsensus(), hashBlock, false, const_cast<CBlockIndex*>(pindexEntered))) &&
+        !GetTransaction(hashCoinstake, tx, Params().GetConsensus(), hashBlock, false)) {
+        return error("%s: lottery coinstake %s of block %s not found", __func__, hashCoinstake.ToString(), pindex->GetBlockHash().ToString());
+    }
+    scriptPayout = GetLotteryPayoutScript(*tx);
+    return true;
+}
+
+/** The lottery winners of pindex, nullptr if they could not be read back */
+static std::shared_ptr<const std::vector<CLotteryWinner>> LookupLotteryWinners(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    auto it = mapLotteryWinners.find(pindex);
+    if (it != mapLotteryWinners.end())
+        return it->second;
+
+    std::vector<CLotteryWinner> vWinners;
+    CDiskBlockIndex diskindex;
+    if (pblocktree->ReadDiskBlockIndex(pindex->GetBlockHash(), diskindex)) {
+        for (const uint256& hashCoinstake : diskindex.vLotteryWinnersCoinstakes) {
+            CLotteryWinner winner{hashCoinstake, CScript()};
+            if (!ResolveLotteryPayoutScript(pindex, winner.hashCoinstake, winner.scriptPayout))
+                return nullptr;
+            vWinners.push_back(std::move(winner));
+        }
+    }
+
+    auto winners = std::make_shared<const std::vector<CLotteryWinner>>(std::move(vWinners));
+    mapLotteryWinners.emplace(pindex, winners);
+    setLotteryWinnersByHeight.emplace(pindex->nHeight, pindex);
+    EvictLotteryWinners();
+    return winners;
+}
+
+std::shared_ptr<const std::vector<CLotteryWinner>> GetLotteryWinners(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    return LookupLotteryWinners(pindex);
+}
+
+size_t GetLotteryWinnersCacheSize()
+{
+    LOCK(cs_main);
+    return mapLotteryWinners.size();
+}
+
+/** Drop the winners of the entries more than two lottery cycles below the highest one, unless they still have to be written out */
+static void EvictLotteryWinners()
+{
+    if (setLotteryWinnersByHeight.empty()) return;
+
+    const int nMinHeight = setLotteryWinnersByHeight.rbegin()->first - 2 * Params().GetConsensus().nLotteryBlockCycle;
+    while (!setLotteryWinnersByHeight.empty()) {
+        auto it = setLotteryWinnersByHeight.begin();
+        // a dirty entry holds back the ones above it until the next flush
+        if (it->first >= nMinHeight || setDirtyBlockIndex.count(const_cast<CBlockIndex*>(it->second)))
+            break;
+        mapLotteryWinners.erase(it->second);
+        setLotteryWinnersByHeight.erase(it);
+    }
+}
+
+static void SetLotteryWinners(const CBlockIndex* pindex, std::vector<CLotteryWinner> vWinners) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::shared_ptr<const std::vector<CLotteryWinner>> winners;
+    if (pindex->pprev) {
+        auto prevWinners = LookupLotteryWinners(pindex->pprev);
+        if (prevWinners && *prevWinners == vWinners)
+            winners = prevWinners;
+    }
+    if (!winners)
+        winners = std::make_shared<const std::vector<CLotteryWinner>>(std::move(vWinners));
+    mapLotteryWinners[pindex] = winners;
+    setLotteryWinnersByHeight.emplace(pindex->nHeight, pindex);
+    EvictLotteryWinners();
+}
+
+static void SetDirtyBlockIndex(CBlockIndex* pindex)
+{
+    if (!setDirtyBlockIndex.insert(pindex).second || mapDirtyBlockRecords.count(pindex))
+        return;
+    if (mapLotteryWinners.count(pindex) && pindex->nVersion != VERSIONBITS_PRESEGWIT_BLOCK_VERSION)
         return;
 
+    // keep what the current record holds for when the entry is written
+    CDiskBlockIndex record;
+    if (pblocktree->ReadDiskBlockIndex(pindex->GetBlockHash(), record))
+        mapDirtyBlockRecords.emplace(pindex, std::move(record));
+}
+
+/** The block tree record of pindex, with the fields that are not kept in memory */
+static CDiskBlockIndex GetDiskBlockIndex(const CBlockIndex* pindex)
+{
+    CDiskBlockIndex diskindex(pindex);
+
+    auto itRecord = mapDirtyBlockRecords.find(pindex);
+    if (itRecord != mapDirtyBlockRecords.end()) {
+        CDiskBlockIndex& record = itRecord->second;
+        diskindex.vLotteryWinnersCoinstakes = std::move(record.vLotteryWinnersCoinstakes);
+        diskindex.nAccumulatorCheckpoint = record.nAccumulatorCheckpoint;
+        diskindex.mapZerocoinSupply = std::move(record.mapZerocoinSupply);
+        diskindex.vMintDenominationsInBlock = std::move(record.vMintDenominationsInBlock);
+    }
+
+    auto it = mapLotteryWinners.find(pindex);
+    if (it != mapLotteryWinners.end()) {
+        diskindex.vLotteryWinnersCoinstakes.clear();
+        for (const CLotteryWinner& winner : *it->second) {
+            diskindex.vLotteryWinnersCoinstakes.push_back(winner.hashCoinstake);
+        }
+    }
+
+    return diskindex;
+}
+
+/** Set the proof-of-stake fields and lottery winners of pindexNew, false if the winners of its parent could not be read */
+static bool AcceptProofOfStakeBlock(const CBlock &block, CBlockIndex *pindexNew)
+{
+    if(!pindexNew)
+        return true;
+
     if (block.IsProofOfStake()) {
         pindexNew->SetProofOfStake();
         pindexNew->prevoutStake = block.vtx[1]->vin[0].prevout;
@@ -3219,27 +3339,19 @@ static void AcceptProofOfStakeBlock(const CBlock &block, CBlockIndex *pindexNew)
     //update previous block pointer
     //        pindexNew->pprev->pnext = pindexNew;
 
-    // ppcoin: compute chain trust score
-    pindexNew->bnChainTrust = (pindexNew->pprev ? pindexNew->pprev->bnChainTrust : ArithToUint256(0 + pindexNew->GetBlockTrust()));
-
     // ppcoin: compute stake entropy bit for stake modifier
     if (!pindexNew->SetStakeEntropyBit(pindexNew->GetStakeEntropyBit()))
         LogPrintf("AcceptProofOfStakeBlock() : SetStakeEntropyBit() failed \n");
 
-    uint256 hash = block.GetHash();
-
-    // ppcoin: record proof-of-stake hash value
-    if (pindexNew->IsProofOfStake()) {
-        if (!mapProofOfStake.count(hash))
-            LogPrintf("AcceptProofOfStakeBlock() : hashProofOfStake not found in map \n");
-        pindexNew->hashProofOfStake = mapProofOfStake[hash];
-    }
-
     ComputeAndSetStakeModifier(pindexNew, Params().GetConsensus());
 
-    pindexNew->vLotteryWinnersCoinstakes = CalculateLotteryWinners(block, pindexNew->pprev, pindexNew->nHeight, Params().GetConsensus());
+    std::vector<CLotteryWinner> vWinners;
+    if (!CalculateLotteryWinners(block, pindexNew->pprev, pindexNew->nHeight, Params().GetConsensus(), vWinners))
+        return false;
+    SetLotteryWinners(pindexNew, std::move(vWinners));
 
-    setDirtyBlockIndex.insert(pindexNew);
+    SetDirtyBlockIndex(pindexNew);
+    return true;
 }
 
 CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
@@ -3273,6 +3385,7 @@ CBlockIndex* CChainState::AddToBlockIndex(const CBlockHeader& block)
     if (pindexBestHeader == nullptr || pindexBestHeader->nChainWork < pindexNew->nChainWork)
         pindexBestHeader = pindexNew;
 
+    // a new entry has no record to carry fields over from
     setDirtyBlockIndex.insert(pindexNew);
 
     return pindexNew;
@@ -3291,7 +3404,7 @@ void CChainState::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pi
         pindexNew->nStatus |= BLOCK_OPT_WITNESS;
     }
     pindexNew->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
-    setDirtyBlockIndex.insert(pindexNew);
+    SetDirtyBlockIndex(pindexNew);
 
     if (pindexNew->pprev == nullptr || pindexNew->pprev->HaveTxsDownloaded()) {
         // If pindexNew is the genesis block or all parents are BLOCK_VALID_TRANSACTIONS.
@@ -3473,24 +3586,12 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
             if (block.vtx[i]->IsCoinStake())
                 return state.DoS(100, error("CheckBlock() : more than one coinstake"));
 
-        uint256 hashProofOfStake;
-        uint256 hash = block.GetHash();
-
-        CBlock blockTmp = block;
-
-        CBlockSigner signer(blockTmp, nullptr);
-
-        if(!signer.CheckBlockSignature()) {
+        if(!CheckBlockSignature(block)) {
             return state.DoS(100, error("CheckBlock(): block signature invalid"),
                              REJECT_INVALID, "bad-block-signature");
         }
 
-        if(!CheckProofOfStake(block, hashProofOfStake)) {
-            return state.DoS(100, error("CheckBlock(): check proof-of-stake failed for block %s\n", hash.ToString().c_str()));
-        }
-
-        if(!mapProofOfStake.count(hash)) // add to mapProofOfStake
-            mapProofOfStake.insert(std::make_pair(hash, hashProofOfStake));
+        // The kernel itself is checked in ConnectBlock, against the coins it spends
     }
 
     // Check transactions
@@ -3778,7 +3879,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
                     CBlockIndex* invalid_walk = pindexPrev;
                     while (invalid_walk != failedit) {
                         invalid_walk->nStatus |= BLOCK_FAILED_CHILD;
-                        setDirtyBlockIndex.insert(invalid_walk);
+                        SetDirtyBlockIndex(invalid_walk);
                         invalid_walk = invalid_walk->pprev;
                     }
                     return state.DoS(100, error("%s: prev block invalid", __func__), REJECT_INVALID, "bad-prevblk");
@@ -3853,6 +3954,122 @@ static CDiskBlockPos SaveBlockToDisk(const CBlock& block, int nHeight, const CCh
     return blockPos;
 }
 
+/** Outpoints spent by the transactions of block, other than its coinbase */
+static std::shared_ptr<const BlockSpends> MakeBlockSpends(const CBlock& block)
+{
+    auto spends = std::make_shared<BlockSpends>();
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& in : tx->vin)
+            spends->insert(in.prevout);
+    }
+    return spends;
+}
+
+/** Keep the spends of the block of pindex, dropping those of blocks below the reorganization limit */
+static void SetBlockSpends(const CBlockIndex* pindex, std::shared_ptr<const BlockSpends> spends) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (mapBlockSpends.emplace(pindex, std::move(spends)).second)
+        setBlockSpendsByHeight.emplace(pindex->nHeight, pindex);
+
+    // No block is accepted on a branch forking off below the reorganization limit
+    while (!setBlockSpendsByHeight.empty() && setBlockSpendsByHeight.begin()->first + MAX_REORGANIZATION_DEPTH < chainActive.Height()) {
+        mapBlockSpends.erase(setBlockSpendsByHeight.begin()->second);
+        setBlockSpendsByHeight.erase(setBlockSpendsByHeight.begin());
+    }
+}
+
+/** Outpoints spent by the block of pindex, read from disk when they are not in memory */
+static std::shared_ptr<const BlockSpends> GetBlockSpends(const CBlockIndex* pindex, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    auto it = mapBlockSpends.find(pindex);
+    if (it != mapBlockSpends.end())
+        return it->second;
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, consensusParams))
+        return nullptr;
+
+    auto spends = MakeBlockSpends(block);
+    SetBlockSpends(pindex, spends);
+    return spends;
+}
+
+bool CheckCoinStakeInputs(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const Consensus::Params& consensusParams)
+{
+    AssertLockHeld(cs_main);
+    if (!block.IsProofOfStake())
+        return true;
+
+    const auto &stakeTransaction = block.vtx[1];
+
+    BlockSpends setStakeInputs;
+    for (const auto &stakeIn : stakeTransaction->vin)
+        setStakeInputs.insert(stakeIn.prevout);
+
+    for (const auto &transaction : block.vtx)
+    {
+        if(transaction->IsCoinStake())
+            continue; //skip coinstake transaction
+
+        // Check if coinstake input is double spent inside the same block
+        for (const auto& in: transaction->vin)
+            if(setStakeInputs.count(in.prevout))
+                return error("%s: double spent coinstake input inside block", __func__);
+    }
+
+    bool isBlockFromFork = pindex && chainActive.Tip() != pindex->pprev;
+    int splitHeight = -1;
+
+    if (isBlockFromFork)
+    {
+        auto previousIndex = pindex->pprev;
+        int nofReadBlocks{0};
+
+        do
+        {
+            if(nofReadBlocks == MAX_REORGANIZATION_DEPTH)
+                return error("%s: forked chain longer than maximum reorg limit", __func__); // TODO: Remove this chain from disk.
+
+            auto spends = GetBlockSpends(previousIndex, consensusParams);
+            if(!spends)
+                return error("%s: previous block %s not on disk", __func__, previousIndex->GetBlockHash().GetHex());
+
+            ++nofReadBlocks;
+
+            for (const auto &stakeIn : stakeTransaction->vin)
+                if (spends->count(stakeIn.prevout))
+                    return state.DoS(100, error("%s: input already spent on a previous block", __func__));
+
+            previousIndex = previousIndex->pprev;
+        }
+        while(!chainActive.Contains(previousIndex));
+
+        splitHeight = previousIndex->nHeight;
+    }
+
+    const auto& coins = pcoinsTip;
+
+    for (const auto& stakeIn: stakeTransaction->vin)
+    {
+        if(!coins->HaveCoin(stakeIn.prevout))
+        {
+            /* Get the height of the spent and validate it with the forked height
+               Check if this occurred before the chain split */
+            auto  coin = coins->AccessCoin(stakeIn.prevout);
+            if(!(isBlockFromFork && coin.nHeight > splitHeight)) {
+                // A block on the tip is checked against the coins of its own parent, the
+                // stake is spent on the chain the block extends and the block is invalid
+                if (!isBlockFromFork)
+                    return state.DoS(100, error("%s: coin stake inputs already spent in main chain", __func__));
+                return error("%s: coin stake inputs already spent in main chain", __func__);
+            }
+        }
+    }
+
+    return true;
+}
+
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock)
 {
@@ -3903,76 +4120,21 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
             !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
-            setDirtyBlockIndex.insert(pindex);
+            SetDirtyBlockIndex(pindex);
         }
         return error("%s: %s", __func__, FormatStateMessage(state));
     }
 
-    //#TODO: Need to move this to a separate method or divide to smaller checks
-    if (block.IsProofOfStake())
-    {
-        const auto &stakeTransaction = block.vtx[1];
-
-        for (const auto &transaction : block.vtx)
-        {
-            if(transaction->IsCoinStake())
-                continue; //skip coinstake transaction
-
-            // Check if coinstake input is double spent inside the same block
-            for (const auto& in: transaction->vin)
-                for (const auto &stakeIn : stakeTransaction->vin)
-                    if(stakeIn.prevout == in.prevout)
-                        return error("%s: double spent coinstake input inside block", __func__);
-        }
-
-        bool isBlockFromFork = pindex && chainActive.Tip() != pindex;
-        int splitHeight = -1;
-
-        if (isBlockFromFork)
-        {
-            auto previousIndex = pindex->pprev;
-            int nofReadBlocks{0};
-            CBlock blockFromDisk;
-
-            do
-            {
-                if(nofReadBlocks == MAX_REORGANIZATION_DEPTH)
-                    return error("%s: forked chain longer than maximum reorg limit", __func__); // TODO: Remove this chain from disk.
-
-                if(!ReadBlockFromDisk(blockFromDisk, previousIndex, chainparams.GetConsensus()))
-                    return error("%s: previous block %s not on disk", __func__, previousIndex->GetBlockHash().GetHex());
-
-                ++nofReadBlocks;
-
-                for(const auto &transaction : blockFromDisk.vtx)
-                    for (const auto &in : transaction->vin)
-                        for (const auto &stakeIn : stakeTransaction->vin)
-                            if (stakeIn.prevout == in.prevout)
-                                return state.DoS(100, error("%s: input already spent on a previous block", __func__));
-
-                previousIndex = previousIndex->pprev;
-            }
-            while(!chainActive.Contains(previousIndex));
-
-            splitHeight = previousIndex->nHeight;
-        }
-
-        const auto& coins = pcoinsTip;
-
-        for (const auto& stakeIn: stakeTransaction->vin)
-        {
-            if(!coins->HaveCoin(stakeIn.prevout))
-            {
-                /* Get the height of the spent and validate it with the forked height
-                   Check if this occurred before the chain split */
-                auto  coin = coins->AccessCoin(stakeIn.prevout);
-                if(!(isBlockFromFork && coin.nHeight > splitHeight))
-                    return error("%s: coin stake inputs already spent in main chain", __func__);
-            }
-        }
-    }
+    if (!CheckCoinStakeInputs(block, pindex, state, chainparams.GetConsensus()))
+        return false;
 
-    AcceptProofOfStakeBlock(block, pindex);
+    // The lottery winners of the block are built on those of its parent
+    if (!AcceptProofOfStakeBlock(block, pindex))
+        return AbortNode(state, "Failed to read the lottery winners of a block");
+    // a block extending the tip gets its spends from the coins view, unless it
+    // ends up on a side branch and has them read back then
+    if (chainActive.Tip() != pindex->pprev)
+        SetBlockSpends(pindex, MakeBlockSpends(block));
 
     // Header is valid/has work, merkle tree and segwit merkle tree are good...RELAY NOW
     // (but if it does not build on our best tip, let the SendMessages loop relay it)
@@ -4011,6 +4173,8 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
 
         // CheckBlock() does not support multi-threaded block validation because CBlock::fChecked can cause data race.
         // Therefore, the following critical section must include the CheckBlock() call as well.
+        // Blocks received from peers were checked by the pre-validation threads already,
+        // which hand them over under their own lock, and pass here on fChecked.
         LOCK(cs_main);
 
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
@@ -4035,6 +4199,8 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         return error("%s: ActivateBestChain failed (%s)", __func__, FormatStateMessage(state));
 
     if (masternodeSync.RequestedMasternodeAssets > MASTERNODE_SYNC_LIST) {
+        // payment votes for nHeight + 10 are ranked 100 blocks back, score them all at once
+        mnodeman.CacheScores(nHeight + 10 - 100);
         masternodePayments.ProcessBlock(nHeight + 10, *g_connman);
     }
 
@@ -4097,7 +4263,7 @@ void PruneOneBlockFile(const int fileNumber)
             pindex->nFile = 0;
             pindex->nDataPos = 0;
             pindex->nUndoPos = 0;
-            setDirtyBlockIndex.insert(pindex);
+            SetDirtyBlockIndex(pindex);
 
             // Prune from mapBlocksUnlinked -- any block we prune would have
             // to be downloaded again in order to consider its chain, at which
@@ -4302,8 +4468,10 @@ CBlockIndex * CChainState::InsertBlockIndex(const uint256& hash)
 
 bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlockTreeDB& blocktree)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
+    const int64_t nTimeStart = GetTimeMicros();
+    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }, fCheckBlockIndex))
         return false;
+    const int64_t nTimeLoaded = GetTimeMicros();
 
     // Calculate nChainWork
     std::vector<std::pair<int, CBlockIndex*> > vSortedByHeight;
@@ -4335,7 +4503,7 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
         }
         if (!(pindex->nStatus & BLOCK_FAILED_MASK) && pindex->pprev && (pindex->pprev->nStatus & BLOCK_FAILED_MASK)) {
             pindex->nStatus |= BLOCK_FAILED_CHILD;
-            setDirtyBlockIndex.insert(pindex);
+            SetDirtyBlockIndex(pindex);
         }
         if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS) && (pindex->HaveTxsDownloaded() || pindex->pprev == nullptr))
             setBlockIndexCandidates.insert(pindex);
@@ -4347,6 +4515,10 @@ bool CChainState::LoadBlockIndex(const Consensus::Params& consensus_params, CBlo
             pindexBestHeader = pindex;
     }
 
+    const int64_t nTimeEnd = GetTimeMicros();
+    LogPrint(BCLog::BENCH, "  - Load block index: %.2fms (entries %.2fms, chain work %.2fms)\n",
+             MILLI * (nTimeEnd - nTimeStart), MILLI * (nTimeLoaded - nTimeStart), MILLI * (nTimeEnd - nTimeLoaded));
+
     return true;
 }
 
@@ -4395,10 +4567,6 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
-    // Check whether we have an address index
-    pblocktree->ReadFlag("addressindex", fAddressIndex);
-    LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
-
     // Check whether we need to continue reindexing
     bool fReindexing = false;
     pblocktree->ReadReindexing(fReindexing);
@@ -4705,7 +4873,7 @@ bool CChainState::RewindBlockIndex(const CChainParams& params)
             pindexIter->nChainTx = 0;
             pindexIter->nSequenceId = 0;
             // Make sure it gets written.
-            setDirtyBlockIndex.insert(pindexIter);
+            SetDirtyBlockIndex(pindexIter);
             // Update indexes
             setBlockIndexCandidates.erase(pindexIter);
             std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> ret = mapBlocksUnlinked.equal_range(pindexIter->pprev);
@@ -4771,7 +4939,12 @@ void UnloadBlockIndex()
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
+    mapDirtyBlockRecords.clear();
     setDirtyFileInfo.clear();
+    mapLotteryWinners.clear();
+    setLotteryWinnersByHeight.clear();
+    mapBlockSpends.clear();
+    setBlockSpendsByHeight.clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
         warningcache[b].clear();
@@ -4786,19 +4959,6 @@ void UnloadBlockIndex()
     g_chainstate.UnloadBlockIndex();
 }
 
-void InitAddressIndex()
-{
-    LOCK(cs_main);
-
-    // Check whether we're already initialized
-    if (chainActive.Genesis())
-        return;
-
-    // Use the provided setting for -addressindex in the new database
-    fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
-    pblocktree->WriteFlag("addressindex", fAddressIndex);
-}
-
 bool LoadBlockIndex(const CChainParams& chainparams)
 {
     // Load block index from databases
@@ -4838,7 +4998,8 @@ bool CChainState::LoadGenesisBlock(const CChainParams& chainparams)
         if (blockPos.IsNull())
             return error("%s: writing genesis block to disk failed", __func__);
         CBlockIndex *pindex = AddToBlockIndex(block);
-        AcceptProofOfStakeBlock(block, pindex);
+        if (!AcceptProofOfStakeBlock(block, pindex))
+            return error("%s: failed to set the lottery winners of the genesis block", __func__);
         ReceivedBlockTransactions(block, pindex, blockPos, chainparams.GetConsensus());
     } catch (const std::runtime_error& e) {
         return error("%s: failed to write genesis block: %s", __func__, e.what());
@@ -5358,17 +5519,6 @@ std::string CBlockRewards::ToString() const
                      FormatMoney(nCharityReward), FormatMoney(nLotteryReward), FormatMoney(nProposalsReward));
 }
 
-bool GetAddressUnspent(uint160 addressHash, int type, std::vector<AddressUnspent> &unspentOutputs)
-{
-    if (!fAddressIndex)
-        return error("address index not enabled");
-
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
-        return error("unable to get txids for address");
-
-    return true;
-}
-
 bool ShouldCheckForMinStakeAmount(int chainHeight, const Consensus::Params &params)
 {
     return chainHeight > std::max(10000, params.nSegwitHeight); // start enforcing after block 10k
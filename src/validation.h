@@ -17,7 +17,6 @@
 #include <protocol.h> // For CMessageHeader::MessageStartChars
 #include <policy/feerate.h>
 #include <script/script_error.h>
-#include <spentindex.h>
 #include <sync.h>
 #include <versionbits.h>
 
@@ -37,6 +36,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CBlockUndo;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
@@ -123,6 +123,7 @@ static const bool DEFAULT_PERMIT_BAREMULTISIG = true;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
+static const bool DEFAULT_SPENTINDEX = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
 static const bool DEFAULT_PERSIST_MEMPOOL = true;
@@ -138,6 +139,8 @@ static const unsigned int MAX_BLOCKS_TO_ANNOUNCE = 8;
 static const int MAX_UNCONNECTING_HEADERS = 10;
 
 static const bool DEFAULT_PEERBLOOMFILTERS = true;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
+static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
@@ -281,8 +284,6 @@ fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = nullptr);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
-/** Initialize a new block tree database + block data on disk */
-void InitAddressIndex();
 /** Load the block tree and coins database from disk,
  * initializing state if we're running with -reindex. */
 bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -327,6 +328,23 @@ struct CBlockRewards {
 
 CBlockRewards GetBlockSubsidity(int nHeight, const Consensus::Params &consensus);
 
+/** A coinbase or coinstake in the running lottery, with the script its prize is paid to */
+struct CLotteryWinner
+{
+    uint256 hashCoinstake;
+    CScript scriptPayout;
+
+    friend bool operator==(const CLotteryWinner& a, const CLotteryWinner& b)
+    {
+        return a.hashCoinstake == b.hashCoinstake && a.scriptPayout == b.scriptPayout;
+    }
+};
+
+/** Lottery winners recorded at pindex, best first, nullptr if they could not be read back */
+std::shared_ptr<const std::vector<CLotteryWinner>> GetLotteryWinners(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Number of block index entries the lottery winners are kept in memory for */
+size_t GetLotteryWinnersCacheSize();
+
 /** Guess verification progress (as a fraction between 0.0=genesis and 1.0=current tip). */
 double GuessVerificationProgress(const ChainTxData& data, const CBlockIndex* pindex);
 
@@ -443,9 +461,6 @@ public:
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
-bool GetAddressUnspent(uint160 addressHash, int type,
-                       std::vector<AddressUnspent> &unspentOutputs);
-
 void ReprocessBlocks(int nBlocks);
 
 /** Functions for disk access for blocks */
@@ -454,6 +469,8 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
+
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
@@ -462,6 +479,9 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams, const CBlock& block, CBlockIndex* pindexPrev, bool fCheckPOW = true, bool fCheckMerkleRoot = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Check the coinstake of a proof-of-stake block, whose index entry is pindex, spends no input spent on the chain it extends */
+bool CheckCoinStakeInputs(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Check whether witness commitments are required for block. */
 bool IsWitnessEnabled(int nHeight, const Consensus::Params& params);
 
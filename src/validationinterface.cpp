@@ -5,8 +5,11 @@
 
 #include <validationinterface.h>
 
+#include <masternodes/masternode.h>
+#include <masternodes/masternode-payments.h>
 #include <primitives/block.h>
 #include <scheduler.h>
+#include <spork.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <validation.h>
@@ -27,6 +30,10 @@ struct ValidationInterfaceConnections {
     boost::signals2::scoped_connection Broadcast;
     boost::signals2::scoped_connection BlockChecked;
     boost::signals2::scoped_connection NewPoWValidBlock;
+    boost::signals2::scoped_connection BlockFound;
+    boost::signals2::scoped_connection MasternodeChanged;
+    boost::signals2::scoped_connection MasternodePaymentVote;
+    boost::signals2::scoped_connection SporkUpdated;
 };
 
 struct MainSignalsInstance {
@@ -39,6 +46,10 @@ struct MainSignalsInstance {
     boost::signals2::signal<void (int64_t nBestBlockTime, CConnman* connman)> Broadcast;
     boost::signals2::signal<void (const CBlock&, const CValidationState&)> BlockChecked;
     boost::signals2::signal<void (const CBlockIndex *, const std::shared_ptr<const CBlock>&)> NewPoWValidBlock;
+    boost::signals2::signal<void (const std::shared_ptr<const CBlock> &)> BlockFound;
+    boost::signals2::signal<void (const CMasternode &, MasternodeChange)> MasternodeChanged;
+    boost::signals2::signal<void (const CMasternodePaymentWinner &)> MasternodePaymentVote;
+    boost::signals2::signal<void (const CSporkMessage &)> SporkUpdated;
 
     // We are not allowed to assume the scheduler only runs in one thread,
     // but must ensure all callbacks happen in-order, so we end up creating
@@ -100,6 +111,10 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
     conns.Broadcast = g_signals.m_internals->Broadcast.connect(std::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, std::placeholders::_1, std::placeholders::_2));
     conns.BlockChecked = g_signals.m_internals->BlockChecked.connect(std::bind(&CValidationInterface::BlockChecked, pwalletIn, std::placeholders::_1, std::placeholders::_2));
     conns.NewPoWValidBlock = g_signals.m_internals->NewPoWValidBlock.connect(std::bind(&CValidationInterface::NewPoWValidBlock, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.BlockFound = g_signals.m_internals->BlockFound.connect(std::bind(&CValidationInterface::BlockFound, pwalletIn, std::placeholders::_1));
+    conns.MasternodeChanged = g_signals.m_internals->MasternodeChanged.connect(std::bind(&CValidationInterface::MasternodeChanged, pwalletIn, std::placeholders::_1, std::placeholders::_2));
+    conns.MasternodePaymentVote = g_signals.m_internals->MasternodePaymentVote.connect(std::bind(&CValidationInterface::MasternodePaymentVote, pwalletIn, std::placeholders::_1));
+    conns.SporkUpdated = g_signals.m_internals->SporkUpdated.connect(std::bind(&CValidationInterface::SporkUpdated, pwalletIn, std::placeholders::_1));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
@@ -180,3 +195,33 @@ void CMainSignals::BlockChecked(const CBlock& block, const CValidationState& sta
 void CMainSignals::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &block) {
     m_internals->NewPoWValidBlock(pindex, block);
 }
+
+void CMainSignals::BlockFound(const std::shared_ptr<const CBlock> &pblock) {
+    m_internals->m_schedulerClient.AddToProcessQueue([pblock, this] {
+        m_internals->BlockFound(pblock);
+    });
+}
+
+// The masternode and spork managers also run without the background scheduler,
+// as when loading or in tests, so their events are dropped until it is registered.
+
+void CMainSignals::MasternodeChanged(const CMasternode &mn, MasternodeChange change) {
+    if (!m_internals) return;
+    m_internals->m_schedulerClient.AddToProcessQueue([mn, change, this] {
+        m_internals->MasternodeChanged(mn, change);
+    });
+}
+
+void CMainSignals::MasternodePaymentVote(const CMasternodePaymentWinner &winner) {
+    if (!m_internals) return;
+    m_internals->m_schedulerClient.AddToProcessQueue([winner, this] {
+        m_internals->MasternodePaymentVote(winner);
+    });
+}
+
+void CMainSignals::SporkUpdated(const CSporkMessage &spork) {
+    if (!m_internals) return;
+    m_internals->m_schedulerClient.AddToProcessQueue([spork, this] {
+        m_internals->SporkUpdated(spork);
+    });
+}
@@ -24,7 +24,11 @@ class CValidationState;
 class uint256;
 class CScheduler;
 class CTxMemPool;
+class CMasternode;
+class CMasternodePaymentWinner;
+class CSporkMessage;
 enum class MemPoolRemovalReason;
+enum class MasternodeChange;
 
 // These functions dispatch to one or all registered wallets
 
@@ -147,6 +151,32 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
+    /**
+     * Notifies listeners of a block found by this node's miner or staker,
+     * once it was accepted.
+     *
+     * Called on a background thread.
+     */
+    virtual void BlockFound(const std::shared_ptr<const CBlock> &block) {}
+    /**
+     * Notifies listeners of a masternode added to the list, updated from a new
+     * broadcast or a change of its state, or removed from the list.
+     *
+     * Called on a background thread.
+     */
+    virtual void MasternodeChanged(const CMasternode &mn, MasternodeChange change) {}
+    /**
+     * Notifies listeners of a new masternode payment winner vote.
+     *
+     * Called on a background thread.
+     */
+    virtual void MasternodePaymentVote(const CMasternodePaymentWinner &winner) {}
+    /**
+     * Notifies listeners of a spork message that was accepted as active.
+     *
+     * Called on a background thread.
+     */
+    virtual void SporkUpdated(const CSporkMessage &spork) {}
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
@@ -187,6 +217,10 @@ public:
     void Broadcast(int64_t nBestBlockTime, CConnman* connman);
     void BlockChecked(const CBlock&, const CValidationState&);
     void NewPoWValidBlock(const CBlockIndex *, const std::shared_ptr<const CBlock>&);
+    void BlockFound(const std::shared_ptr<const CBlock> &);
+    void MasternodeChanged(const CMasternode &, MasternodeChange);
+    void MasternodePaymentVote(const CMasternodePaymentWinner &);
+    void SporkUpdated(const CSporkMessage &);
 };
 
 CMainSignals& GetMainSignals();
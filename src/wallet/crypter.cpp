@@ -183,6 +183,7 @@ bool CCryptoKeyStore::Lock(bool fAllowMixing)
     if(!fAllowMixing) {
         LOCK(cs_KeyStore);
         vMasterKey.clear();
+        mapHDChangeKeys.clear();
     }
 
     fOnlyMixingAllowed = fAllowMixing;
@@ -235,6 +236,7 @@ bool CCryptoKeyStore::Unlock(const CKeyingMaterial& vMasterKeyIn)
             }
             if (!chainPass) {
                 vMasterKey.clear();
+                mapHDChangeKeys.clear();
                 return false;
             }
         }
@@ -385,6 +387,37 @@ bool CCryptoKeyStore::DecryptHDChain(CHDChain& hdChainRet) const
     return true;
 }
 
+bool CCryptoKeyStore::GetHDChangeKey(uint32_t nAccountIndex, bool fInternal, CExtKey& extKeyRet) const
+{
+    LOCK(cs_KeyStore);
+    auto it = mapHDChangeKeys.find(std::make_pair(nAccountIndex, fInternal));
+    if (it == mapHDChangeKeys.end()) {
+        CHDChain hdChainTmp;
+        if (!GetHDChain(hdChainTmp) || !DecryptHDChain(hdChainTmp))
+            return false;
+        // make sure seed matches this chain
+        if (hdChainTmp.GetID() != hdChainTmp.GetSeedHash())
+            return false;
+
+        CExtKey changeKey;
+        hdChainTmp.DeriveChangeExtKey(nAccountIndex, fInternal, changeKey);
+        it = mapHDChangeKeys.emplace(std::make_pair(nAccountIndex, fInternal), changeKey).first;
+    }
+    extKeyRet = it->second;
+    return true;
+}
+
+bool CCryptoKeyStore::DeriveHDChildKey(uint32_t nAccountIndex, bool fInternal, uint32_t nChildIndex, CExtKey& extKeyRet) const
+{
+    LOCK(cs_KeyStore);
+    auto it = mapHDChangeKeys.find(std::make_pair(nAccountIndex, fInternal));
+    if (it != mapHDChangeKeys.end())
+        return it->second.Derive(extKeyRet, nChildIndex);
+
+    CExtKey changeKey;
+    return GetHDChangeKey(nAccountIndex, fInternal, changeKey) && changeKey.Derive(extKeyRet, nChildIndex);
+}
+
 bool CCryptoKeyStore::CCryptoKeyStore::SetHDChain(const CHDChain &chain)
 {
     if (IsCrypted())
@@ -393,6 +426,8 @@ bool CCryptoKeyStore::CCryptoKeyStore::SetHDChain(const CHDChain &chain)
     if (chain.IsCrypted())
         return false;
 
+    LOCK(cs_KeyStore);
+    mapHDChangeKeys.clear();
     hdChain = chain;
     return true;
 }
@@ -405,6 +440,8 @@ bool CCryptoKeyStore::CCryptoKeyStore::SetCryptedHDChain(const CHDChain &chain)
     if (!chain.IsCrypted())
         return false;
 
+    LOCK(cs_KeyStore);
+    mapHDChangeKeys.clear();
     cryptedHDChain = chain;
     return true;
 }
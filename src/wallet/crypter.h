@@ -70,6 +70,7 @@ typedef std::vector<unsigned char, secure_allocator<unsigned char> > CKeyingMate
 namespace wallet_crypto_tests
 {
     class TestCrypter;
+    class TestCryptoKeyStore;
 }
 
 /** Encryption/decryption context with key information */
@@ -114,12 +115,21 @@ public:
  */
 class CCryptoKeyStore : public CBasicKeyStore
 {
+friend class wallet_crypto_tests::TestCryptoKeyStore; // for test access to mapHDChangeKeys
+protected:
+    //! HD change level extended keys by (account, internal), allocated in locked memory
+    using HDChangeKeyMap = std::map<std::pair<uint32_t, bool>, CExtKey, std::less<std::pair<uint32_t, bool>>,
+                                    secure_allocator<std::pair<const std::pair<uint32_t, bool>, CExtKey>>>;
+
 private:
 
     CKeyingMaterial vMasterKey GUARDED_BY(cs_KeyStore);
 
     CHDChain cryptedHDChain GUARDED_BY(cs_KeyStore);
 
+    //! Change level keys of the HD chain, only kept while the master key is, wiped on Lock()
+    mutable HDChangeKeyMap mapHDChangeKeys GUARDED_BY(cs_KeyStore);
+
     //! if fUseCrypto is true, mapKeys must be empty
     //! if fUseCrypto is false, vMasterKey must be empty
     std::atomic<bool> fUseCrypto;
@@ -143,6 +153,10 @@ protected:
 
     bool EncryptHDChain(const CKeyingMaterial& vMasterKeyIn);
     bool DecryptHDChain(CHDChain& hdChainRet) const;
+    //! HD key at m/purpose'/coin_type'/account'/change, derived from the seed on first use
+    bool GetHDChangeKey(uint32_t nAccountIndex, bool fInternal, CExtKey& extKeyRet) const;
+    //! HD key at m/purpose'/coin_type'/account'/change/nChildIndex, deriving only the last level once the change key is cached
+    bool DeriveHDChildKey(uint32_t nAccountIndex, bool fInternal, uint32_t nChildIndex, CExtKey& extKeyRet) const;
     bool SetHDChain(const CHDChain& chain);
     bool SetCryptedHDChain(const CHDChain& chain);
 
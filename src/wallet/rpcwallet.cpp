@@ -4184,6 +4184,35 @@ UniValue importmulti(const JSONRPCRequest& request);
 UniValue dumphdinfo(const JSONRPCRequest& request);
 UniValue getstakingstatus(const JSONRPCRequest& request);
 
+static CHDIntegrityResult CheckHDIntegrity(CWallet* const pwallet)
+{
+    if (!pwallet->IsHDEnabled())
+        throw JSONRPCError(RPC_WALLET_ERROR, "HD wallet is disabled, checking integrity works only with HD wallets");
+    EnsureWalletIsUnlocked(pwallet);
+    if (pwallet->IsCheckingHDIntegrity())
+        throw JSONRPCError(RPC_WALLET_ERROR, "Wallet is currently checking its integrity. Use abortwalletverify to stop it.");
+
+    // The checks above are only a snapshot, another check or a wallet lock may come in between
+    CHDIntegrityResult result;
+    std::string strFailReason;
+    if (!pwallet->CheckHDIntegrity(result, strFailReason))
+        throw JSONRPCError(RPC_WALLET_ERROR, strFailReason);
+    return result;
+}
+
+static UniValue HDIntegrityAccountsToJSON(const CHDIntegrityResult& check)
+{
+    UniValue accounts(UniValue::VARR);
+    for (const auto& entry : check.mapAccounts) {
+        UniValue account(UniValue::VOBJ);
+        account.pushKV("account", (int64_t)entry.first);
+        account.pushKV("keys", (uint64_t)entry.second.nKeys);
+        account.pushKV("lost_keys", (uint64_t)entry.second.nLostKeys);
+        accounts.push_back(account);
+    }
+    return accounts;
+}
+
 static UniValue recoverwallet(const JSONRPCRequest& request)
 {
     std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
@@ -4193,26 +4222,14 @@ static UniValue recoverwallet(const JSONRPCRequest& request)
         return NullUniValue;
     }
 
-    UniValue result(UniValue::VOBJ);
+    CHDIntegrityResult check = CheckHDIntegrity(pwallet);
 
-    int lostKeys = 0;
-    int availableKeys = 0;
-    for(auto &&entry : pwallet->mapHdPubKeys) {
-        CKey key;
-        if(!pwallet->GetKey(entry.first, key))
-            continue;
-
-        if(key.VerifyPubKey(entry.second.extPubKey.pubkey)) {
-            ++availableKeys;
-        }
-        else {
-            ++lostKeys;
-        }
-    }
-
-    result.pushKV("Total keys", lostKeys + availableKeys);
-    result.pushKV("Available keys", availableKeys);
-    result.pushKV("Lost keys", lostKeys);
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("Total keys", (uint64_t)check.nKeys);
+    result.pushKV("Available keys", (uint64_t)(check.nKeys - check.nLostKeys));
+    result.pushKV("Lost keys", (uint64_t)check.nLostKeys);
+    result.pushKV("accounts", HDIntegrityAccountsToJSON(check));
+    result.pushKV("aborted", check.fAborted);
 
     CHDChain hdchain;
     pwallet->GetHDChain(hdchain);
@@ -4223,13 +4240,30 @@ static UniValue recoverwallet(const JSONRPCRequest& request)
 
 static UniValue walletverify(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw std::runtime_error(
-                "walletverify\n"
-                "\nChecks wallet integrity, if this returns true, you can be sure that all funds are accesible\n");
-
-    if (request.fHelp)
-        return true;
+                "walletverify ( verbose )\n"
+                "\nChecks wallet integrity, if this returns true, you can be sure that all funds are accesible\n"
+                "The keys are checked on all cores, abortwalletverify stops a running check.\n"
+                "\nArguments:\n"
+                "1. verbose       (boolean, optional, default=false) Return the keys checked per HD account\n"
+                "\nResult (verbose=false):\n"
+                "true|false       (boolean) Whether every HD key was derived and matches its public key\n"
+                "\nResult (verbose=true):\n"
+                "{\n"
+                "  \"valid\": true|false,   (boolean) Whether every HD key was derived and matches its public key\n"
+                "  \"aborted\": true|false, (boolean) Whether abortwalletverify stopped the check\n"
+                "  \"accounts\": [          (array) The checked keys of every HD account\n"
+                "    {\n"
+                "      \"account\": n,      (numeric) The HD account index\n"
+                "      \"keys\": n,         (numeric) The number of keys checked\n"
+                "      \"lost_keys\": n     (numeric) The number of keys that do not match their public key\n"
+                "    }\n"
+                "  ]\n"
+                "}\n"
+                "\nExamples:\n"
+                + HelpExampleCli("walletverify", "true")
+                + HelpExampleRpc("walletverify", "true"));
 
     std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
     CWallet* const pwallet = wallet.get();
@@ -4238,21 +4272,38 @@ static UniValue walletverify(const JSONRPCRequest& request)
         return NullUniValue;
     }
 
+    bool fVerbose = !request.params[0].isNull() && request.params[0].get_bool();
 
-    if(!pwallet->IsHDEnabled())
-        throw std::runtime_error("HD wallet is disabled, checking integrity works only with HD wallets");
+    CHDIntegrityResult check = CheckHDIntegrity(pwallet);
+    bool fValid = !check.fAborted && check.nLostKeys == 0;
+    if (!fVerbose)
+        return fValid;
 
-    for(auto &&entry : pwallet->mapHdPubKeys) {
-        CKey derivedKey;
-        if(!pwallet->GetKey(entry.first, derivedKey)) {
-            return false;
-        }
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("valid", fValid);
+    result.pushKV("aborted", check.fAborted);
+    result.pushKV("accounts", HDIntegrityAccountsToJSON(check));
+    return result;
+}
 
-        if(!derivedKey.VerifyPubKey(entry.second.extPubKey.pubkey)) {
-            return false;
-        }
+static UniValue abortwalletverify(const JSONRPCRequest& request)
+{
+    std::shared_ptr<CWallet> const wallet = GetWalletForJSONRPCRequest(request);
+    CWallet* const pwallet = wallet.get();
+    if (!EnsureWalletIsAvailable(pwallet, request.fHelp)) {
+        return NullUniValue;
     }
 
+    if (request.fHelp || request.params.size() > 0)
+        throw std::runtime_error(
+            "abortwalletverify\n"
+            "\nStops a running walletverify or recoverwallet integrity check.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("abortwalletverify", "")
+            + HelpExampleRpc("abortwalletverify", ""));
+
+    if (!pwallet->IsCheckingHDIntegrity()) return false;
+    pwallet->AbortHDIntegrityCheck();
     return true;
 }
 
@@ -4318,7 +4369,8 @@ static const CRPCCommand commands[] =
     { "wallet",             "walletpassphrase",                 &walletpassphrase,              {"passphrase","timeout"} },
     { "wallet",             "walletpassphrasechange",           &walletpassphrasechange,        {"oldpassphrase","newpassphrase"} },
     { "wallet",             "walletprocesspsbt",                &walletprocesspsbt,             {"psbt","sign","sighashtype","bip32derivs"} },
-    { "wallet",             "walletverify",                     &walletverify,                  {} },
+    { "wallet",             "walletverify",                     &walletverify,                  {"verbose"} },
+    { "wallet",             "abortwalletverify",                &abortwalletverify,             {} },
     { "wallet",             "recoverwallet",                    &recoverwallet,                 {} },
     { "wallet",             "getstakingstatus",                 &getstakingstatus,              {} },
 };
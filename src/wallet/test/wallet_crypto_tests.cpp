@@ -123,4 +123,54 @@ BOOST_AUTO_TEST_CASE(decrypt) {
     }
 }
 
+class TestCryptoKeyStore : public CCryptoKeyStore
+{
+public:
+    using CCryptoKeyStore::DeriveHDChildKey;
+    using CCryptoKeyStore::EncryptHDChain;
+    using CCryptoKeyStore::EncryptKeys;
+    using CCryptoKeyStore::GetHDChangeKey;
+    using CCryptoKeyStore::SetHDChain;
+    using CCryptoKeyStore::Unlock;
+
+    size_t HDChangeKeysCached() const
+    {
+        LOCK(cs_KeyStore);
+        return mapHDChangeKeys.size();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(lock_wipes_hd_change_keys) {
+    TestCryptoKeyStore keystore;
+    CHDChain chain;
+    uint256 seed = GetRandHash();
+    BOOST_REQUIRE(chain.SetSeed(SecureVector(seed.begin(), seed.end()), true));
+    BOOST_REQUIRE(keystore.SetHDChain(chain));
+
+    uint256 masterKey = GetRandHash();
+    CKeyingMaterial vMasterKey(masterKey.begin(), masterKey.end());
+    BOOST_REQUIRE(keystore.EncryptKeys(vMasterKey));
+    BOOST_REQUIRE(keystore.EncryptHDChain(vMasterKey));
+    BOOST_REQUIRE(keystore.Unlock(vMasterKey));
+
+    // the change level keys are kept while the wallet is unlocked
+    CExtKey changeKey, childKey;
+    BOOST_CHECK(keystore.GetHDChangeKey(0, false, changeKey));
+    BOOST_CHECK(keystore.DeriveHDChildKey(0, true, 5, childKey));
+    BOOST_CHECK_EQUAL(keystore.HDChangeKeysCached(), 2U);
+
+    // and wiped with the master key
+    BOOST_REQUIRE(keystore.Lock());
+    BOOST_CHECK_EQUAL(keystore.HDChangeKeysCached(), 0U);
+    CExtKey lockedKey;
+    BOOST_CHECK(!keystore.DeriveHDChildKey(0, true, 5, lockedKey));
+    BOOST_CHECK_EQUAL(keystore.HDChangeKeysCached(), 0U);
+
+    // unlocking derives the same keys again
+    BOOST_REQUIRE(keystore.Unlock(vMasterKey));
+    CExtKey childKeyAgain;
+    BOOST_CHECK(keystore.DeriveHDChildKey(0, true, 5, childKeyAgain));
+    BOOST_CHECK(childKeyAgain == childKey);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
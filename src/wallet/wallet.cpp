@@ -28,8 +28,10 @@
 #include <timedata.h>
 #include <txmempool.h>
 #include <util/moneystr.h>
+#include <util/parallel.h>
 #include <wallet/fees.h>
 #include <consensus/kernel.h>
+#include <kernelscanner.h>
 #include <masternodes/masternode-payments.h>
 
 #include <algorithm>
@@ -158,17 +160,9 @@ bool CWallet::GetKey(const CKeyID &address, CKey& keyOut) const
     {
         // if the key has been found in mapHdPubKeys, derive it on the fly
         const CHDPubKey &hdPubKey = (*mi).second;
-        CHDChain hdChainCurrent;
-        if (!GetHDChain(hdChainCurrent))
-            throw std::runtime_error(std::string(__func__) + ": GetHDChain failed");
-        if (!DecryptHDChain(hdChainCurrent))
-            throw std::runtime_error(std::string(__func__) + ": DecryptHDChainSeed failed");
-        // make sure seed matches this chain
-        if (hdChainCurrent.GetID() != hdChainCurrent.GetSeedHash())
-            throw std::runtime_error(std::string(__func__) + ": Wrong HD chain!");
-
         CExtKey extkey;
-        hdChainCurrent.DeriveChildExtKey(hdPubKey.nAccountIndex, hdPubKey.nChangeIndex != 0, hdPubKey.extPubKey.nChild, extkey);
+        if (!DeriveHDChildKey(hdPubKey.nAccountIndex, hdPubKey.nChangeIndex != 0, hdPubKey.extPubKey.nChild, extkey))
+            throw std::runtime_error(std::string(__func__) + ": DeriveHDChildKey failed");
         keyOut = extkey.key;
 
         return true;
@@ -271,7 +265,8 @@ void CWallet::DeriveNewChildKey(WalletBatch &batch, CKeyMetadata& metadata, CKey
     CExtKey childKey;
     uint32_t nChildIndex = fInternal ? acc.nInternalChainCounter : acc.nExternalChainCounter;
     do {
-        hdChainTmp.DeriveChildExtKey(nAccountIndex, fInternal, nChildIndex, childKey);
+        if (!DeriveHDChildKey(nAccountIndex, fInternal, nChildIndex, childKey))
+            throw std::runtime_error(std::string(__func__) + ": DeriveHDChildKey failed");
         // increment childkey index
         nChildIndex++;
     } while (HaveKey(childKey.key.GetPubKey().GetID()));
@@ -443,58 +438,6 @@ CAmount GetStakeReward(CAmount blockReward, unsigned int percentage)
     return (blockReward / 100) * percentage;
 }
 
-bool CWallet::CreateCoinStakeKernel(CBlockIndex *prevIndex,
-                                    CScript &kernelScript,
-                                    const CScript &stakeScript,
-                                    unsigned int nBits,
-                                    unsigned int nExpectedBlockHeight,
-                                    const CBlock &blockFrom,
-                                    const CTransactionRef &txPrev,
-                                    const COutPoint &prevout, unsigned int &nTimeTx,
-                                    bool fGenerateSegwit, bool fPrintProofOfStake) const
-{
-    unsigned int nTryTime = 0;
-    uint256 hashProofOfStake;
-
-    if (blockFrom.GetBlockTime() + nStakeMinAge + nHashDrift > nTimeTx) // Min age requirement
-        return false;
-
-    CTxDestination dest;
-    if(!ExtractDestination(stakeScript, dest))
-        return false;
-
-    // this will return true only if it's P2SH_SEGWIT, SEGWIT, P2PKH(LEGACY)
-    if(GetKeyForDestination(*this, dest).IsNull())
-    {
-        return error("CreateCoinStakeKernel : no support for kernel %s\n", EncodeDestination(dest));
-    }
-
-    if(!fGenerateSegwit && !boost::get<CKeyID>(&dest))
-    {
-        return false;
-    }
-
-    if (CheckStakeKernelHash(prevIndex, nBits, blockFrom, *txPrev, prevout, nExpectedBlockHeight, nTimeTx, nHashDrift, false, hashProofOfStake, fPrintProofOfStake))
-    {
-        //Double check that this will pass time requirements
-        if (nTryTime <= chainActive.Tip()->GetMedianTimePast()) {
-            LogPrintf("CreateCoinStakeKernel() : kernel found, but it is too far in the past \n");
-        }
-
-        // Found a kernel
-        if (gArgs.GetBoolArg("-printcoinstake", false))
-            LogPrintf("CreateCoinStakeKernel : kernel found\n");
-
-        kernelScript.clear();
-
-        kernelScript = stakeScript;
-
-        return true;
-    }
-
-    return false;
-}
-
 void CWallet::FillCoinStakePayments(const StakeCoinsSet &setStakeCoins,
                                     std::vector<const CWalletTx*> &vwtxPrev,
                                     CMutableTransaction &txNew,
@@ -1116,6 +1059,11 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
     // Break debit/credit balance caches:
     wtx.MarkDirty();
 
+    if (fStakeIndexBuilt) {
+        auto locked_chain = chain().assumeLocked();  // Temporary. Removed in upcoming lock cleanup
+        AddToStakeIndex(*locked_chain, wtx);
+    }
+
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
@@ -1391,6 +1339,12 @@ void CWallet::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const
     for (size_t i = 0; i < pblock->vtx.size(); i++) {
         SyncTransaction(pblock->vtx[i], pindex, i);
         TransactionRemovedFromMempool(pblock->vtx[i]);
+
+        // Coins spent in the chain can no longer stake
+        if (fStakeIndexBuilt && !pblock->vtx[i]->IsCoinBase()) {
+            for (const CTxIn& txin : pblock->vtx[i]->vin)
+                mapStakeIndex.erase(txin.prevout);
+        }
     }
 
     m_last_block_processed = pindex;
@@ -1402,6 +1356,15 @@ void CWallet::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) {
 
     for (const CTransactionRef& ptx : pblock->vtx) {
         SyncTransaction(ptx);
+
+        // The coins this block spent can stake again
+        if (fStakeIndexBuilt && !ptx->IsCoinBase()) {
+            for (const CTxIn& txin : ptx->vin) {
+                auto it = mapWallet.find(txin.prevout.hash);
+                if (it != mapWallet.end() && txin.prevout.n < it->second.tx->vout.size())
+                    AddToStakeIndex(*locked_chain, it->second, txin.prevout.n);
+            }
+        }
     }
 }
 
@@ -2594,68 +2557,73 @@ bool CWallet::MintableCoins(interfaces::Chain::Lock& locked_chain)
     return false;
 }
 
-bool CWallet::SelectStakeCoins(interfaces::Chain::Lock& locked_chain,
-                               StakeCoinsSet &allStakeCoins,
-                               StakeCoinsSet &validStakeCoins,
-                               CAmount nTargetAmount,
-                               bool fSelectWitness,
-                               bool fCheckForMinStakeAmount) const
+// Only spends that are in the chain keep a coin out of the stake index, mempool
+// spends are checked when the candidates are selected
+bool CWallet::IsSpentInChain(interfaces::Chain::Lock& locked_chain, const COutPoint& outpoint) const
 {
-    std::vector<COutput> vCoins;
-    {
-        LOCK2(cs_main, cs_wallet);
-        AvailableCoins(locked_chain, vCoins, true);
-    }
-    CAmount nAmountSelected = 0;
-
-    for (const COutput& out : vCoins) {
-        //make sure not to outrun target amount
-        CScript scriptPubKeyKernel;
-        scriptPubKeyKernel = out.tx->tx->vout[out.i].scriptPubKey;
-
-        if(!out.fSpendable)
-            continue;
-
-        CTxDestination dest;
-        if(!ExtractDestination(scriptPubKeyKernel, dest))
-            continue;
-
-        // for staking we support P2PKH, Native Segwit, P2SH Segwit
-        if(!boost::get<CKeyID>(&dest) && !boost::get<WitnessV0KeyHash>(&dest) &&
-                !boost::get<CScriptID>(&dest))
-            continue;
-
-        if(!fSelectWitness && !boost::get<CKeyID>(&dest))
-            continue;
+    AssertLockHeld(cs_wallet);
 
-        //        LogPrintf("scriptPubKeyKernel is good\n");
+    auto range = mapTxSpends.equal_range(outpoint);
+    for (auto it = range.first; it != range.second; ++it) {
+        auto mit = mapWallet.find(it->second);
+        if (mit != mapWallet.end() && mit->second.GetDepthInMainChain(locked_chain) > 0)
+            return true;
+    }
+    return false;
+}
 
-        //for now we will comment this out
-        //        if (nAmountSelected + out.tx->vout[out.i].nValue > nTargetAmount)
-        //            continue;
+void CWallet::AddToStakeIndex(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx, unsigned int i)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-        //        LogPrintf("amount is good\n");
+    const COutPoint outpoint(wtx.GetHash(), i);
+    const CBlockIndex* pindexFrom = wtx.nIndex >= 0 && !wtx.hashUnset() ? LookupBlockIndex(wtx.hashBlock) : nullptr;
+    if (!pindexFrom || IsSpentInChain(locked_chain, outpoint)) {
+        mapStakeIndex.erase(outpoint);
+        return;
+    }
 
-        //check for min age
-        if (GetTime() - out.tx->GetTxTime() < nStakeMinAge)
-            continue;
+    const CTxOut& txout = wtx.tx->vout[i];
+    if (!(IsMine(txout) & ISMINE_SPENDABLE))
+        return;
 
-        //        LogPrintf("min age is good\n");
+    // for staking we support P2PKH, Native Segwit, P2SH Segwit
+    CTxDestination dest;
+    if (!ExtractDestination(txout.scriptPubKey, dest))
+        return;
+    if (!boost::get<CKeyID>(&dest) && !boost::get<WitnessV0KeyHash>(&dest) && !boost::get<CScriptID>(&dest))
+        return;
+    if (GetKeyForDestination(*this, dest).IsNull())
+        return;
 
-        //check that it is matured
-        if (out.nDepth < (out.tx->tx->IsCoinStake() ? COINBASE_MATURITY : 10))
-            continue;
+    CStakeCandidate& candidate = mapStakeIndex[outpoint];
+    candidate.pwtx = &wtx;
+    candidate.i = i;
+    candidate.prevout = outpoint;
+    candidate.nValue = txout.nValue;
+    candidate.nBlockFromTime = pindexFrom->GetBlockTime();
+    candidate.pindexFrom = pindexFrom;
+    candidate.fWitness = !boost::get<CKeyID>(&dest);
+}
 
-        auto outTransactionValue = out.tx->tx->vout[out.i].nValue;
+void CWallet::AddToStakeIndex(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx)
+{
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); i++)
+        AddToStakeIndex(locked_chain, wtx, i);
+}
 
-        nAmountSelected += outTransactionValue;
+void CWallet::BuildStakeIndex(interfaces::Chain::Lock& locked_chain)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
 
-        allStakeCoins.emplace(out.tx, out.i);
+    mapStakeIndex.clear();
+    for (const auto& entry : mapWallet)
+        AddToStakeIndex(locked_chain, entry.second);
 
-        if(!fCheckForMinStakeAmount || outTransactionValue >= MIN_STAKING_AMOUNT * COIN)
-            validStakeCoins.emplace(out.tx, out.i);
-    }
-    return true;
+    fStakeIndexBuilt = true;
+    WalletLogPrintf("%s: %u stake candidates\n", __func__, mapStakeIndex.size());
 }
 
 bool CWallet::SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, const CCoinControl& coin_control, CoinSelectionParams& coin_selection_params, bool& bnb_used) const
@@ -3278,115 +3246,172 @@ bool CWallet::CreateTransaction(interfaces::Chain::Lock& locked_chain, const std
     return true;
 }
 
-bool CWallet::CreateCoinStake(unsigned int nBits,
-                              const CBlockRewards &blockReward,
-                              CMutableTransaction &txNew,
-                              unsigned int &nTxNewTime,
-                              std::vector<const CWalletTx*> &vwtxPrev,
-                              bool fGenerateSegwit)
+bool CWallet::SelectStakeCandidates(const CStakeKernelContext &context,
+                                    bool fGenerateSegwit,
+                                    std::vector<CStakeCandidate> &vCandidates,
+                                    StakeCoinsSet &setCombineCoins)
 {
-    // The following split & combine thresholds are important to security
-    // Should not be adjusted if you don't understand the consequences
-    //int64_t nCombineThreshold = 0;
-    txNew.vin.clear();
-    txNew.vout.clear();
+    AssertLockHeld(cs_main);
+    auto locked_chain = chain().lock();
+    LOCK(cs_wallet);
 
-    // Mark coin stake transaction
-    CScript scriptEmpty;
-    scriptEmpty.clear();
-    txNew.vout.push_back(CTxOut(0, scriptEmpty));
-    // Choose coins to use
-    CAmount nBalance = GetBalance();
+    if (!fStakeIndexBuilt)
+        BuildStakeIndex(*locked_chain);
 
-    //    if (mapArgs.count("-reservebalance") && !ParseMoney(mapArgs["-reservebalance"], nReserveBalance))
-    //        return error("CreateCoinStake : invalid reserve balance amount");
+    const bool fCheckForMinStakeAmount = ShouldCheckForMinStakeAmount(context.pindexPrev->nHeight, Params().GetConsensus());
+    const int64_t nTime = GetTime();
 
-    //    if (nBalance <= nReserveBalance)
-    //        return false;
+    vCandidates.clear();
+    setCombineCoins.clear();
+    for (const auto& entry : mapStakeIndex)
+    {
+        const CStakeCandidate &indexed = entry.second;
+
+        // The block the coin was confirmed in must still be in the chain, which
+        // context.pindexPrev is the tip of while cs_main is held
+        if (!chainActive.Contains(indexed.pindexFrom))
+            continue;
 
-    // presstab HyperStake - Initialize as static and don't update the set on every run of CreateCoinStake() in order to lighten resource use
-    static StakeCoinsSet validStakeCoins;
-    static StakeCoinsSet allStakeCoins;
-    static int nLastStakeSetUpdate = 0;
+        //check that it is matured
+        const int nDepth = context.pindexPrev->nHeight - indexed.pindexFrom->nHeight + 1;
+        const bool fGenerated = indexed.pwtx->IsCoinBase() || indexed.pwtx->IsCoinStake();
+        if (nDepth < (fGenerated ? COINBASE_MATURITY + 1 : 10))
+            continue;
 
-    auto chainTip = chainActive.Tip();
-    unsigned int nExpectedBlockHeight = chainTip->nHeight + 1;
+        //check for min age
+        if (nTime - indexed.pwtx->GetTxTime() < nStakeMinAge)
+            continue;
 
-    if (GetTime() - nLastStakeSetUpdate > nStakeSetUpdateTime)
-    {
-        allStakeCoins.clear();
-        validStakeCoins.clear();
-        auto locked_chain = chain().lock();
-        bool fCheckForMinStakeAmount = ShouldCheckForMinStakeAmount(chainTip->nHeight, Params().GetConsensus());
-        if (!SelectStakeCoins(*locked_chain, allStakeCoins, validStakeCoins, nBalance /*- nReserveBalance*/, fGenerateSegwit, fCheckForMinStakeAmount)) {
-            return error("Failed to select coins for staking");
+        if (!fGenerateSegwit && indexed.fWitness)
+            continue;
+
+        if (IsLockedCoin(entry.first.hash, entry.first.n) || IsSpent(*locked_chain, entry.first.hash, entry.first.n))
+            continue;
+
+        setCombineCoins.emplace(indexed.pwtx, indexed.i);
+
+        if (fCheckForMinStakeAmount && indexed.nValue < MIN_STAKING_AMOUNT * COIN)
+            continue;
+
+        CStakeCandidate candidate = indexed;
+        if (!context.fModifierV3)
+        {
+            int nStakeModifierHeight = 0;
+            int64_t nStakeModifierTime = 0;
+            if (!GetKernelStakeModifier(indexed.pindexFrom->GetBlockHash(), context.nHeight, candidate.nStakeModifier,
+                                        nStakeModifierHeight, nStakeModifierTime, false))
+                continue;
         }
 
-        nLastStakeSetUpdate = GetTime();
+        vCandidates.push_back(candidate);
     }
 
-    if (validStakeCoins.empty())
+    if (vCandidates.empty())
     {
-        LogPrint(BCLog::MINER, "CreateCoinStake() : No Coins to stake");
+        LogPrint(BCLog::MINER, "SelectStakeCandidates() : No Coins to stake\n");
         return false;
     }
 
+    return true;
+}
 
+bool CWallet::FindStakeKernel(const CStakeKernelContext &context,
+                              const std::vector<CStakeCandidate> &vCandidates,
+                              const CStakeCandidate *&pkernel,
+                              unsigned int &nTxNewTime) const
+{
     //prevent staking a time that won't be accepted
-    if (GetAdjustedTime() <= chainTip->nTime)
+    if (GetAdjustedTime() <= context.pindexPrev->GetBlockTime())
         MilliSleep(10000);
 
-    bool fKernelFound = false;
-
-    for(const std::pair<const CWalletTx*, unsigned int> &pcoin : validStakeCoins)
+    // Min age requirement, leaving room for the hash drift
+    nTxNewTime = GetAdjustedTime();
+    std::vector<size_t> vIndex;
+    std::vector<CStakeKernelInput> vInputs;
+    vIndex.reserve(vCandidates.size());
+    vInputs.reserve(vCandidates.size());
+    for (size_t n = 0; n < vCandidates.size(); n++)
     {
-        //make sure that enough time has elapsed between
-        CBlockIndex* pindex = NULL;
-        BlockMap::iterator it = mapBlockIndex.find(pcoin.first->hashBlock);
-        if (it != mapBlockIndex.end())
-            pindex = it->second;
-        else {
-            LogPrint(BCLog::KERNEL, "failed to find block index \n");
+        const CStakeCandidate &candidate = vCandidates[n];
+        if (candidate.nBlockFromTime + nStakeMinAge + nHashDrift > nTxNewTime)
             continue;
-        }
 
-        // Read block header
-        CBlockHeader block = pindex->GetBlockHeader();
-        COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
+        CStakeKernelInput input;
+        input.prevout = candidate.prevout;
+        input.nValue = candidate.nValue;
+        input.nBlockFromTime = candidate.nBlockFromTime;
+        input.nStakeModifier = candidate.nStakeModifier;
+        vInputs.push_back(input);
+        vIndex.push_back(n);
+    }
 
-        nTxNewTime = GetAdjustedTime();
-        //iterates each utxo inside of CheckStakeKernelHash()
-        CScript kernelScript;
-        auto stakeScript = pcoin.first->tx->vout[pcoin.second].scriptPubKey;
-        fKernelFound = CreateCoinStakeKernel(chainTip, kernelScript, stakeScript, nBits, nExpectedBlockHeight,
-                                             block, pcoin.first->tx,
-                                             prevoutStake, nTxNewTime, fGenerateSegwit, false);
+    boost::this_thread::interruption_point();
+    CStakeKernelResult result;
+    if (ScanStakeKernels(context, vInputs, nTxNewTime, nHashDrift, result))
+    {
+        if (gArgs.GetBoolArg("-printcoinstake", false))
+            LogPrintf("FindStakeKernel : kernel found\n");
 
-        if(fKernelFound)
-        {
-            vwtxPrev.push_back(pcoin.first);
-            txNew.vin.push_back(CTxIn(prevoutStake));
-            auto nCredit = pcoin.first->tx->vout[pcoin.second].nValue + blockReward.nStakeReward;
-            FillCoinStakePayments(allStakeCoins, vwtxPrev, txNew, kernelScript, nCredit);
-            break;
-        }
+        pkernel = &vCandidates[vIndex[result.nIndex]];
+        nTxNewTime = result.nTimeTx;
+        return true;
     }
 
-    if(!fKernelFound)
+    if (context.IsStale())
     {
-        LogPrint(BCLog::KERNEL, "Failed to find coinstake kernel\n");
+        LogPrint(BCLog::KERNEL, "FindStakeKernel() : chain tip changed, aborting kernel search\n");
         return false;
     }
 
+    LogPrint(BCLog::KERNEL, "Failed to find coinstake kernel\n");
+    return false;
+}
+
+bool CWallet::CreateCoinStake(const CStakeKernelContext &context,
+                              const CStakeCandidate &kernel,
+                              const StakeCoinsSet &setCombineCoins,
+                              const CBlockRewards &blockReward,
+                              CMutableTransaction &txNew,
+                              std::vector<const CWalletTx*> &vwtxPrev)
+{
+    AssertLockHeld(cs_main);
+    auto locked_chain = chain().lock();
+    LOCK(cs_wallet);
+
+    // The kernel was found without cs_wallet held, make sure it is still in the wallet and unspent
+    auto itKernel = mapWallet.find(kernel.prevout.hash);
+    if (itKernel == mapWallet.end() || &itKernel->second != kernel.pwtx)
+    {
+        return error("CreateCoinStake : kernel %s was removed during the search", kernel.prevout.ToString());
+    }
+    if (IsSpent(*locked_chain, kernel.prevout.hash, kernel.prevout.n))
+    {
+        return error("CreateCoinStake : kernel %s was spent during the search", kernel.prevout.ToString());
+    }
+
+    // The following split & combine thresholds are important to security
+    // Should not be adjusted if you don't understand the consequences
+    //int64_t nCombineThreshold = 0;
+    txNew.vin.clear();
+    txNew.vout.clear();
+
+    // Mark coin stake transaction
+    CScript scriptEmpty;
+    scriptEmpty.clear();
+    txNew.vout.push_back(CTxOut(0, scriptEmpty));
+
+    vwtxPrev.push_back(kernel.pwtx);
+    txNew.vin.push_back(CTxIn(kernel.prevout));
+    auto nCredit = kernel.nValue + blockReward.nStakeReward;
+    FillCoinStakePayments(setCombineCoins, vwtxPrev, txNew, kernel.pwtx->tx->vout[kernel.i].scriptPubKey, nCredit);
+
     // Update coinbase transaction with additional info about masternode and governance payments,
     // get some info back to pass to getblocktemplate
-    int nHeight = chainTip->nHeight + 1;
     // Masternode payment
     FillBlockPayee(txNew, blockReward, true, Params().GetConsensus());
     LogPrintf("CreateCoinStake -- nBlockHeight %d blockReward %lld txNew %s",
-              nHeight, blockReward.ToString(), CTransaction(txNew).ToString());
+              context.nHeight, blockReward.ToString(), CTransaction(txNew).ToString());
 
-    nLastStakeSetUpdate = 0; //this will trigger stake set to repopulate next round
     return true;
 }
 
@@ -3481,6 +3506,7 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     for (uint256 hash : vHashOut) {
         const auto& it = mapWallet.find(hash);
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
+        mapStakeIndex.erase(mapStakeIndex.lower_bound(COutPoint(hash, 0)), mapStakeIndex.lower_bound(COutPoint(hash, std::numeric_limits<uint32_t>::max())));
         mapWallet.erase(it);
     }
 
@@ -4724,6 +4750,94 @@ bool CWallet::GetDecryptedHDChain(CHDChain& hdChainRet)
     return true;
 }
 
+// Keys derived by each thread of an integrity check at least
+static const size_t MIN_HD_KEYS_PER_THREAD = 256;
+
+bool CWallet::CheckHDIntegrity(CHDIntegrityResult& result, std::string& strFailReason)
+{
+    if (fCheckingHDIntegrity.exchange(true)) {
+        strFailReason = _("Wallet is currently checking its integrity");
+        return false;
+    }
+    fAbortHDIntegrityCheck = false;
+
+    struct HDKeyToCheck {
+        uint32_t nAccountIndex;
+        bool fInternal;
+        uint32_t nChild;
+        CPubKey pubkey;
+    };
+    std::vector<HDKeyToCheck> vKeys;
+    HDChangeKeyMap mapChangeKeys;
+    {
+        LOCK(cs_wallet);
+        vKeys.reserve(mapHdPubKeys.size());
+        for (const auto& entry : mapHdPubKeys) {
+            const CHDPubKey& hdPubKey = entry.second;
+            const auto account = std::make_pair(hdPubKey.nAccountIndex, hdPubKey.nChangeIndex != 0);
+            if (!mapChangeKeys.count(account) && !GetHDChangeKey(account.first, account.second, mapChangeKeys[account])) {
+                // the wallet may have been locked since the caller checked it
+                strFailReason = IsLocked() ? _("Wallet is locked") : _("Failed to derive the keys of the HD chain");
+                fCheckingHDIntegrity = false;
+                return false;
+            }
+            vKeys.push_back(HDKeyToCheck{account.first, account.second, hdPubKey.extPubKey.nChild, hdPubKey.extPubKey.pubkey});
+        }
+    }
+
+    const std::string strProgress = strprintf("%s " + _("Verifying HD keys..."), GetDisplayName());
+    const size_t nThreads = GetParallelThreadCount(vKeys.size(), MIN_HD_KEYS_PER_THREAD);
+    std::vector<CHDIntegrityResult> vResults(nThreads);
+    std::atomic<size_t> nChecked{0};
+
+    ShowProgress(strProgress, 0);
+    // Keys are interleaved over the threads, the first one also reports the progress
+    auto check = [&](size_t nFirst) {
+        CHDIntegrityResult& threadResult = vResults[nFirst];
+        int nLastProgress = 0;
+        for (size_t i = nFirst; i < vKeys.size() && !fAbortHDIntegrityCheck; i += nThreads) {
+            const HDKeyToCheck& hdKey = vKeys[i];
+            CExtKey extkey;
+            bool fAvailable = mapChangeKeys.at(std::make_pair(hdKey.nAccountIndex, hdKey.fInternal)).Derive(extkey, hdKey.nChild) &&
+                              extkey.key.VerifyPubKey(hdKey.pubkey);
+
+            CHDAccountIntegrity& account = threadResult.mapAccounts[hdKey.nAccountIndex];
+            account.nKeys++;
+            if (!fAvailable)
+                account.nLostKeys++;
+
+            size_t nDone = ++nChecked;
+            if (nFirst == 0) {
+                int nProgress = std::min<int>(99, nDone * 100 / vKeys.size());
+                if (nProgress > nLastProgress) {
+                    ShowProgress(strProgress, std::max(1, nProgress));
+                    nLastProgress = nProgress;
+                }
+            }
+        }
+    };
+
+    ParallelFor(nThreads, check);
+    ShowProgress(strProgress, 100);
+
+    result = CHDIntegrityResult();
+    for (const CHDIntegrityResult& threadResult : vResults) {
+        for (const auto& entry : threadResult.mapAccounts) {
+            CHDAccountIntegrity& account = result.mapAccounts[entry.first];
+            account.nKeys += entry.second.nKeys;
+            account.nLostKeys += entry.second.nLostKeys;
+            result.nKeys += entry.second.nKeys;
+            result.nLostKeys += entry.second.nLostKeys;
+        }
+    }
+    result.fAborted = fAbortHDIntegrityCheck;
+    if (result.fAborted)
+        WalletLogPrintf("HD integrity check aborted after %u of %u keys\n", result.nKeys, vKeys.size());
+
+    fCheckingHDIntegrity = false;
+    return true;
+}
+
 bool CWallet::IsHDEnabled()
 {
     CHDChain hdChainCurrent;
@@ -100,6 +100,7 @@ class CBlockPolicyEstimator;
 class CWalletTx;
 struct FeeCalculation;
 struct CBlockRewards;
+struct CStakeKernelContext;
 enum class FeeEstimateMode;
 
 /** (client) version numbers for particular wallet features */
@@ -604,16 +605,57 @@ struct CoinSelectionParams
     CoinSelectionParams() {}
 };
 
+/** Wallet output that can be used as a stake kernel, with the data its kernel hash needs */
+struct CStakeCandidate
+{
+    //! Only dereferenced with cs_wallet held
+    const CWalletTx* pwtx = nullptr;
+    unsigned int i = 0;
+    //! The output itself, for searching the kernel without cs_wallet
+    COutPoint prevout;
+    CAmount nValue = 0;
+    uint32_t nBlockFromTime = 0;
+    //! Kernel stake modifier, only set before the V3 modifier is active
+    uint64_t nStakeModifier = 0;
+    //! Block the output was confirmed in
+    const CBlockIndex* pindexFrom = nullptr;
+    //! Pays to a native or P2SH segwit key instead of P2PKH
+    bool fWitness = false;
+};
+
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
+
+/** Keys of one HD account checked by CWallet::CheckHDIntegrity */
+struct CHDAccountIntegrity
+{
+    size_t nKeys = 0;
+    size_t nLostKeys = 0;
+};
+
+/** Result of CWallet::CheckHDIntegrity */
+struct CHDIntegrityResult
+{
+    std::map<uint32_t, CHDAccountIntegrity> mapAccounts;
+    size_t nKeys = 0;
+    size_t nLostKeys = 0;
+    //! AbortHDIntegrityCheck() stopped the check, the counts only cover the keys checked so far
+    bool fAborted = false;
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
 class CWallet final : public CCryptoKeyStore, public CValidationInterface
 {
+public:
+    using StakeCoinsSet = std::set<std::pair<const CWalletTx*, unsigned int>>;
+
 private:
     std::atomic<bool> fAbortRescan{false};
     std::atomic<bool> fScanningWallet{false}; // controlled by WalletRescanReserver
+    std::atomic<bool> fAbortHDIntegrityCheck{false};
+    std::atomic<bool> fCheckingHDIntegrity{false};
     std::mutex mutexScanning;
     friend class WalletRescanReserver;
 
@@ -709,10 +751,20 @@ private:
      */
     const CBlockIndex* m_last_block_processed = nullptr;
 
-    using StakeCoinsSet = std::set<std::pair<const CWalletTx*, unsigned int>>;
-    bool CreateCoinStakeKernel(CBlockIndex *prevIndex, CScript &kernelScript, const CScript &stakeScript,
-                               unsigned int nBits, unsigned int nExpectedBlockHeight, const CBlock& blockFrom, const CTransactionRef &txPrev,
-                               const COutPoint& prevout, unsigned int &nTimeTx, bool fGenerateSegwit, bool fPrintProofOfStake) const;
+    /**
+     * Every spendable output of a confirmed wallet transaction that pays to a
+     * key we can stake with and was not spent in a connected block. It is
+     * built on the first kernel search and then kept up to date by
+     * AddToWallet, BlockConnected and BlockDisconnected, so that staking only
+     * needs the per coin checks of SelectStakeCandidates.
+     */
+    std::map<COutPoint, CStakeCandidate> mapStakeIndex GUARDED_BY(cs_wallet);
+    bool fStakeIndexBuilt GUARDED_BY(cs_wallet) = false;
+
+    bool IsSpentInChain(interfaces::Chain::Lock& locked_chain, const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+    void AddToStakeIndex(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx, unsigned int i) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    void AddToStakeIndex(interfaces::Chain::Lock& locked_chain, const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
+    void BuildStakeIndex(interfaces::Chain::Lock& locked_chain) EXCLUSIVE_LOCKS_REQUIRED(cs_main, cs_wallet);
 
     void FillCoinStakePayments(const StakeCoinsSet &setStakeCoins,
                                std::vector<const CWalletTx *> &vwtxPrev,
@@ -764,7 +816,6 @@ public:
     unsigned int nHashDrift = 45;
     unsigned int nHashInterval = 22;
     uint64_t nStakeSplitThreshold = DEFAULT_N_STAKE_SPLIT_THRESHOLD;
-    int nStakeSetUpdateTime = 300; // 5 minutes
 
     /** Construct wallet with specified name and database implementation. */
     CWallet(interfaces::Chain& chain, const WalletLocation& location, std::unique_ptr<WalletDatabase> database) : m_chain(chain), m_location(location), database(std::move(database))
@@ -828,7 +879,6 @@ public:
 
     // Coin selection
     bool MintableCoins(interfaces::Chain::Lock &locked_chain);
-    bool SelectStakeCoins(interfaces::Chain::Lock& locked_chain, StakeCoinsSet& allStakeCoins, StakeCoinsSet &validStakeCoins, CAmount nTargetAmount, bool fSelectWitness, bool fCheckForMinStakeAmount) const;
 
     bool IsSpent(interfaces::Chain::Lock& locked_chain, const uint256& hash, unsigned int n) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
     std::vector<OutputGroup> GroupOutputs(const std::vector<COutput>& outputs, bool single_coin) const;
@@ -851,6 +901,17 @@ public:
     bool IsAbortingRescan() { return fAbortRescan; }
     bool IsScanning() { return fScanningWallet; }
 
+    /**
+     * Derives every key of mapHdPubKeys again and checks it against its public
+     * key, on all cores and without holding cs_wallet. Only the HD chain
+     * snapshot is taken under the lock. Returns false with the reason in
+     * strFailReason when another check is running, the wallet is locked or the
+     * HD chain can not be used.
+     */
+    bool CheckHDIntegrity(CHDIntegrityResult& result, std::string& strFailReason);
+    void AbortHDIntegrityCheck() { fAbortHDIntegrityCheck = true; }
+    bool IsCheckingHDIntegrity() const { return fCheckingHDIntegrity; }
+
     /**
      * keystore implementation
      * Generate a new key
@@ -963,9 +1024,24 @@ public:
                            std::string& strFailReason, const CCoinControl& coin_control, bool sign = true);
     bool CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::vector<std::pair<std::string, std::string>> orderForm, CReserveKey& reservekey, CConnman* connman, CValidationState& state);
 
-    bool CreateCoinStake(unsigned int nBits, const CBlockRewards &blockReward,
-                         CMutableTransaction& txNew, unsigned int& nTxNewTime,
-                         std::vector<const CWalletTx *> &vwtxPrev, bool fGenerateSegwit);
+    /**
+     * Capture the outputs of the stake index that can stake on top of the tip
+     * in context, so that FindStakeKernel can search them without holding
+     * cs_main or cs_wallet.
+     */
+    bool SelectStakeCandidates(const CStakeKernelContext &context, bool fGenerateSegwit,
+                               std::vector<CStakeCandidate> &vCandidates, StakeCoinsSet &setCombineCoins) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /**
+     * Search vCandidates for a stake kernel, spread over the -stakethreads
+     * workers. Takes no locks, so it only reads what the candidates copied out
+     * of the wallet, and gives up as soon as the tip the context was captured
+     * on is no longer the best block.
+     */
+    bool FindStakeKernel(const CStakeKernelContext &context, const std::vector<CStakeCandidate> &vCandidates,
+                         const CStakeCandidate *&pkernel, unsigned int &nTxNewTime) const;
+    bool CreateCoinStake(const CStakeKernelContext &context, const CStakeCandidate &kernel,
+                         const StakeCoinsSet &setCombineCoins, const CBlockRewards &blockReward,
+                         CMutableTransaction& txNew, std::vector<const CWalletTx *> &vwtxPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     bool DummySignTx(CMutableTransaction &txNew, const std::set<CTxOut> &txouts, bool use_max_sig = false) const
     {
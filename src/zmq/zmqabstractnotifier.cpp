@@ -21,3 +21,23 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyBlockFound(const CBlock &/*block*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyMasternode(const CMasternode &/*mn*/, MasternodeChange /*change*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyPaymentVote(const CMasternodePaymentWinner &/*winner*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifySpork(const CSporkMessage &/*spork*/)
+{
+    return true;
+}
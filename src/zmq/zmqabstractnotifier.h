@@ -7,8 +7,13 @@
 
 #include <zmq/zmqconfig.h>
 
+class CBlock;
 class CBlockIndex;
+class CMasternode;
+class CMasternodePaymentWinner;
+class CSporkMessage;
 class CZMQAbstractNotifier;
+enum class MasternodeChange;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -42,6 +47,10 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyBlockFound(const CBlock &block);
+    virtual bool NotifyMasternode(const CMasternode &mn, MasternodeChange change);
+    virtual bool NotifyPaymentVote(const CMasternodePaymentWinner &winner);
+    virtual bool NotifySpork(const CSporkMessage &spork);
 
 protected:
     void *psocket;
@@ -48,6 +48,10 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubhashstake"] = CZMQAbstractNotifier::Create<CZMQPublishHashStakeNotifier>;
+    factories["pubrawmasternode"] = CZMQAbstractNotifier::Create<CZMQPublishRawMasternodeNotifier>;
+    factories["pubrawmnvote"] = CZMQAbstractNotifier::Create<CZMQPublishRawPaymentVoteNotifier>;
+    factories["pubrawspork"] = CZMQAbstractNotifier::Create<CZMQPublishRawSporkNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -138,15 +142,12 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+void CZMQNotificationInterface::Notify(const std::function<bool (CZMQAbstractNotifier*)>& notify)
 {
-    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
-        return;
-
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
+        if (notify(notifier))
         {
             i++;
         }
@@ -158,25 +159,21 @@ void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, co
     }
 }
 
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+        return;
+
+    Notify([pindexNew](CZMQAbstractNotifier* notifier) { return notifier->NotifyBlock(pindexNew); });
+}
+
 void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx)
 {
     // Used by BlockConnected and BlockDisconnected as well, because they're
     // all the same external callback.
     const CTransaction& tx = *ptx;
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
-    {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
-    }
+    Notify([&tx](CZMQAbstractNotifier* notifier) { return notifier->NotifyTransaction(tx); });
 }
 
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted)
@@ -195,4 +192,24 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
     }
 }
 
+void CZMQNotificationInterface::BlockFound(const std::shared_ptr<const CBlock>& pblock)
+{
+    Notify([&pblock](CZMQAbstractNotifier* notifier) { return notifier->NotifyBlockFound(*pblock); });
+}
+
+void CZMQNotificationInterface::MasternodeChanged(const CMasternode& mn, MasternodeChange change)
+{
+    Notify([&mn, change](CZMQAbstractNotifier* notifier) { return notifier->NotifyMasternode(mn, change); });
+}
+
+void CZMQNotificationInterface::MasternodePaymentVote(const CMasternodePaymentWinner& winner)
+{
+    Notify([&winner](CZMQAbstractNotifier* notifier) { return notifier->NotifyPaymentVote(winner); });
+}
+
+void CZMQNotificationInterface::SporkUpdated(const CSporkMessage& spork)
+{
+    Notify([&spork](CZMQAbstractNotifier* notifier) { return notifier->NotifySpork(spork); });
+}
+
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
@@ -6,6 +6,7 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include <validationinterface.h>
+#include <functional>
 #include <string>
 #include <map>
 #include <list>
@@ -31,10 +32,17 @@ protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected, const std::vector<CTransactionRef>& vtxConflicted) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void BlockFound(const std::shared_ptr<const CBlock>& pblock) override;
+    void MasternodeChanged(const CMasternode& mn, MasternodeChange change) override;
+    void MasternodePaymentVote(const CMasternodePaymentWinner& winner) override;
+    void SporkUpdated(const CSporkMessage& spork) override;
 
 private:
     CZMQNotificationInterface();
 
+    // Call notify on each notifier, shutting down the ones that fail
+    void Notify(const std::function<bool (CZMQAbstractNotifier*)>& notify);
+
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
 };
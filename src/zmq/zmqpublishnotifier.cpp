@@ -4,6 +4,9 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <masternodes/masternode.h>
+#include <masternodes/masternode-payments.h>
+#include <spork.h>
 #include <streams.h>
 #include <zmq/zmqpublishnotifier.h>
 #include <validation.h>
@@ -16,6 +19,10 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_HASHSTAKE = "hashstake";
+static const char *MSG_RAWMN     = "rawmasternode";
+static const char *MSG_RAWMNVOTE = "rawmnvote";
+static const char *MSG_RAWSPORK  = "rawspork";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -205,3 +212,41 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashStakeNotifier::NotifyBlockFound(const CBlock &block)
+{
+    if (!block.IsProofOfStake())
+        return true;
+
+    uint256 hash = block.GetHash();
+    LogPrint(BCLog::ZMQ, "zmq: Publish hashstake %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHSTAKE, data, 32);
+}
+
+bool CZMQPublishRawMasternodeNotifier::NotifyMasternode(const CMasternode &mn, MasternodeChange change)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawmasternode %s\n", mn.vin.prevout.ToString());
+    // the change, then the entry as the masternode list stores it
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << static_cast<uint8_t>(change) << mn;
+    return SendMessage(MSG_RAWMN, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawPaymentVoteNotifier::NotifyPaymentVote(const CMasternodePaymentWinner &winner)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawmnvote %s\n", winner.GetHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << winner;
+    return SendMessage(MSG_RAWMNVOTE, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishRawSporkNotifier::NotifySpork(const CSporkMessage &spork)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish rawspork %s\n", spork.GetHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << spork;
+    return SendMessage(MSG_RAWSPORK, &(*ss.begin()), ss.size());
+}
@@ -52,4 +52,28 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+class CZMQPublishHashStakeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockFound(const CBlock &block) override;
+};
+
+class CZMQPublishRawMasternodeNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyMasternode(const CMasternode &mn, MasternodeChange change) override;
+};
+
+class CZMQPublishRawPaymentVoteNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyPaymentVote(const CMasternodePaymentWinner &winner) override;
+};
+
+class CZMQPublishRawSporkNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifySpork(const CSporkMessage &spork) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H